@@ -63,13 +63,27 @@
  * @brief Size of opaque YATL_Span_t structure in bytes
  * @ingroup yatl_types
  */
-#define YATL_SPAN_SIZE 160
+#define YATL_SPAN_SIZE 176
 
 /**
  * @brief Size of opaque YATL_Doc_t structure in bytes
  * @ingroup yatl_types
  */
-#define YATL_DOC_SIZE 64
+#define YATL_DOC_SIZE 128
+
+/**
+ * @brief Size of opaque YATL_Query_t structure in bytes
+ * @ingroup yatl_types
+ */
+#define YATL_QUERY_SIZE 32
+
+/**
+ * @brief Most segments a key path may have
+ * @ingroup yatl_types
+ *
+ * Paths are resolved on the stack, so longer ones are rejected.
+ */
+#define YATL_PATH_MAX_SEGMENTS 32
 
 /**
  * @brief Opaque line structure.
@@ -123,6 +137,20 @@ typedef struct YATL_Doc {
   _Alignas(max_align_t) unsigned char _opaque[YATL_DOC_SIZE];
 } YATL_Doc_t;
 
+/**
+ * @brief Opaque compiled query structure.
+ * @ingroup yatl_types
+ *
+ * A key path split and hashed once by YATL_query_compile(), for lookups
+ * that are repeated many times.
+ *
+ * @note Always initialize with YATL_query_create() before use.
+ *       Always call YATL_query_free() when done to release resources.
+ */
+typedef struct YATL_Query {
+  _Alignas(max_align_t) unsigned char _opaque[YATL_QUERY_SIZE];
+} YATL_Query_t;
+
 /**
  * @brief Log levels for YATL diagnostic messages.
  * @ingroup yatl_logging
@@ -218,6 +246,38 @@ typedef enum {
   YATL_TYPE_INLINE_TABLE, /**< Inline table: {...} */
 } YATL_ValueType_t;
 
+/**
+ * @brief Datetime kind enumeration.
+ * @ingroup yatl_enums
+ *
+ * The four TOML datetime forms, see YATL_span_get_datetime().
+ */
+typedef enum {
+  YATL_DT_OFFSET_DATETIME, /**< 1979-05-27T07:32:00-07:00 */
+  YATL_DT_LOCAL_DATETIME,  /**< 1979-05-27T07:32:00 */
+  YATL_DT_LOCAL_DATE,      /**< 1979-05-27 */
+  YATL_DT_LOCAL_TIME,      /**< 07:32:00 */
+} YATL_DateTimeKind_t;
+
+/**
+ * @brief Decoded TOML datetime.
+ * @ingroup yatl_types
+ *
+ * Fields not present in the value's kind are zero: the date for a local
+ * time, the time for a local date, the offset for local kinds.
+ */
+typedef struct {
+  YATL_DateTimeKind_t kind;
+  int year;            /**< 0-9999 */
+  int month;           /**< 1-12 */
+  int day;             /**< 1-31, valid for the month */
+  int hour;            /**< 0-23 */
+  int minute;          /**< 0-59 */
+  int second;          /**< 0-60 (60 for leap seconds) */
+  int32_t nanosecond;  /**< Fractional seconds, truncated to nanoseconds */
+  int offset_minutes;  /**< UTC offset, e.g. -420 for -07:00; 0 for Z */
+} YATL_DateTime_t;
+
 /**
  * @brief Result/error codes returned by YATL functions.
  * @ingroup yatl_enums
@@ -229,12 +289,64 @@ typedef enum {
   YATL_ERR_SYNTAX = -2,    /**< TOML syntax error */
   YATL_ERR_NOT_FOUND = -3, /**< Requested item not found */
   YATL_ERR_TYPE = -4,      /**< Type mismatch error */
-  YATL_ERR_BUFFERi = -5,   /**< Buffer too small */
+  YATL_ERR_BUFFER = -5,    /**< Buffer too small */
   YATL_ERR_NOMEM = -6,     /**< Memory allocation failed */
   YATL_ERR_INVALID_ARG =
       -7, /**< Invalid argument (NULL pointer, uninitialized struct) */
+  YATL_ERR_ENCODING = -8, /**< Input is not valid UTF-8 */
+  YATL_ERR_BUFFERi = YATL_ERR_BUFFER, /**< Deprecated misspelling */
 } YATL_Result_t;
 
+/**
+ * @brief Flags for YATL_doc_load_ex() and YATL_doc_loads_ex().
+ * @ingroup yatl_enums
+ */
+typedef enum {
+  YATL_LOAD_DEFAULT = 0,            /**< Accept any bytes */
+  YATL_LOAD_VALIDATE_UTF8 = 1 << 0, /**< Reject input that is not UTF-8 */
+} YATL_LoadFlags_t;
+
+/**
+ * @brief Flags for YATL_doc_save_atomic().
+ * @ingroup yatl_enums
+ */
+typedef enum {
+  YATL_SAVE_DEFAULT = 0,      /**< Sync the file and its directory */
+  YATL_SAVE_NO_SYNC = 1 << 0, /**< Replace atomically but skip syncing */
+  YATL_SAVE_TMPFILE = 1 << 1, /**< Write an unnamed O_TMPFILE if supported */
+} YATL_SaveFlags_t;
+
+/**
+ * @brief Output callback for YATL_doc_diff().
+ * @ingroup yatl_types
+ *
+ * Receives the output in pieces; concatenated they form the whole text.
+ * Returning anything but YATL_OK stops the output and is passed back to
+ * the caller.
+ *
+ * @param ctx  Caller context given alongside the callback
+ * @param data Next piece of output (not NUL-terminated)
+ * @param len  Length of data in bytes
+ */
+typedef YATL_Result_t (*YATL_WriteFn_t)(void *ctx, const char *data,
+                                        size_t len);
+
+/**
+ * @brief Callback for YATL_stream_filter().
+ * @ingroup yatl_types
+ *
+ * Called with each table span (YATL_S_NODE_TABLE or
+ * YATL_S_NODE_ARRAY_TABLE) and then with each of its key-value spans
+ * (YATL_S_LEAF_KEYVAL), in file order. Key-values before the first header
+ * come without a table call.
+ *
+ * @param ctx  Caller context given alongside the callback
+ * @param span Table or key-value span, which the callback may edit
+ *
+ * @return YATL_OK to continue, anything else to stop the filter
+ */
+typedef YATL_Result_t (*YATL_StreamFn_t)(void *ctx, YATL_Span_t *span);
+
 /**
  * @brief Create an initialized cursor.
  * @ingroup yatl_init
@@ -306,11 +418,61 @@ YATL_Result_t YATL_doc_load(YATL_Doc_t *doc, const char *path);
  */
 YATL_Result_t YATL_doc_loads(YATL_Doc_t *doc, const char *str, size_t len);
 
+/**
+ * @brief Load a TOML document from a string with load flags.
+ * @ingroup yatl_doc
+ *
+ * Same as YATL_doc_loads(). With YATL_LOAD_VALIDATE_UTF8 each line is
+ * checked as it is split, so invalid input is reported before any value is
+ * read. Overlong encodings, surrogates and code points above U+10FFFF are
+ * rejected.
+ *
+ * @param doc            Pointer to initialized document
+ * @param str            TOML content string
+ * @param len            Length of the string in bytes
+ * @param flags          Bitwise OR of YATL_LoadFlags_t values
+ * @param out_bad_offset Receives the byte offset of the first invalid
+ *                       sequence on YATL_ERR_ENCODING (may be NULL)
+ *
+ * @return YATL_OK on success
+ * @return YATL_ERR_ENCODING if validation is enabled and the input is not
+ *         valid UTF-8; the document is left empty
+ * @return YATL_ERR_NOMEM if memory allocation fails
+ * @return YATL_ERR_INVALID_ARG if doc or str is NULL
+ */
+YATL_Result_t YATL_doc_loads_ex(YATL_Doc_t *doc, const char *str, size_t len,
+                                unsigned flags, size_t *out_bad_offset);
+
+/**
+ * @brief Load a TOML document from a file with load flags.
+ * @ingroup yatl_doc
+ *
+ * Same as YATL_doc_load(), with flags as for YATL_doc_loads_ex().
+ *
+ * @param doc            Pointer to initialized document
+ * @param path           Path to the TOML file
+ * @param flags          Bitwise OR of YATL_LoadFlags_t values
+ * @param out_bad_offset Receives the byte offset of the first invalid
+ *                       sequence on YATL_ERR_ENCODING (may be NULL)
+ *
+ * @return YATL_OK on success
+ * @return YATL_ERR_IO if file cannot be opened or read
+ * @return YATL_ERR_ENCODING if validation is enabled and the file is not
+ *         valid UTF-8
+ * @return YATL_ERR_NOMEM if memory allocation fails
+ */
+YATL_Result_t YATL_doc_load_ex(YATL_Doc_t *doc, const char *path,
+                               unsigned flags, size_t *out_bad_offset);
+
 /**
  * @brief Save a document to a file.
  * @ingroup yatl_doc
  *
- * Writes the document content to a file, preserving formatting.
+ * Writes the document content to a file, preserving formatting. Every line,
+ * including the last, is followed by a newline. On POSIX systems lines are
+ * written straight from the document with writev(), up to 512 lines per call
+ * (fewer if the platform's IOV_MAX is below 1024), without copying through a
+ * stdio buffer.
  *
  * @param doc  Pointer to document
  * @param path Path to output file
@@ -321,6 +483,204 @@ YATL_Result_t YATL_doc_loads(YATL_Doc_t *doc, const char *str, size_t len);
  */
 YATL_Result_t YATL_doc_save(YATL_Doc_t *doc, const char *path);
 
+/**
+ * @brief Save a document by atomically replacing a file.
+ * @ingroup yatl_doc
+ *
+ * Writes the document to a temporary file in the same directory as path,
+ * flushes it with fdatasync(), renames it over path and syncs the directory.
+ * Readers see either the old file or the new one, never a torn write, and
+ * the new content survives a crash once this returns. An existing target's
+ * permission bits are kept.
+ *
+ * YATL_SAVE_NO_SYNC keeps the atomic rename but skips both syncs, trading
+ * durability for latency. YATL_SAVE_TMPFILE writes to an unnamed O_TMPFILE
+ * and only links it into the directory once complete, so a crash while
+ * writing leaves no partial temporary file behind. A crash between the link
+ * and the rename can still leave the complete temporary. Where O_TMPFILE is
+ * unsupported, or the file cannot be linked (no /proc), it quietly falls
+ * back to a named temporary. Without POSIX I/O the file is written and
+ * renamed through stdio with no syncing.
+ *
+ * @param doc   Pointer to document
+ * @param path  Path to output file
+ * @param flags Bitwise OR of YATL_SaveFlags_t values
+ *
+ * @return YATL_OK on success
+ * @return YATL_ERR_IO if writing, syncing or renaming fails; path is left
+ *         untouched and the temporary file is removed
+ * @return YATL_ERR_NOMEM if memory allocation fails
+ * @return YATL_ERR_INVALID_ARG if doc or path is NULL
+ *
+ * Example:
+ * @code
+ * YATL_doc_save_atomic(&doc, "state.toml", YATL_SAVE_DEFAULT);
+ * @endcode
+ */
+YATL_Result_t YATL_doc_save_atomic(YATL_Doc_t *doc, const char *path,
+                                   unsigned flags);
+
+/**
+ * @brief Save a document by rewriting only what changed.
+ * @ingroup yatl_doc
+ *
+ * Every line remembers its byte offset in the file the document was last
+ * loaded from or saved to. Unchanged lines still at that offset are left on
+ * disk. A run of changed lines that ends where an unchanged line resumes
+ * occupies the same bytes as before and is patched in place, so same-length
+ * edits write one line. Otherwise the file is written from the first changed
+ * byte and truncated to the new length.
+ *
+ * path should be the file last loaded or saved with this document. If it is
+ * another file, or its size or modification time changed since, it is
+ * rewritten whole. A same-size write by another process within one
+ * timestamp tick of the last load or save goes unnoticed. A document loaded
+ * from memory is rewritten whole on its first save. Like YATL_doc_save()
+ * this is not atomic; a crash part way through leaves a mix of old and new.
+ *
+ * @param doc         Pointer to document
+ * @param path        Path of the file last loaded or saved
+ * @param out_written Receives the number of bytes written (may be NULL)
+ *
+ * @return YATL_OK on success
+ * @return YATL_ERR_IO if the file cannot be written; the next incremental
+ *         save then rewrites it whole
+ * @return YATL_ERR_INVALID_ARG if doc or path is NULL
+ *
+ * Example:
+ * @code
+ * YATL_doc_load(&doc, "big.toml");
+ * YATL_span_set_int64(&port_keyval_span, 8443);
+ * YATL_doc_save_incremental(&doc, "big.toml", NULL); // writes one line
+ * @endcode
+ */
+YATL_Result_t YATL_doc_save_incremental(YATL_Doc_t *doc, const char *path,
+                                        size_t *out_written);
+
+/**
+ * @brief Serialize a document into a caller buffer.
+ * @ingroup yatl_doc
+ *
+ * Produces the same bytes YATL_doc_save() writes, followed by a NUL. The
+ * exact size is computed first, so a call with cap 0 sizes the buffer, and
+ * each line is then copied with a single memcpy().
+ *
+ * @param doc     Pointer to document
+ * @param buf     Output buffer (may be NULL when cap is 0)
+ * @param cap     Capacity of buf in bytes
+ * @param out_len Output length, excluding the terminating NUL. Set even when
+ *                the buffer is too small.
+ *
+ * @return YATL_OK on success; buf holds out_len bytes plus a NUL
+ * @return YATL_ERR_BUFFER if cap < out_len + 1 (buf is not written)
+ * @return YATL_ERR_INVALID_ARG if doc or out_len is NULL, or buf is NULL
+ *         with a non-zero cap
+ *
+ * Example:
+ * @code
+ * size_t len;
+ * YATL_doc_dumps(&doc, NULL, 0, &len);
+ * char *buf = malloc(len + 1);
+ * YATL_doc_dumps(&doc, buf, len + 1, &len);
+ * @endcode
+ */
+YATL_Result_t YATL_doc_dumps(const YATL_Doc_t *doc, char *buf, size_t cap,
+                             size_t *out_len);
+
+/**
+ * @brief Write a unified diff of the edits since load or save.
+ * @ingroup yatl_doc
+ *
+ * Compares the document with the file it was last loaded from or saved to,
+ * using the original line numbers each line keeps rather than comparing
+ * text. Lines removed since are taken from the boneyard. Hunks carry three
+ * lines of context; nothing is written if the document is unchanged.
+ *
+ * The cost is O(lines): every line of the document and the boneyard is
+ * visited once, however small the edit, though line text is only read for
+ * the lines written out. Edits are journaled only inside a transaction or
+ * in the bounded undo history, which drops its oldest steps, so there is
+ * no complete record of them to build hunks from.
+ *
+ * Lines are shown as they are held, so a file loaded with Windows newlines
+ * diffs without the carriage returns.
+ *
+ * @param doc   Pointer to document
+ * @param name  File name for the `---` and `+++` header lines, or NULL to
+ *              write hunks only
+ * @param write Output callback
+ * @param ctx   Passed to write unchanged
+ *
+ * @return YATL_OK on success
+ * @return YATL_ERR_NOT_FOUND if YATL_doc_clear_boneyard() has freed lines
+ *         the diff would need; saving the document starts afresh
+ * @return YATL_ERR_NOMEM if memory allocation fails
+ * @return YATL_ERR_INVALID_ARG if doc or write is NULL
+ * @return Any other result returned by write
+ *
+ * Example:
+ * @code
+ * static YATL_Result_t to_file(void *ctx, const char *data, size_t len) {
+ *   return fwrite(data, 1, len, ctx) == len ? YATL_OK : YATL_ERR_IO;
+ * }
+ * YATL_doc_diff(&doc, "config.toml", to_file, stdout);
+ * @endcode
+ */
+YATL_Result_t YATL_doc_diff(const YATL_Doc_t *doc, const char *name,
+                            YATL_WriteFn_t write, void *ctx);
+
+/**
+ * @brief Rewrite a TOML stream table by table without loading it whole.
+ * @ingroup yatl_doc
+ *
+ * Reads in_fd in blocks and cuts the input at header lines (lines starting
+ * with `[`). Each table is loaded into a scratch document on its own, passed
+ * to fn and written to out_fd before more input is read, so memory stays
+ * bounded by the largest table rather than the file.
+ *
+ * A table callback may edit the table freely, for instance with
+ * YATL_span_insert_keyval() or YATL_span_remove(). A key-value callback may
+ * change that key-value's value through the span, with YATL_span_set_value()
+ * or the typed setters, but must not remove it. Tables the callback left
+ * unchanged are copied to out_fd byte for byte; edited ones are written as
+ * YATL_doc_save() would write them.
+ *
+ * Like the header index, the cut treats any line starting with `[` as a
+ * header, including one inside a multi-line string or array.
+ *
+ * @param in_fd  File descriptor to read TOML from
+ * @param out_fd File descriptor to write the result to
+ * @param fn     Callback for each table and key-value
+ * @param ctx    Passed to fn unchanged
+ *
+ * @return YATL_OK once the whole input has been written
+ * @return YATL_ERR_IO if reading or writing fails, or on platforms without
+ *         POSIX file descriptors
+ * @return YATL_ERR_SYNTAX if a table cannot be parsed
+ * @return YATL_ERR_NOMEM if memory allocation fails
+ * @return YATL_ERR_INVALID_ARG if a descriptor is negative, fn is NULL, or
+ *         a key-value callback removed its key-value
+ * @return Any other result returned by fn
+ *
+ * Example:
+ * @code
+ * static YATL_Result_t bump_port(void *ctx, YATL_Span_t *span) {
+ *   YATL_Span_t key, val;
+ *   const char *name;
+ *   size_t len;
+ *   if (YATL_span_type(span) == YATL_S_LEAF_KEYVAL &&
+ *       YATL_span_keyval_slice(span, &key, &val) == YATL_OK &&
+ *       YATL_span_text(&key, &name, &len) == YATL_OK &&
+ *       len == 4 && memcmp(name, "port", 4) == 0)
+ *     return YATL_span_set_int64(span, 8443);
+ *   return YATL_OK;
+ * }
+ * YATL_stream_filter(in_fd, out_fd, bump_port, NULL);
+ * @endcode
+ */
+YATL_Result_t YATL_stream_filter(int in_fd, int out_fd, YATL_StreamFn_t fn,
+                                 void *ctx);
+
 /**
  * @brief Free document resources.
  * @ingroup yatl_doc
@@ -345,12 +705,38 @@ void YATL_doc_free(YATL_Doc_t *doc);
  * @param doc Pointer to document
  *
  * @return YATL_OK on success
- * @return YATL_ERR_INVALID_ARG if doc is NULL or not initialized
+ * @return YATL_ERR_INVALID_ARG if doc is NULL or not initialized, or a
+ *         transaction is open
  *
  * @note Call this after edits are finalized to free memory.
  */
 YATL_Result_t YATL_doc_clear_boneyard(YATL_Doc_t *doc);
 
+/**
+ * @brief Make a document read-only for sharing between threads.
+ * @ingroup yatl_doc
+ *
+ * Builds every index the lookup functions would otherwise build on first
+ * use, then refuses further edits. Afterwards any number of threads may
+ * call the find, get, cursor and dump functions on the document at once
+ * without locking, provided it is handed to them after this returns (for
+ * example by creating the threads afterwards).
+ *
+ * Edits, transactions, undo and redo, YATL_doc_clear_boneyard() and
+ * YATL_doc_save_incremental() return YATL_ERR_INVALID_ARG on a frozen
+ * document. YATL_doc_save() and YATL_doc_save_atomic() still write it but
+ * no longer record the file for YATL_doc_diff(). The undo history is
+ * freed. A document cannot be thawed; load it again to edit.
+ *
+ * @param doc Pointer to document
+ *
+ * @return YATL_OK on success, or if the document is already frozen
+ * @return YATL_ERR_INVALID_ARG if doc is NULL or not initialized, or a
+ *         transaction is open
+ * @return YATL_ERR_NOMEM if the indexes could not be built
+ */
+YATL_Result_t YATL_doc_freeze(YATL_Doc_t *doc);
+
 /**
  * @brief Get a span covering the entire document.
  * @ingroup yatl_span_nav
@@ -410,11 +796,202 @@ YATL_Result_t YATL_span_find_next(const YATL_Span_t *in_span,
  * @return YATL_ERR_INVALID_ARG if any parameter is NULL/uninitialized
  *
  * @note Dotted table names like [server.http] are matched literally.
- *       Use "server.http", not nested searches.
+ *       Use "server.http", not nested searches. To resolve a key path
+ *       with TOML semantics, use YATL_doc_find_path().
  */
 YATL_Result_t YATL_span_find_name(const YATL_Span_t *in_span, const char *name,
                                   YATL_Span_t *out_span);
 
+/**
+ * @brief Resolve a dotted key path with TOML semantics.
+ * @ingroup yatl_span_nav
+ *
+ * Follows the path through table headers, dotted keys and inline tables,
+ * so "server.http.port" is found whether it is written as
+ * `[server.http]` + `port = ...`, `[server]` + `http.port = ...` or
+ * `server = { http = { port = ... } }`. Segments may be quoted
+ * (e.g. `site."example.com".port`). The document is scanned once.
+ *
+ * A segment may be followed by an element selector `[n]` (0-based):
+ * `servers[1].host` picks the second `[[servers]]` table, `ports[0]` the
+ * first element of an array value.
+ *
+ * @param doc      Pointer to document
+ * @param path     Dotted key path
+ * @param out_span Output span: a YATL_S_NODE_TABLE or
+ *                 YATL_S_NODE_ARRAY_TABLE for table paths, the array
+ *                 element for paths ending in a selector, otherwise the
+ *                 YATL_S_LEAF_KEYVAL holding the final key
+ *
+ * @return YATL_OK if found
+ * @return YATL_ERR_NOT_FOUND if nothing is defined at the path
+ * @return YATL_ERR_INVALID_ARG if any parameter is NULL/uninitialized or
+ * path is not a valid dotted key of at most YATL_PATH_MAX_SEGMENTS segments
+ *
+ * @note Tables that only exist implicitly (`server` in the example above)
+ *       have no span of their own and are not found. A path ending at an
+ *       array of tables without a selector gives its first element; going
+ *       further into one needs a selector. Tables defined after an element,
+ *       such as `[a.b]` or `[[a.c]]` after `[[a]]`, belong to it and are
+ *       reached as `a[1].b.y` or `a[1].c[0]`.
+ * @note To look up the same path repeatedly, compile it once with
+ *       YATL_query_compile().
+ *
+ * @code
+ * YATL_Span_t kv, key, val;
+ * if (YATL_doc_find_path(&doc, "server.http.port", &kv) == YATL_OK) {
+ *     YATL_span_keyval_slice(&kv, &key, &val);
+ * }
+ * @endcode
+ */
+YATL_Result_t YATL_doc_find_path(const YATL_Doc_t *doc, const char *path,
+                                 YATL_Span_t *out_span);
+
+/**
+ * @brief Create an initialized, empty query.
+ * @ingroup yatl_init
+ *
+ * @return Initialized query structure
+ */
+YATL_Query_t YATL_query_create(void);
+
+/**
+ * @brief Compile a key path for repeated lookups.
+ * @ingroup yatl_span_nav
+ *
+ * Splits the path once, storing each segment with its length and a hash
+ * of the path prefix it completes. Header lines cache the same hash of
+ * their table name, so executing the query rejects non-matching tables
+ * without re-parsing either side. Path syntax is that of
+ * YATL_doc_find_path(). A query may be recompiled; the previous path is
+ * released.
+ *
+ * @param query Pointer to initialized query
+ * @param path  Dotted key path (copied)
+ *
+ * @return YATL_OK on success
+ * @return YATL_ERR_NOMEM if memory allocation fails
+ * @return YATL_ERR_INVALID_ARG if any parameter is NULL/uninitialized or
+ * path is not a valid dotted key of at most YATL_PATH_MAX_SEGMENTS segments
+ *
+ * @code
+ * YATL_Query_t q = YATL_query_create();
+ * YATL_query_compile(&q, "servers[0].port");
+ * for (...) {
+ *     YATL_query_exec(&doc, &q, &kv);
+ * }
+ * YATL_query_free(&q);
+ * @endcode
+ */
+YATL_Result_t YATL_query_compile(YATL_Query_t *query, const char *path);
+
+/**
+ * @brief Execute a compiled query against a document.
+ * @ingroup yatl_span_nav
+ *
+ * Same result as YATL_doc_find_path() with the compiled path.
+ *
+ * @param doc      Pointer to document
+ * @param query    Compiled query
+ * @param out_span Output span, see YATL_doc_find_path()
+ *
+ * @return YATL_OK if found
+ * @return YATL_ERR_NOT_FOUND if nothing is defined at the path
+ * @return YATL_ERR_INVALID_ARG if any parameter is NULL/uninitialized or the
+ * query has not been compiled
+ */
+YATL_Result_t YATL_query_exec(const YATL_Doc_t *doc, const YATL_Query_t *query,
+                              YATL_Span_t *out_span);
+
+/**
+ * @brief Free query resources.
+ * @ingroup yatl_init
+ *
+ * Releases the compiled path and resets the query to its created state.
+ *
+ * @param query Pointer to query to free
+ *
+ * @note Safe to call with NULL pointer (no-op).
+ */
+void YATL_query_free(YATL_Query_t *query);
+
+/**
+ * @brief Create a cursor at a line and column.
+ * @ingroup yatl_span_nav
+ *
+ * Uses the document's position index (built on first use, rebuilt after
+ * the document is modified), so the lookup is O(1).
+ *
+ * @param doc        Pointer to document
+ * @param line       Line number, starting from 1
+ * @param col        Byte column, starting from 0 (may equal the line length)
+ * @param out_cursor Output cursor
+ *
+ * @return YATL_OK on success
+ * @return YATL_ERR_NOT_FOUND if the position is outside the document
+ * @return YATL_ERR_NOMEM if building the index fails
+ * @return YATL_ERR_INVALID_ARG if any parameter is NULL/uninitialized
+ */
+YATL_Result_t YATL_doc_cursor_at(const YATL_Doc_t *doc, size_t line,
+                                 size_t col, YATL_Cursor_t *out_cursor);
+
+/**
+ * @brief Create a cursor at a byte offset.
+ * @ingroup yatl_span_nav
+ *
+ * Offsets are relative to the document as YATL_doc_save() writes it: every
+ * line break counts as one byte. O(log n) in the number of lines.
+ *
+ * @param doc        Pointer to document
+ * @param offset     Byte offset from the start of the document
+ * @param out_cursor Output cursor
+ *
+ * @return YATL_OK on success
+ * @return YATL_ERR_NOT_FOUND if the offset is past the end of the document
+ * @return YATL_ERR_NOMEM if building the index fails
+ * @return YATL_ERR_INVALID_ARG if any parameter is NULL/uninitialized
+ */
+YATL_Result_t YATL_doc_cursor_at_offset(const YATL_Doc_t *doc, size_t offset,
+                                        YATL_Cursor_t *out_cursor);
+
+/**
+ * @brief Find the spans containing a position.
+ * @ingroup yatl_span_nav
+ *
+ * Returns the chain of spans enclosing the cursor, outermost first: the
+ * table (if any), the key-value, its value, and for arrays and inline
+ * tables the nested elements, key-values and values down to the innermost
+ * one. Tables and their key-values are found by binary search in the
+ * document's position index; only the value of the enclosing key-value is
+ * scanned.
+ *
+ * @param doc       Pointer to document
+ * @param at        Position, e.g. from YATL_doc_cursor_at()
+ * @param out_spans Output array for the enclosing spans
+ * @param max_spans Capacity of out_spans; deeper spans are not stored
+ * @param out_depth Number of enclosing spans (may exceed max_spans)
+ *
+ * @return YATL_OK on success
+ * @return YATL_ERR_NOT_FOUND if no table or key-value contains the position
+ * (e.g. a comment or blank line before the first table)
+ * @return YATL_ERR_NOMEM if building the index fails
+ * @return YATL_ERR_INVALID_ARG if any parameter is NULL/uninitialized or the
+ * cursor does not point into doc
+ *
+ * @code
+ * YATL_Cursor_t at;
+ * YATL_Span_t path[8];
+ * size_t depth;
+ * YATL_doc_cursor_at(&doc, 12, 8, &at);
+ * if (YATL_doc_span_at(&doc, &at, path, 8, &depth) == YATL_OK) {
+ *     // path[depth - 1] is the innermost span (if depth <= 8)
+ * }
+ * @endcode
+ */
+YATL_Result_t YATL_doc_span_at(const YATL_Doc_t *doc, const YATL_Cursor_t *at,
+                               YATL_Span_t out_spans[], size_t max_spans,
+                               size_t *out_depth);
+
 /**
  * @brief Find next table or key-value by name with cursor support.
  * @ingroup yatl_span_nav
@@ -448,6 +1025,42 @@ YATL_Result_t YATL_span_find_next_by_name(const YATL_Span_t *in_span,
                                           YATL_Cursor_t *out_cursor,
                                           YATL_Span_t *out_span);
 
+/**
+ * @brief Find next table or key-value whose name matches a glob pattern.
+ * @ingroup yatl_span_nav
+ *
+ * Like YATL_span_find_next_by_name() but matches names against a pattern
+ * in which `*` matches any run of characters (including dots) and `?` any
+ * single character. Names are compared literally, as in
+ * YATL_span_find_name(). The literal part before the first wildcard is
+ * compared first, so prefix patterns such as "feature_*" reject other names
+ * with a single memcmp.
+ *
+ * @param in_span    Span to search within
+ * @param pattern    Glob pattern
+ * @param in_cursor  Starting position (NULL to start from beginning)
+ * @param out_cursor Output cursor position after match (NULL to ignore)
+ * @param out_span   Output span for the found element
+ *
+ * @return YATL_OK if found
+ * @return YATL_ERR_NOT_FOUND if no more matches
+ * @return YATL_ERR_INVALID_ARG if required parameters are NULL/uninitialized
+ *
+ * @code
+ * YATL_Cursor_t cursor = YATL_cursor_create();
+ * YATL_Span_t kv;
+ * while (YATL_span_find_next_matching(&table_span, "limit.*", &cursor,
+ *                                     &cursor, &kv) == YATL_OK) {
+ *     // Process each limit.<name> key
+ * }
+ * @endcode
+ */
+YATL_Result_t YATL_span_find_next_matching(const YATL_Span_t *in_span,
+                                           const char *pattern,
+                                           const YATL_Cursor_t *in_cursor,
+                                           YATL_Cursor_t *out_cursor,
+                                           YATL_Span_t *out_span);
+
 /**
  * @brief Iterate over line segments within a span.
  * @ingroup yatl_span_nav
@@ -559,6 +1172,29 @@ YATL_SpanType_t YATL_span_type(const YATL_Span_t *span);
 YATL_Result_t YATL_span_text(const YATL_Span_t *in_span, const char **out_text,
                              size_t *out_len);
 
+/**
+ * @brief Copy a span's TOML source into a caller buffer.
+ * @ingroup yatl_span_query
+ *
+ * Copies the span's lexical text, quotes included, with lines joined by
+ * `\n` and a terminating NUL. A table span runs up to the next header and so
+ * ends with a newline; a key-value or value span does not, and leaves out a
+ * trailing comment.
+ * Sizing works as in YATL_doc_dumps().
+ *
+ * @param span    Span to serialize
+ * @param buf     Output buffer (may be NULL when cap is 0)
+ * @param cap     Capacity of buf in bytes
+ * @param out_len Output length, excluding the terminating NUL. Set even when
+ *                the buffer is too small.
+ *
+ * @return YATL_OK on success; buf holds out_len bytes plus a NUL
+ * @return YATL_ERR_BUFFER if cap < out_len + 1 (buf is not written)
+ * @return YATL_ERR_INVALID_ARG if any parameter is NULL/uninitialized
+ */
+YATL_Result_t YATL_span_dumps(const YATL_Span_t *span, char *buf, size_t cap,
+                              size_t *out_len);
+
 /**
  * @brief Convenience function to find a key and get its string value.
  * @ingroup yatl_span_query
@@ -587,6 +1223,228 @@ YATL_Result_t YATL_span_text(const YATL_Span_t *in_span, const char **out_text,
 YATL_Result_t YATL_span_get_string(const YATL_Span_t *in_span, const char *key,
                                    const char **out_text, size_t *out_len);
 
+/**
+ * @brief Get a string value without copying, if it needs no decoding.
+ * @ingroup yatl_span_query
+ *
+ * Checks whether the string's content can be used exactly as it appears in
+ * the document: literal strings, and basic strings without escapes, that
+ * fit on one line. The check is a single memchr() for a backslash. When
+ * it fails, use YATL_span_get_string_decoded().
+ *
+ * @param span     Value span, or key-value span whose value is read
+ * @param out_text Output pointer into the document (not NUL-terminated)
+ * @param out_len  Output length in bytes
+ *
+ * @return YATL_OK if out_text holds the string's value
+ * @return YATL_ERR_BUFFER if the string contains escapes or spans several
+ * lines and must be decoded into a buffer
+ * @return YATL_ERR_TYPE if the value is not a string
+ * @return YATL_ERR_INVALID_ARG if any parameter is NULL/uninitialized
+ */
+YATL_Result_t YATL_span_get_string_view(const YATL_Span_t *span,
+                                        const char **out_text,
+                                        size_t *out_len);
+
+/**
+ * @brief Decode a string value into a caller buffer.
+ * @ingroup yatl_span_query
+ *
+ * Handles basic, literal and multi-line strings: escape sequences
+ * (including `\uXXXX` and `\UXXXXXXXX`, encoded as UTF-8), the newline
+ * right after an opening `"""` or `'''`, and line-ending backslashes,
+ * which remove the line break and the whitespace that follows. Lines of a
+ * multi-line string are joined with `\n`. Runs without escapes are found
+ * with memchr() and copied with memcpy().
+ *
+ * @param span    Value span, or key-value span whose value is read
+ * @param buf     Output buffer (may be NULL when cap is 0)
+ * @param cap     Capacity of buf in bytes
+ * @param out_len Output decoded length, excluding the terminating NUL. Set
+ *                even when the buffer is too small, so a call with cap 0
+ *                sizes the buffer.
+ *
+ * @return YATL_OK on success; buf holds out_len bytes plus a NUL
+ * @return YATL_ERR_BUFFER if cap < out_len + 1 (buf holds a prefix)
+ * @return YATL_ERR_SYNTAX if the string contains an invalid escape
+ * @return YATL_ERR_TYPE if the value is not a string
+ * @return YATL_ERR_INVALID_ARG if any parameter is NULL/uninitialized
+ *
+ * @code
+ * const char *text;
+ * size_t len;
+ * char buf[256];
+ * if (YATL_span_get_string_view(&kv, &text, &len) != YATL_OK &&
+ *     YATL_span_get_string_decoded(&kv, buf, sizeof(buf), &len) == YATL_OK)
+ *     text = buf;
+ * @endcode
+ */
+YATL_Result_t YATL_span_get_string_decoded(const YATL_Span_t *span, char *buf,
+                                           size_t cap, size_t *out_len);
+
+/**
+ * @brief Read an integer value.
+ * @ingroup yatl_span_query
+ *
+ * Parses the TOML integer directly from the document text: decimal with
+ * optional sign, `0x`, `0o` and `0b` prefixes, and `_` between digits.
+ *
+ * @param span      Value span, or key-value span whose value is read
+ * @param out_value Output integer
+ *
+ * @return YATL_OK on success
+ * @return YATL_ERR_TYPE if the value is not a well-formed integer or does
+ * not fit in int64_t
+ * @return YATL_ERR_INVALID_ARG if any parameter is NULL/uninitialized
+ */
+YATL_Result_t YATL_span_get_int64(const YATL_Span_t *span, int64_t *out_value);
+
+/**
+ * @brief Read a floating-point value.
+ * @ingroup yatl_span_query
+ *
+ * Parses TOML floats (fraction and/or exponent, `_` between digits,
+ * `inf`, `nan` with optional sign) and integers directly from the
+ * document text. Results are correctly rounded and independent of the
+ * C locale.
+ *
+ * @param span      Value span, or key-value span whose value is read
+ * @param out_value Output value
+ *
+ * @return YATL_OK on success
+ * @return YATL_ERR_TYPE if the value is not a well-formed number
+ * @return YATL_ERR_INVALID_ARG if any parameter is NULL/uninitialized
+ */
+YATL_Result_t YATL_span_get_double(const YATL_Span_t *span, double *out_value);
+
+/**
+ * @brief Read a boolean value.
+ * @ingroup yatl_span_query
+ *
+ * @param span      Value span, or key-value span whose value is read
+ * @param out_value Output value
+ *
+ * @return YATL_OK on success
+ * @return YATL_ERR_TYPE if the value is neither `true` nor `false`
+ * @return YATL_ERR_INVALID_ARG if any parameter is NULL/uninitialized
+ */
+YATL_Result_t YATL_span_get_bool(const YATL_Span_t *span, bool *out_value);
+
+/**
+ * @brief Read a datetime value.
+ * @ingroup yatl_span_query
+ *
+ * Decodes any of the four TOML datetime forms from the document text
+ * with a fixed-layout parser: no allocation, no locale, no strptime.
+ * Date and time may be separated by `T`, `t` or a space; fractional
+ * seconds and `Z`/`z` or `+HH:MM`/`-HH:MM` offsets are accepted.
+ *
+ * @param span      Value span, or key-value span whose value is read
+ * @param out_value Output datetime
+ *
+ * @return YATL_OK on success
+ * @return YATL_ERR_TYPE if the value is not a valid datetime (including
+ * out-of-range fields such as February 30)
+ * @return YATL_ERR_INVALID_ARG if any parameter is NULL/uninitialized
+ */
+YATL_Result_t YATL_span_get_datetime(const YATL_Span_t *span,
+                                     YATL_DateTime_t *out_value);
+
+/**
+ * @brief Decode an array of integers into a C array.
+ * @ingroup yatl_span_query
+ *
+ * Reads every element in one pass over the document text, without
+ * creating a span per element. Elements follow the rules of
+ * YATL_span_get_int64(); comments and newlines inside the array are
+ * allowed.
+ *
+ * @param array Array value span, or key-value span whose value is read
+ * @param out   Output array (may be NULL when cap is 0)
+ * @param cap   Number of elements out can hold
+ * @param out_n Receives the number of elements in the array, even when it
+ *              exceeds cap
+ *
+ * @return YATL_OK on success
+ * @return YATL_ERR_BUFFER if the array has more than cap elements; the
+ *         first cap are written
+ * @return YATL_ERR_TYPE if the value is not an array or an element is not
+ *         an integer
+ * @return YATL_ERR_SYNTAX if the array is malformed
+ * @return YATL_ERR_INVALID_ARG if any parameter is NULL/uninitialized
+ *
+ * @code
+ * int64_t ports[16];
+ * size_t n;
+ * if (YATL_span_array_get_int64s(&kv, ports, 16, &n) == YATL_OK)
+ *     for (size_t i = 0; i < n; i++)
+ *         listen_on(ports[i]);
+ * @endcode
+ */
+YATL_Result_t YATL_span_array_get_int64s(const YATL_Span_t *array,
+                                         int64_t *out, size_t cap,
+                                         size_t *out_n);
+
+/**
+ * @brief Decode an array of numbers into a C array of doubles.
+ * @ingroup yatl_span_query
+ *
+ * As YATL_span_array_get_int64s(), with elements read by the rules of
+ * YATL_span_get_double(), so integers and floats may be mixed.
+ *
+ * @param array Array value span, or key-value span whose value is read
+ * @param out   Output array (may be NULL when cap is 0)
+ * @param cap   Number of elements out can hold
+ * @param out_n Receives the number of elements in the array, even when it
+ *              exceeds cap
+ *
+ * @return YATL_OK on success
+ * @return YATL_ERR_BUFFER if the array has more than cap elements; the
+ *         first cap are written
+ * @return YATL_ERR_TYPE if the value is not an array or an element is not
+ *         a number
+ * @return YATL_ERR_SYNTAX if the array is malformed
+ * @return YATL_ERR_INVALID_ARG if any parameter is NULL/uninitialized
+ */
+YATL_Result_t YATL_span_array_get_doubles(const YATL_Span_t *array,
+                                          double *out, size_t cap,
+                                          size_t *out_n);
+
+/**
+ * @brief Look up many keys in a single pass over a span.
+ * @ingroup yatl_span_query
+ *
+ * Walks in_span once, matching each key-value against a small hash of the
+ * requested names, instead of rescanning the span for every key as
+ * repeated YATL_span_get_string() calls do. Cost is O(span size + nkeys).
+ *
+ * @param in_span     Span to search within (document, table or inline table)
+ * @param keys        Array of key names (literal match, as
+ *                    YATL_span_find_name())
+ * @param nkeys       Number of entries in keys
+ * @param out_spans   Output array of nkeys value spans, as returned by
+ *                    YATL_span_keyval_slice(). Entries whose result is not
+ *                    YATL_OK are left untouched.
+ * @param out_results Output array of nkeys per-key results: YATL_OK,
+ *                    YATL_ERR_NOT_FOUND, or the slicing error
+ *
+ * @return YATL_OK if every key was found
+ * @return YATL_ERR_NOT_FOUND if at least one key is missing (see out_results)
+ * @return YATL_ERR_NOMEM if memory allocation fails (very large nkeys only)
+ * @return YATL_ERR_INVALID_ARG if any parameter is NULL/uninitialized
+ *
+ * @code
+ * const char *keys[] = {"host", "port", "user"};
+ * YATL_Span_t vals[3];
+ * YATL_Result_t results[3];
+ * YATL_span_get_many(&table_span, keys, 3, vals, results);
+ * @endcode
+ */
+YATL_Result_t YATL_span_get_many(const YATL_Span_t *in_span,
+                                 const char *const keys[], size_t nkeys,
+                                 YATL_Span_t out_spans[],
+                                 YATL_Result_t out_results[]);
+
 /**
  * @brief Set the value of a span, supporting multi-line values.
  * @ingroup yatl_span_modify
@@ -637,3 +1495,311 @@ YATL_Result_t YATL_span_ml_set_value(YATL_Span_t *span, const char **lines,
 
 YATL_Result_t YATL_span_set_value(YATL_Span_t *span, const char *value,
                                   size_t length);
+
+/**
+ * @brief Replace a value with an integer.
+ * @ingroup yatl_span_modify
+ *
+ * Unlike YATL_span_set_value(), the typed setters replace the whole value
+ * including quotes or brackets, so the value's type may change. Comments
+ * and other text around the value are kept. The operation is atomic.
+ *
+ * @param span  Value span, or key-value span whose value is replaced;
+ *              updated to cover the new value
+ * @param value New value, written in decimal
+ *
+ * @return YATL_OK on success
+ * @return YATL_ERR_TYPE if span is not a value or key-value span
+ * @return YATL_ERR_NOMEM if memory allocation fails
+ * @return YATL_ERR_INVALID_ARG if span is NULL/uninitialized
+ */
+YATL_Result_t YATL_span_set_int64(YATL_Span_t *span, int64_t value);
+
+/**
+ * @brief Replace a value with a float.
+ * @ingroup yatl_span_modify
+ *
+ * Writes 15 significant digits if they read back as exactly the same
+ * double, otherwise 17, which always do. Trailing zeros are dropped and a
+ * '.' or exponent is always present (`1.0`, `0.1`, `1e+300`). Infinity
+ * and NaN become `inf`, `-inf` and `nan`. See YATL_span_set_int64().
+ *
+ * @param span  Value span, or key-value span whose value is replaced
+ * @param value New value
+ *
+ * @return YATL_OK on success
+ * @return YATL_ERR_TYPE if span is not a value or key-value span
+ * @return YATL_ERR_NOMEM if memory allocation fails
+ * @return YATL_ERR_INVALID_ARG if span is NULL/uninitialized
+ */
+YATL_Result_t YATL_span_set_double(YATL_Span_t *span, double value);
+
+/**
+ * @brief Replace a value with `true` or `false`.
+ * @ingroup yatl_span_modify
+ *
+ * See YATL_span_set_int64().
+ *
+ * @param span  Value span, or key-value span whose value is replaced
+ * @param value New value
+ *
+ * @return YATL_OK on success
+ * @return YATL_ERR_TYPE if span is not a value or key-value span
+ * @return YATL_ERR_NOMEM if memory allocation fails
+ * @return YATL_ERR_INVALID_ARG if span is NULL/uninitialized
+ */
+YATL_Result_t YATL_span_set_bool(YATL_Span_t *span, bool value);
+
+/**
+ * @brief Replace a value with a string, quoting and escaping as needed.
+ * @ingroup yatl_span_modify
+ *
+ * Text that needs no escaping is written as a basic string. Text with
+ * quotes or backslashes but no apostrophes or control characters becomes a
+ * literal string; anything else is a basic string with escapes. The text is
+ * written as given and should be UTF-8. See YATL_span_set_int64().
+ *
+ * @param span Value span, or key-value span whose value is replaced
+ * @param str  Unescaped string content
+ * @param len  Length of str in bytes
+ *
+ * @return YATL_OK on success
+ * @return YATL_ERR_TYPE if span is not a value or key-value span
+ * @return YATL_ERR_NOMEM if memory allocation fails
+ * @return YATL_ERR_INVALID_ARG if span or str is NULL/uninitialized
+ *
+ * @code
+ * YATL_span_find_name(&doc_span, "path", &kv);
+ * YATL_span_set_string(&kv, "C:\\temp", 7); // path = 'C:\temp'
+ * @endcode
+ */
+YATL_Result_t YATL_span_set_string(YATL_Span_t *span, const char *str,
+                                   size_t len);
+
+/**
+ * @brief Add a key-value to a table.
+ * @ingroup yatl_span_modify
+ *
+ * Inserts `key = value` on a new line after the table's last key-value,
+ * with the same indentation, or directly after the header of an empty
+ * table. With the document span, the key-value goes before the first table
+ * header, or becomes the first line of an empty document. Only the new line is allocated; the rest of the document is not
+ * touched. Keys that are not bare are quoted.
+ *
+ * @param table  Table or array table span, or the document span; its end is
+ *               extended if the new line is appended after it
+ * @param key    Key name (unquoted)
+ * @param value  TOML text of a single-line value, e.g. `"\"text\""` or `"42"`
+ * @param out_kv Receives the new key-value span (may be NULL)
+ *
+ * @return YATL_OK on success
+ * @return YATL_ERR_SYNTAX if the key already exists, the key is empty, or
+ *         value is not a single TOML value
+ * @return YATL_ERR_TYPE if table is not a table or document span
+ * @return YATL_ERR_NOMEM if memory allocation fails
+ * @return YATL_ERR_INVALID_ARG if any parameter is NULL/uninitialized or
+ *         table belongs to no document
+ *
+ * @code
+ * YATL_span_find_name(&doc_span, "server", &table);
+ * YATL_span_insert_keyval(&table, "timeout", "30", NULL);
+ * @endcode
+ */
+YATL_Result_t YATL_span_insert_keyval(YATL_Span_t *table, const char *key,
+                                      const char *value, YATL_Span_t *out_kv);
+
+/**
+ * @brief Append a table header to the end of a document.
+ * @ingroup yatl_span_modify
+ *
+ * Adds `[name]`, preceded by a blank line unless the document is empty or
+ * already ends with one. The name is written as given, see "Dotted Table
+ * Names Are Literal". Document spans taken before the call do not cover
+ * the new table.
+ *
+ * @param doc       Pointer to document
+ * @param name      Table name as it appears between the brackets
+ * @param out_table Receives the new table span (may be NULL)
+ *
+ * @return YATL_OK on success
+ * @return YATL_ERR_SYNTAX if the name is not a valid (dotted) key, contains
+ *         brackets, '#' or a line break, or is already defined at
+ *         document level
+ * @return YATL_ERR_NOMEM if memory allocation fails
+ * @return YATL_ERR_INVALID_ARG if any parameter is NULL/uninitialized
+ */
+YATL_Result_t YATL_doc_append_table(YATL_Doc_t *doc, const char *name,
+                                    YATL_Span_t *out_table);
+
+/**
+ * @brief Append an element to an array.
+ * @ingroup yatl_span_modify
+ *
+ * Arrays on one line gain `, value` after the last element. Arrays written
+ * one element per line gain a new line with the last element's
+ * indentation, keeping its trailing comma style.
+ *
+ * @param array Array value span, or key-value span whose value is an array;
+ *              updated if its lines change
+ * @param value TOML text of a single-line value
+ *
+ * @return YATL_OK on success
+ * @return YATL_ERR_SYNTAX if value is not a single TOML value
+ * @return YATL_ERR_TYPE if the span is not an array
+ * @return YATL_ERR_NOMEM if memory allocation fails
+ * @return YATL_ERR_INVALID_ARG if any parameter is NULL/uninitialized
+ */
+YATL_Result_t YATL_span_array_append(YATL_Span_t *array, const char *value);
+
+/**
+ * @brief Remove a key-value, table, array element or comment.
+ * @ingroup yatl_span_modify
+ *
+ * Items that sit on their own lines are removed with those lines,
+ * including a trailing comment. Tables are removed up to the next header.
+ * Array elements and inline-table members sharing a line with other items
+ * are cut out together with one adjacent comma, so `[1, 2, 3]` becomes
+ * `[1, 3]` or `[1, 2]`. Only the affected lines are touched; the removed
+ * text stays in the boneyard until YATL_doc_clear_boneyard().
+ *
+ * After removal the span refers to boneyard lines and must not be used for
+ * lookups. Spans that started on a removed line, such as the document span
+ * when the first line is removed, must be taken again.
+ *
+ * @param span Span to remove
+ *
+ * @return YATL_OK on success
+ * @return YATL_ERR_TYPE if the span is the value of a key-value, a key,
+ *         or the document span
+ * @return YATL_ERR_SYNTAX if the item cannot be parsed
+ * @return YATL_ERR_NOMEM if memory allocation fails
+ * @return YATL_ERR_INVALID_ARG if span is NULL/uninitialized or already
+ *         removed
+ *
+ * @code
+ * YATL_Span_t kv;
+ * if (YATL_span_find_name(&routes, "old_route", &kv) == YATL_OK)
+ *     YATL_span_remove(&kv);
+ * @endcode
+ */
+YATL_Result_t YATL_span_remove(YATL_Span_t *span);
+
+/**
+ * @brief Start an edit transaction.
+ * @ingroup yatl_span_modify
+ *
+ * Edits made until YATL_txn_commit() or YATL_txn_abort() are applied
+ * immediately, so lookups see them, and are also journaled so the whole
+ * batch can be rolled back. Transactions do not nest.
+ *
+ * @param doc Pointer to document
+ *
+ * @return YATL_OK on success
+ * @return YATL_ERR_NOMEM if memory allocation fails
+ * @return YATL_ERR_INVALID_ARG if doc is NULL/uninitialized or a
+ *         transaction is already open
+ *
+ * @code
+ * YATL_txn_begin(&doc);
+ * for (size_t i = 0; i < npatch; i++) {
+ *     if (apply_patch(&doc, &patch[i]) != YATL_OK) {
+ *         YATL_txn_abort(&doc);
+ *         return;
+ *     }
+ * }
+ * YATL_txn_commit(&doc);
+ * @endcode
+ */
+YATL_Result_t YATL_txn_begin(YATL_Doc_t *doc);
+
+/**
+ * @brief Keep every edit made since YATL_txn_begin().
+ * @ingroup yatl_span_modify
+ *
+ * @param doc Pointer to document
+ *
+ * @return YATL_OK on success
+ * @return YATL_ERR_INVALID_ARG if doc is NULL/uninitialized or no
+ *         transaction is open
+ */
+YATL_Result_t YATL_txn_commit(YATL_Doc_t *doc);
+
+/**
+ * @brief Undo every edit made since YATL_txn_begin().
+ * @ingroup yatl_span_modify
+ *
+ * The original lines are relinked from the boneyard, restoring the document
+ * text exactly. Spans obtained before YATL_txn_begin() are valid again;
+ * spans obtained or updated during the transaction are not.
+ *
+ * @param doc Pointer to document
+ *
+ * @return YATL_OK on success
+ * @return YATL_ERR_INVALID_ARG if doc is NULL/uninitialized or no
+ *         transaction is open
+ */
+YATL_Result_t YATL_txn_abort(YATL_Doc_t *doc);
+
+/**
+ * @brief Keep an undo history of up to max_steps edits.
+ * @ingroup yatl_span_modify
+ *
+ * Each edit made outside a transaction, and each committed transaction as a
+ * whole, becomes one step. A step only records which line runs were swapped;
+ * the replaced lines already sit in the boneyard, so undo and redo relink
+ * lines in O(lines in the edit) and never copy the document. The oldest
+ * steps are dropped once there are more than max_steps.
+ *
+ * The history starts empty and is off (0) by default. Loading into the
+ * document resets it. Lowering the limit drops the steps that could be
+ * redone.
+ *
+ * @param doc       Pointer to document
+ * @param max_steps Number of steps kept, 0 to turn the history off
+ *
+ * @return YATL_OK on success
+ * @return YATL_ERR_NOMEM if memory allocation fails
+ * @return YATL_ERR_INVALID_ARG if doc is NULL/uninitialized
+ */
+YATL_Result_t YATL_doc_set_undo_limit(YATL_Doc_t *doc, size_t max_steps);
+
+/**
+ * @brief Revert the most recent edit step.
+ * @ingroup yatl_span_modify
+ *
+ * Restores the document text exactly as it was before the step. As after
+ * YATL_txn_abort(), spans obtained or updated since are no longer valid.
+ * YATL_doc_clear_boneyard() frees the lines the history refers to and so
+ * empties it.
+ *
+ * @param doc Pointer to document
+ *
+ * @return YATL_OK on success
+ * @return YATL_ERR_NOT_FOUND if there is nothing to undo
+ * @return YATL_ERR_INVALID_ARG if doc is NULL/uninitialized or a
+ *         transaction is open
+ *
+ * Example:
+ * @code
+ * YATL_doc_set_undo_limit(&doc, 100);
+ * YATL_span_set_int64(&port_kv, 8443);
+ * YATL_doc_undo(&doc); // port is back to its old value
+ * YATL_doc_redo(&doc); // and 8443 again
+ * @endcode
+ */
+YATL_Result_t YATL_doc_undo(YATL_Doc_t *doc);
+
+/**
+ * @brief Reapply the most recently undone edit step.
+ * @ingroup yatl_span_modify
+ *
+ * Any new edit after an undo drops the steps that could be redone.
+ *
+ * @param doc Pointer to document
+ *
+ * @return YATL_OK on success
+ * @return YATL_ERR_NOT_FOUND if there is nothing to redo
+ * @return YATL_ERR_INVALID_ARG if doc is NULL/uninitialized or a
+ *         transaction is open
+ */
+YATL_Result_t YATL_doc_redo(YATL_Doc_t *doc);
@@ -13,6 +13,8 @@ static_assert(sizeof(_YATL_Span_t) <= YATL_SPAN_SIZE,
 static_assert(sizeof(_YATL_Doc_t) <= YATL_DOC_SIZE, "YATL_DOC_SIZE too small");
 static_assert(sizeof(_YATL_Line_t) <= YATL_LINE_SIZE,
               "YATL_LINE_SIZE too small");
+static_assert(sizeof(_YATL_Query_t) <= YATL_QUERY_SIZE,
+              "YATL_QUERY_SIZE too small");
 
 // ---------------------------------------------------------------------
 // Structure initialization
@@ -55,9 +57,16 @@ _YATL_Line_t *_line_alloc(const char *text, size_t len) {
   if (text)
     memcpy(line->text, text, len);
   line->len = len;
+  line->origin_line = 0;
+  line->origin = SIZE_MAX;
   line->prev = NULL;
   line->next = NULL;
   line->doc = NULL; // Set when added to doc
+  line->next_header = NULL;
+  line->is_header = false; // Classified by _line_index_repair when linked
+  line->name_hashed = false;
+  line->name_nsegs = 0;
+  line->name_hash = 0;
   return line;
 }
 
@@ -132,6 +141,7 @@ void _line_relink(_YATL_Doc_t *doc, _YATL_Line_t *line, _YATL_Line_t *before) {
   }
 
   line->doc = doc;
+  doc->gen++;
 }
 
 // Unlinks line from document and adds to boneyard (deferred free)
@@ -158,10 +168,28 @@ void _line_unlink(_YATL_Line_t *line) {
   // Add to boneyard
   line->next = NULL;
   _boneyard_append(doc, line);
+  doc->gen++;
+}
+
+void _line_index_repair(_YATL_Line_t *line, size_t nforce) {
+  for (; line; line = line->prev) {
+    _YATL_Line_t *next = line->next;
+    _YATL_Line_t *nh = !next             ? NULL
+                       : next->is_header ? next
+                                         : next->next_header;
+    if (nforce > 0) {
+      nforce--;
+      line->is_header = line->len > 0 && line->text[0] == '[';
+    } else if (line->next_header == nh) {
+      break; // everything before is still consistent
+    }
+    line->next_header = nh;
+  }
 }
 
 static void _doc_append_line(_YATL_Doc_t *doc, _YATL_Line_t *line) {
   line->doc = doc; // Set back-pointer
+  doc->gen++;
   if (!doc->head) {
     doc->head = line;
     doc->tail = line;
@@ -201,6 +229,11 @@ void YATL_doc_free(YATL_Doc_t *doc) {
     line = next;
   }
 
+  _span_index_free(_doc);
+  _journal_free(_doc->txn);
+  _doc->txn = NULL;
+  _history_free(_doc->history);
+  _doc->history = NULL;
   _doc->head = NULL;
   _doc->tail = NULL;
   _doc->boneyard_head = NULL;
@@ -215,60 +248,141 @@ YATL_Result_t YATL_doc_clear_boneyard(YATL_Doc_t *doc) {
   YATL_Result_t res = _YATL_check_doc(_doc);
   if (res != YATL_OK)
     return res;
+  if (_doc->txn)
+    return YATL_ERR_INVALID_ARG; // abort would relink freed lines
+  if (_doc->frozen)
+    return YATL_ERR_INVALID_ARG; // YATL_doc_diff may be reading them
   _YATL_Line_t *line = _doc->boneyard_head;
   while (line) {
     _YATL_Line_t *next = line->next;
+    if (line->origin_line)
+      _doc->origin_lost = true;
     _line_free(line);
     line = next;
   }
   _doc->boneyard_head = NULL;
   _doc->boneyard_tail = NULL;
+  _history_clear(_doc->history); // its steps refer to the freed lines
   return YATL_OK;
 }
 
-YATL_Result_t YATL_doc_loads(YATL_Doc_t *doc, const char *str, size_t str_len) {
+// Returns the offset of the first byte of the first invalid UTF-8 sequence,
+// or len if the text is valid. Overlong forms, surrogates and code points
+// above U+10FFFF are rejected. Runs of ASCII are skipped eight bytes at a
+// time.
+static size_t _utf8_invalid_at(const unsigned char *s, size_t len) {
+  size_t i = 0;
+  while (i < len) {
+    while (i + 8 <= len) {
+      uint64_t w;
+      memcpy(&w, s + i, sizeof(w));
+      if (w & UINT64_C(0x8080808080808080))
+        break;
+      i += 8;
+    }
+    if (i >= len)
+      break;
+
+    unsigned char c = s[i];
+    if (c < 0x80) {
+      i++;
+      continue;
+    }
+
+    // Lead byte picks the length and the allowed range of the second byte
+    size_t n;
+    unsigned char lo = 0x80, hi = 0xBF;
+    if (c >= 0xC2 && c <= 0xDF) {
+      n = 2;
+    } else if (c >= 0xE0 && c <= 0xEF) {
+      n = 3;
+      if (c == 0xE0)
+        lo = 0xA0; // overlong
+      else if (c == 0xED)
+        hi = 0x9F; // surrogates
+    } else if (c >= 0xF0 && c <= 0xF4) {
+      n = 4;
+      if (c == 0xF0)
+        lo = 0x90; // overlong
+      else if (c == 0xF4)
+        hi = 0x8F; // above U+10FFFF
+    } else {
+      return i;
+    }
+
+    if (len - i < n || s[i + 1] < lo || s[i + 1] > hi)
+      return i;
+    for (size_t k = 2; k < n; k++) {
+      if ((s[i + k] & 0xC0) != 0x80)
+        return i;
+    }
+    i += n;
+  }
+  return len;
+}
+
+YATL_Result_t YATL_doc_loads_ex(YATL_Doc_t *doc, const char *str,
+                                size_t str_len, unsigned flags,
+                                size_t *out_bad_offset) {
   if (!doc || !str)
-    return YATL_ERR_NOMEM;
+    return YATL_ERR_INVALID_ARG;
   *doc = YATL_doc_create();
   _YATL_Doc_t *_doc = (_YATL_Doc_t *)doc;
+  bool validate = flags & YATL_LOAD_VALIDATE_UTF8;
 
   const char *line_start = str;
   const char *end = str + str_len;
-
-  for (const char *p = str; p < end; p++) {
-    if (*p == '\n') {
-      size_t len = p - line_start;
-      if (len > 0 && line_start[len - 1] == '\r') // no windows newline
-        len--;
-
-      _YATL_Line_t *line = _line_alloc(line_start, len); // no newline
-      if (!line) {
+  uint32_t nlines = 0;
+
+  while (line_start < end) {
+    const char *nl = memchr(line_start, '\n', end - line_start);
+    const char *line_end = nl ? nl : end;
+    size_t len = line_end - line_start;
+
+    // Validate while the line is still hot in cache
+    if (validate) {
+      size_t bad = _utf8_invalid_at((const unsigned char *)line_start, len);
+      if (bad != len) {
+        if (out_bad_offset)
+          *out_bad_offset = (line_start - str) + bad;
         YATL_doc_free(doc);
-        return YATL_ERR_NOMEM;
+        return YATL_ERR_ENCODING;
       }
-      _doc_append_line(_doc, line);
-      line_start = p + 1;
     }
-  }
 
-  // Last line
-  if (end > line_start) {
-    size_t len = end - line_start;
-    if (len > 0 && line_start[len - 1] == '\r')
+    // Only lines ending in a bare newline are stored as YATL_doc_save would
+    // write them, so only those keep their origin
+    bool as_saved = nl && !(len > 0 && line_start[len - 1] == '\r');
+    if (len > 0 && line_start[len - 1] == '\r') // no windows newline
       len--;
 
-    _YATL_Line_t *line = _line_alloc(line_start, len);
+    _YATL_Line_t *line = _line_alloc(line_start, len); // no newline
     if (!line) {
       YATL_doc_free(doc);
       return YATL_ERR_NOMEM;
     }
+    line->origin_line = ++nlines;
+    if (as_saved)
+      line->origin = line_start - str;
     _doc_append_line(_doc, line);
+    if (!nl)
+      break;
+    line_start = nl + 1;
   }
 
+  _doc->origin_size = str_len;
+
+  // Build the header index in one backward pass
+  _line_index_repair(_doc->tail, SIZE_MAX);
   return YATL_OK;
 }
 
-YATL_Result_t YATL_doc_load(YATL_Doc_t *doc, const char *path) {
+YATL_Result_t YATL_doc_loads(YATL_Doc_t *doc, const char *str, size_t str_len) {
+  return YATL_doc_loads_ex(doc, str, str_len, YATL_LOAD_DEFAULT, NULL);
+}
+
+YATL_Result_t YATL_doc_load_ex(YATL_Doc_t *doc, const char *path,
+                               unsigned flags, size_t *out_bad_offset) {
   if (!doc || !path)
     return YATL_ERR_IO;
 
@@ -276,6 +390,13 @@ YATL_Result_t YATL_doc_load(YATL_Doc_t *doc, const char *path) {
   if (!f)
     return YATL_ERR_IO;
 
+#ifdef _YATL_HAVE_WRITEV
+  // Taken before reading, so a write racing the load changes the
+  // modification time and the next incremental save rewrites the file
+  _YATL_FileId_t file;
+  _file_id_get(fileno(f), &file);
+#endif
+
   fseek(f, 0, SEEK_END);
   long size = ftell(f);
   fseek(f, 0, SEEK_SET);
@@ -294,12 +415,21 @@ YATL_Result_t YATL_doc_load(YATL_Doc_t *doc, const char *path) {
   size_t nread = fread(buf, 1, size, f);
   fclose(f);
 
-  YATL_Result_t err = YATL_doc_loads(doc, buf, nread);
+  YATL_Result_t err =
+      YATL_doc_loads_ex(doc, buf, nread, flags, out_bad_offset);
   free(buf);
+#ifdef _YATL_HAVE_WRITEV
+  if (err == YATL_OK)
+    ((_YATL_Doc_t *)doc)->origin_file = file;
+#endif
 
   return err;
 }
 
+YATL_Result_t YATL_doc_load(YATL_Doc_t *doc, const char *path) {
+  return YATL_doc_load_ex(doc, path, YATL_LOAD_DEFAULT, NULL);
+}
+
 // Helper: check if cursor is past boundary
 static inline bool _cursor_past(_YATL_Line_t *line, size_t pos,
                                 const _YATL_Cursor_t *bound) {
@@ -386,6 +516,130 @@ static inline bool _consume_bool(bool *b) {
   return false;
 }
 
+// Records '=' and value boundaries of a keyval found by find_next so
+// YATL_span_keyval_slice need not re-lex the value. The key is not parsed
+// here; _keyval_cache_key does that once a caller wants it. eq is the
+// cursor at '=', val_end the lexical end of the value. The cache is left
+// unset when a boundary is not on the line the cache layout expects;
+// readers then fall back to re-parsing.
+static void _keyval_cache_fill(_YATL_Span_t *span, const _YATL_Cursor_t *eq,
+                               const _YATL_Cursor_t *val_end) {
+  span->kv.cached = false;
+  _YATL_Line_t *line = span->c_start.line;
+  if (eq->line != line || val_end->line != span->c_end.line ||
+      line->len > UINT32_MAX || val_end->line->len > UINT32_MAX)
+    return;
+
+  _YATL_Cursor_t val = *eq;
+  val.pos++; // skip =
+  if (_skipWS(&val) != YATL_OK || val.line != line)
+    return;
+
+  const char *t = line->text + val.pos;
+  size_t rem = line->len - val.pos;
+  _YATL_ValueKind_t kind = _YATL_VK_BARE;
+  if (rem >= 3 && ((t[0] == '"' && t[1] == '"' && t[2] == '"') ||
+                   (t[0] == '\'' && t[1] == '\'' && t[2] == '\'')))
+    kind = _YATL_VK_STRING_ML;
+  else if (t[0] == '"' || t[0] == '\'')
+    kind = _YATL_VK_STRING;
+  else if (t[0] == '[')
+    kind = _YATL_VK_ARRAY;
+  else if (t[0] == '{')
+    kind = _YATL_VK_INLINE_TABLE;
+
+  span->kv.eq = eq->pos;
+  span->kv.val_start = val.pos;
+  span->kv.val_end = val_end->pos;
+  span->kv.val_kind = kind;
+  span->kv.key_parsed = false;
+  span->kv.cached = true;
+}
+
+// Parses the key of a cached keyval the first time it is needed and keeps
+// its bounds in the cache. Only the raw key, c_start up to '=', is scanned.
+static YATL_Result_t _keyval_cache_key(_YATL_Span_t *span) {
+  if (span->kv.key_parsed)
+    return YATL_OK;
+  _YATL_Span_t raw_key = _YATL_EMPTY_SPAN;
+  raw_key.type = YATL_S_SLICE_KEY;
+  raw_key.c_start = span->c_start;
+  raw_key.c_end = span->c_start;
+  raw_key.c_end.pos = span->kv.eq;
+  _YATL_Span_t key;
+  YATL_ValueType_t key_type;
+  YATL_Result_t res = _toml_key_parse(&raw_key, &key, &key_type);
+  if (res != YATL_OK)
+    return res;
+
+  bool quoted = key.s_c_start.line != NULL;
+  span->kv.key_start = quoted ? key.s_c_start.pos : key.c_start.pos;
+  span->kv.key_end = quoted ? key.s_c_end.pos : key.c_end.pos;
+  span->kv.key_quoted = quoted;
+  span->kv.key_parsed = true;
+  return YATL_OK;
+}
+
+// Builds key and value spans from the keyval cache. Produces the same spans
+// as _toml_key_parse and _toml_value_parse would.
+static YATL_Result_t _keyval_cache_slice(const _YATL_Span_t *span,
+                                         _YATL_Span_t *key,
+                                         _YATL_Span_t *val) {
+  _YATL_Span_t parsed;
+  if (!span->kv.key_parsed) {
+    parsed = *span; // a const span cannot keep the result
+    YATL_Result_t res = _keyval_cache_key(&parsed);
+    if (res != YATL_OK)
+      return res;
+    span = &parsed;
+  }
+
+  _YATL_Cursor_t cr = span->c_start;
+  cr.complete = false;
+
+  *key = _YATL_EMPTY_SPAN;
+  key->type = YATL_S_SLICE_KEY;
+  key->c_start = cr;
+  key->c_start.pos = span->kv.key_start;
+  key->c_end = cr;
+  key->c_end.pos = span->kv.key_end;
+  if (span->kv.key_quoted) {
+    key->s_c_start = key->c_start;
+    key->s_c_end = key->c_end;
+    key->c_start.pos--; // opening quote
+    key->c_end.pos++;   // closing quote
+  }
+
+  *val = _YATL_EMPTY_SPAN;
+  val->type = YATL_S_SLICE_VALUE;
+  val->c_start = cr;
+  val->c_start.pos = span->kv.val_start;
+  val->c_end = span->c_end;
+  val->c_end.complete = false;
+  val->c_end.pos = span->kv.val_end;
+  switch ((_YATL_ValueKind_t)span->kv.val_kind) {
+  case _YATL_VK_BARE:
+    val->s_c_start = val->c_start;
+    val->s_c_end = val->c_end;
+    break;
+  case _YATL_VK_STRING:
+    val->s_c_start = val->c_start;
+    val->s_c_start.pos++;
+    val->s_c_end = val->c_end;
+    val->s_c_end.pos--;
+    break;
+  case _YATL_VK_STRING_ML:
+    break;
+  case _YATL_VK_ARRAY:
+    val->type = YATL_S_NODE_ARRAY;
+    break;
+  case _YATL_VK_INLINE_TABLE:
+    val->type = YATL_S_NODE_INLINE_TABLE;
+    break;
+  }
+  return YATL_OK;
+}
+
 static inline bool _valid_for_find_next(const _YATL_Span_t *span) {
   switch (span->type) {
   case YATL_S_LEAF_COMMENT:
@@ -455,6 +709,14 @@ YATL_Result_t YATL_span_find_next(const YATL_Span_t *in_span,
       _skipWS(&cr);
     }
 
+    // Comments may sit between elements
+    while (cr.line && cr.pos < cr.line->len && cr.line->text[cr.pos] == '#') {
+      cr.line = cr.line->next;
+      cr.pos = 0;
+      if (cr.line)
+        _skipWS(&cr);
+    }
+
     if (!cr.line || cr.pos >= cr.line->len)
       return YATL_ERR_NOT_FOUND;
 
@@ -474,7 +736,7 @@ YATL_Result_t YATL_span_find_next(const YATL_Span_t *in_span,
     // NOTE: Order matters - can't combine into skipany(" \t,") or we'd skip
     // into the next element's leading content.
     _skipWS(&cr);
-    _skipany(&cr, ",");
+    _skipany(&cr, _CC_COMMA);
     _out_span->c_end = cr; // Lexical end includes comma/whitespace
     _skipWS(&cr);
 
@@ -511,15 +773,18 @@ YATL_Result_t YATL_span_find_next(const YATL_Span_t *in_span,
     res = _consume(&cr, _TOML_KEY);
     if (res != YATL_OK)
       return res;
+    _YATL_Cursor_t eq = cr;
     cr.pos++; // Skip =
     res = _consume(&cr, _TOML_VALUE);
     if (res != YATL_OK)
       return res;
+    _YATL_Cursor_t val_end = cr;
 
     // Skip whitespace, comma, whitespace
     _skipWS(&cr);
-    _skipany(&cr, ",");
+    _skipany(&cr, _CC_COMMA);
     _out_span->c_end = cr; // End to include comma/whitespace
+    _keyval_cache_fill(_out_span, &eq, &val_end);
     _skipWS(&cr);
 
     if (out_cursor)
@@ -543,6 +808,11 @@ next_span:
 
   // === Table [[...]] or [...] at line start ===
   if (c == '[') {
+    // Inside a table only its own header is skipped; any other header is
+    // the start of the next table and ends the iteration.
+    if (!skip_first && (_in_span->type == YATL_S_NODE_TABLE ||
+                        _in_span->type == YATL_S_NODE_ARRAY_TABLE))
+      return YATL_DONE;
     _out_span->c_start = cr;
 
     if (c1 == '[') {
@@ -592,12 +862,13 @@ next_span:
   }
 
   // === Keyval (bare key or quoted key) ===
-  if (_is_bare_key_char(c) || c == '"' || c == '\'') {
+  if (_is_class(c, _CC_BARE | _CC_QUOTE)) {
     _out_span->type = YATL_S_LEAF_KEYVAL;
     _out_span->c_start = cr;
     res = _consume(&cr, _TOML_KEY);
     if (res != YATL_OK)
       return res;
+    _YATL_Cursor_t eq = cr;
     cr.pos++; // Skip = (key ends at =, need to move past it)
     res = _consume(&cr, _TOML_VALUE);
     if (res != YATL_OK)
@@ -605,6 +876,7 @@ next_span:
     _out_span->c_end = cr;
     if (_consume_bool(&skip_first))
       goto next_span;
+    _keyval_cache_fill(_out_span, &eq, &cr);
     if (out_cursor)
       *out_cursor = cr;
     return YATL_OK;
@@ -630,6 +902,7 @@ YATL_Result_t YATL_doc_span(const YATL_Doc_t *doc, YATL_Span_t *out_span) {
   // Initialize from template (sets magic, NULL lines for s_c_start/s_c_end)
   *_out_span = _YATL_EMPTY_SPAN;
   _out_span->type = YATL_S_NONE;
+  _out_span->doc = (_YATL_Doc_t *)_doc;
   _out_span->c_start.line = _doc->head;
   _out_span->c_start.pos = 0;
 
@@ -647,8 +920,9 @@ YATL_Result_t YATL_doc_span(const YATL_Doc_t *doc, YATL_Span_t *out_span) {
 // Helper: extract name from a TABLE or KEYVAL span
 // For TABLE: extracts between [ and ] (or [[ and ]])
 // For KEYVAL: use internal API to extract key
-// Returns pointer into the line text (not null-terminated), sets out_len
-static const char *_span_get_name(const _YATL_Span_t *span, size_t *out_len) {
+// Returns pointer into the line text (not null-terminated), sets out_len.
+// A keyval's key bounds are kept in its cache.
+static const char *_span_get_name(_YATL_Span_t *span, size_t *out_len) {
   if (!span || !span->c_start.line)
     return NULL;
 
@@ -682,6 +956,13 @@ static const char *_span_get_name(const _YATL_Span_t *span, size_t *out_len) {
     return text + start;
   }
 
+  if (span->type == YATL_S_LEAF_KEYVAL && span->kv.cached) {
+    if (_keyval_cache_key(span) != YATL_OK)
+      return NULL;
+    *out_len = span->kv.key_end - span->kv.key_start;
+    return text + span->kv.key_start;
+  }
+
   if (span->type == YATL_S_LEAF_KEYVAL) {
     _YATL_Cursor_t cr_start = span->c_start;
     _YATL_Cursor_t cr_end = cr_start;
@@ -752,7 +1033,7 @@ YATL_Result_t YATL_span_find_next_by_name(const YATL_Span_t *in_span,
       if (span_name && span_name_len == name_len &&
           memcmp(span_name, name, name_len) == 0) {
         if (out_cursor) {
-          *out_cursor = *c;
+          *(_YATL_Cursor_t *)out_cursor = _c;
         }
         return YATL_OK;
       }
@@ -763,11 +1044,459 @@ YATL_Result_t YATL_span_find_next_by_name(const YATL_Span_t *in_span,
   return YATL_ERR_NOT_FOUND;
 }
 
+// Matches name[0..name_len) against a glob where '*' matches any run of
+// characters and '?' any single one. Backtracks only to the last '*', so
+// the cost is linear for patterns with a single star.
+static bool _glob_match(const char *pat, size_t pat_len, const char *name,
+                        size_t name_len) {
+  size_t p = 0, n = 0;
+  size_t star_p = SIZE_MAX, star_n = 0;
+  while (n < name_len) {
+    if (p < pat_len && (pat[p] == '?' || pat[p] == name[n])) {
+      p++;
+      n++;
+    } else if (p < pat_len && pat[p] == '*') {
+      star_p = p++;
+      star_n = n;
+    } else if (star_p != SIZE_MAX) {
+      p = star_p + 1;
+      n = ++star_n;
+    } else {
+      return false;
+    }
+  }
+  while (p < pat_len && pat[p] == '*')
+    p++;
+  return p == pat_len;
+}
+
+YATL_Result_t YATL_span_find_next_matching(const YATL_Span_t *in_span,
+                                           const char *pattern,
+                                           const YATL_Cursor_t *in_cursor,
+                                           YATL_Cursor_t *out_cursor,
+                                           YATL_Span_t *out_span) {
+  if (!in_span || !pattern || !out_span)
+    return YATL_ERR_INVALID_ARG;
+
+  const _YATL_Span_t *_in_span = (const _YATL_Span_t *)in_span;
+  _YATL_Span_t *_out_span = (_YATL_Span_t *)out_span;
+  YATL_Result_t res = _YATL_check_span(_in_span);
+  if (res != YATL_OK)
+    return res;
+  if (in_cursor) {
+    res = _YATL_check_cursor((const _YATL_Cursor_t *)in_cursor);
+    if (res != YATL_OK)
+      return res;
+  }
+
+  // The literal prefix rejects most names with one memcmp; a pattern that
+  // is just a prefix followed by '*' needs nothing else.
+  size_t pat_len = strlen(pattern);
+  size_t prefix_len = strcspn(pattern, "*?");
+  bool prefix_only = prefix_len + 1 == pat_len && pattern[prefix_len] == '*';
+
+  _YATL_Cursor_t _c;
+  if (in_cursor && ((const _YATL_Cursor_t *)in_cursor)->line) {
+    _c = *(const _YATL_Cursor_t *)in_cursor;
+  } else {
+    _c = _in_span->c_start;
+  }
+  YATL_Cursor_t *c = (YATL_Cursor_t *)&_c;
+
+  while (YATL_span_find_next(in_span, c, out_span) == YATL_OK) {
+    if (_out_span->type != YATL_S_NODE_TABLE &&
+        _out_span->type != YATL_S_NODE_ARRAY_TABLE &&
+        _out_span->type != YATL_S_LEAF_KEYVAL)
+      continue;
+
+    size_t name_len;
+    const char *name = _span_get_name(_out_span, &name_len);
+    if (!name || name_len < prefix_len ||
+        memcmp(name, pattern, prefix_len) != 0)
+      continue;
+    if (prefix_only ||
+        _glob_match(pattern + prefix_len, pat_len - prefix_len,
+                    name + prefix_len, name_len - prefix_len)) {
+      if (out_cursor)
+        *(_YATL_Cursor_t *)out_cursor = _c;
+      return YATL_OK;
+    }
+  }
+
+  return YATL_ERR_NOT_FOUND;
+}
+
 YATL_Result_t YATL_span_find_name(const YATL_Span_t *in_span, const char *name,
                                   YATL_Span_t *out_span) {
   return YATL_span_find_next_by_name(in_span, name, NULL, NULL, out_span);
 }
 
+// Splits a dotted path into segments, each optionally followed by an [n]
+// element selector. With segs NULL only counts them. Returns the number of
+// segments, 0 if the path is malformed.
+static size_t _path_split(const char *path, size_t len, _YATL_PathSeg_t *segs) {
+  size_t pos = 0;
+  size_t n = 0;
+  uint32_t hash = _HASH_NAME_BASIS;
+  bool more;
+  do {
+    _TOMLKeySeg_t seg;
+    if (_key_segment(path, len, &pos, &seg, &more) != YATL_OK)
+      return 0;
+    size_t index = _YATL_NO_INDEX;
+    if (!more && pos < len && path[pos] == '[') {
+      size_t digits = ++pos;
+      index = 0;
+      while (pos < len && path[pos] >= '0' && path[pos] <= '9') {
+        if (index > (_YATL_NO_INDEX - 10) / 10)
+          return 0; // overflow
+        index = index * 10 + (size_t)(path[pos++] - '0');
+      }
+      if (pos == digits || pos >= len || path[pos] != ']')
+        return 0;
+      pos++;
+      while (pos < len && _is_ws(path[pos]))
+        pos++;
+      more = (pos < len && path[pos] == '.');
+      if (more)
+        pos++;
+    }
+    if (n > 0)
+      hash = _hash_name_add(hash, ".", 1);
+    hash = _hash_name_add(hash, path + seg.s_start, seg.s_end - seg.s_start);
+    if (segs) {
+      segs[n].text = path + seg.s_start;
+      segs[n].len = seg.s_end - seg.s_start;
+      segs[n].index = index;
+      segs[n].hash = hash;
+    }
+    n++;
+  } while (more);
+  return (pos == len) ? n : 0; // trailing garbage
+}
+
+// Matches the raw (possibly dotted) key text[0..len) against the leading
+// path segments by name. Returns the number of key segments when all of
+// them equal the corresponding path segments, 0 on mismatch or when the key
+// is longer than the path. Element selectors are checked by the caller.
+static size_t _path_match_key(const char *text, size_t len,
+                              const _YATL_PathSeg_t *segs, size_t nsegs) {
+  size_t pos = 0;
+  size_t n = 0;
+  bool more;
+  do {
+    _TOMLKeySeg_t seg;
+    if (n == nsegs || _key_segment(text, len, &pos, &seg, &more) != YATL_OK)
+      return 0;
+    size_t seg_len = seg.s_end - seg.s_start;
+    if (seg_len != segs[n].len ||
+        memcmp(text + seg.s_start, segs[n].text, seg_len) != 0)
+      return 0;
+    n++;
+  } while (more);
+  return n;
+}
+
+// Whether the selectors of segs[0..n) pick the table whose header was just
+// seen. elems[i] counts the [[array table]] elements named by the first
+// i + 1 segments under the current element of each shorter prefix, so the
+// last one counted is the one later headers such as [a.b] belong to. Going
+// further into an array of tables needs a selector; a path that ends at
+// its name gives the first element.
+static bool _path_header_selected(const _YATL_PathSeg_t *segs, size_t n,
+                                  size_t nsegs, const size_t elems[]) {
+  for (size_t i = 0; i < n; i++) {
+    size_t index = segs[i].index;
+    if (!elems[i]) {
+      if (index != _YATL_NO_INDEX)
+        return false;
+    } else if (index == _YATL_NO_INDEX) {
+      if (i + 1 < nsegs || elems[i] != 1)
+        return false;
+    } else if (elems[i] - 1 != index) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Hash of a header line's table name in the form _path_split produces, so
+// headers can be rejected without re-parsing them. Line text never changes
+// once linked, so the result is cached on the line.
+static uint32_t _line_name_hash(_YATL_Line_t *line, const char *name,
+                                size_t name_len, size_t *out_nsegs) {
+  if (!line->name_hashed) {
+    uint32_t hash = _HASH_NAME_BASIS;
+    size_t pos = 0;
+    size_t n = 0;
+    bool more;
+    do {
+      _TOMLKeySeg_t seg;
+      if (_key_segment(name, name_len, &pos, &seg, &more) != YATL_OK ||
+          n == UINT16_MAX) {
+        n = 0;
+        break;
+      }
+      if (n > 0)
+        hash = _hash_name_add(hash, ".", 1);
+      hash = _hash_name_add(hash, name + seg.s_start, seg.s_end - seg.s_start);
+      n++;
+    } while (more);
+    line->name_hash = hash;
+    line->name_nsegs = (uint16_t)n;
+    line->name_hashed = true;
+  }
+  *out_nsegs = line->name_nsegs;
+  return line->name_hash;
+}
+
+// Picks element `index` of an array value span
+static YATL_Result_t _path_array_element(const YATL_Span_t *array,
+                                         size_t index, YATL_Span_t *out_span) {
+  if (YATL_span_type(array) != YATL_S_NODE_ARRAY)
+    return YATL_ERR_NOT_FOUND;
+  YATL_Cursor_t cursor = YATL_cursor_create();
+  for (size_t i = 0;; i++) {
+    if (YATL_span_find_next(array, &cursor, out_span) != YATL_OK)
+      return YATL_ERR_NOT_FOUND;
+    if (i == index)
+      return YATL_OK;
+  }
+}
+
+// Resolves a split path inside in_span in one forward pass. Table headers
+// carry absolute paths, so tables only match at document level; keyvals
+// match relative to the span being searched and descend into inline-table
+// values. Headers and keys that cover a prefix of the path are searched for
+// the remainder; the outer scan continues past them if it is not there, as
+// TOML allows [a] and [a.b] to be defined separately. An [n] selector picks
+// the n-th [[array table]] with that name, or element n of an array value;
+// headers after an [[array table]] element, such as [a.b] after [[a]],
+// belong to that element.
+static YATL_Result_t _path_resolve(const YATL_Span_t *in_span,
+                                   const _YATL_PathSeg_t *segs, size_t nsegs,
+                                   YATL_Span_t *out_span) {
+  // Array-table elements per matched length. Each level of the recursion
+  // consumes a segment, so stack use stays bounded by the segment limit.
+  size_t elems[YATL_PATH_MAX_SEGMENTS];
+  memset(elems, 0, nsegs * sizeof(*elems));
+
+  YATL_Cursor_t cursor = YATL_cursor_create();
+  YATL_Span_t child;
+  while (YATL_span_find_next(in_span, &cursor, &child) == YATL_OK) {
+    _YATL_Span_t *_child = (_YATL_Span_t *)&child;
+    const char *name;
+    size_t name_len = 0;
+    size_t n;
+
+    switch (_child->type) {
+    case YATL_S_NODE_TABLE:
+    case YATL_S_NODE_ARRAY_TABLE: {
+      name = _span_get_name(_child, &name_len);
+      if (!name)
+        break;
+      size_t name_nsegs;
+      uint32_t hash =
+          _line_name_hash(_child->c_start.line, name, name_len, &name_nsegs);
+      if (name_nsegs == 0 || name_nsegs > nsegs ||
+          hash != segs[name_nsegs - 1].hash)
+        break;
+      n = _path_match_key(name, name_len, segs, nsegs);
+      if (n == 0)
+        break;
+      if (_child->type == YATL_S_NODE_ARRAY_TABLE) {
+        // A new element; tables of the previous one are left behind
+        elems[n - 1]++;
+        memset(elems + n, 0, (nsegs - n) * sizeof(*elems));
+      }
+      if (!_path_header_selected(segs, n, nsegs, elems))
+        break;
+      if (n == nsegs) {
+        *out_span = child;
+        return YATL_OK;
+      }
+      if (_path_resolve(&child, segs + n, nsegs - n, out_span) == YATL_OK)
+        return YATL_OK;
+      break;
+    }
+
+    case YATL_S_LEAF_KEYVAL: {
+      YATL_Span_t key, val;
+      if (YATL_span_keyval_slice(&child, &key, &val) != YATL_OK)
+        break;
+      // Match against the raw key so a quoted "a.b" stays one segment
+      const _YATL_Span_t *_key = (const _YATL_Span_t *)&key;
+      name = _key->c_start.line->text + _key->c_start.pos;
+      name_len = _key->c_end.pos - _key->c_start.pos;
+      n = _path_match_key(name, name_len, segs, nsegs);
+      if (n == 0)
+        break;
+      size_t i = 0;
+      while (i + 1 < n && segs[i].index == _YATL_NO_INDEX)
+        i++;
+      if (i + 1 < n)
+        break; // only the last segment of a dotted key can select
+      if (segs[n - 1].index != _YATL_NO_INDEX) {
+        YATL_Span_t elem;
+        if (_path_array_element(&val, segs[n - 1].index, &elem) != YATL_OK)
+          break;
+        child = elem;
+        val = elem;
+      }
+      if (n == nsegs) {
+        *out_span = child;
+        return YATL_OK;
+      }
+      if (YATL_span_type(&val) == YATL_S_NODE_INLINE_TABLE &&
+          _path_resolve(&val, segs + n, nsegs - n, out_span) == YATL_OK)
+        return YATL_OK;
+      break;
+    }
+
+    default:
+      break;
+    }
+  }
+  return YATL_ERR_NOT_FOUND;
+}
+
+static YATL_Result_t _path_find(const YATL_Doc_t *doc,
+                                const _YATL_PathSeg_t *segs, size_t nsegs,
+                                YATL_Span_t *out_span) {
+  YATL_Span_t doc_span;
+  YATL_Result_t res = YATL_doc_span(doc, &doc_span);
+  if (res != YATL_OK)
+    return res;
+  if (!((_YATL_Span_t *)&doc_span)->c_start.line)
+    return YATL_ERR_NOT_FOUND; // empty document
+
+  return _path_resolve(&doc_span, segs, nsegs, out_span);
+}
+
+YATL_Result_t YATL_doc_find_path(const YATL_Doc_t *doc, const char *path,
+                                 YATL_Span_t *out_span) {
+  if (!doc || !path || !out_span)
+    return YATL_ERR_INVALID_ARG;
+
+  size_t path_len = strlen(path);
+  size_t nsegs = _path_split(path, path_len, NULL);
+  if (nsegs == 0 || nsegs > YATL_PATH_MAX_SEGMENTS)
+    return YATL_ERR_INVALID_ARG;
+  _YATL_PathSeg_t segs[YATL_PATH_MAX_SEGMENTS];
+  _path_split(path, path_len, segs);
+
+  return _path_find(doc, segs, nsegs, out_span);
+}
+
+// ---------------------------------------------------------------------
+// Compiled queries
+// ---------------------------------------------------------------------
+
+YATL_Query_t YATL_query_create(void) {
+  YATL_Query_t q;
+  *(_YATL_Query_t *)&q = _YATL_EMPTY_QUERY;
+  return q;
+}
+
+YATL_Result_t YATL_query_compile(YATL_Query_t *query, const char *path) {
+  if (!query || !path)
+    return YATL_ERR_INVALID_ARG;
+  _YATL_Query_t *_query = (_YATL_Query_t *)query;
+  YATL_Result_t res = _YATL_check_query(_query);
+  if (res != YATL_OK)
+    return res;
+
+  size_t path_len = strlen(path);
+  size_t nsegs = _path_split(path, path_len, NULL);
+  if (nsegs == 0 || nsegs > YATL_PATH_MAX_SEGMENTS)
+    return YATL_ERR_INVALID_ARG;
+
+  // Segments point into a private copy of the path stored behind them
+  size_t segs_size = nsegs * sizeof(_YATL_PathSeg_t);
+  _YATL_PathSeg_t *segs = malloc(segs_size + path_len);
+  if (!segs)
+    return YATL_ERR_NOMEM;
+  char *copy = (char *)segs + segs_size;
+  memcpy(copy, path, path_len);
+  _path_split(copy, path_len, segs);
+
+  free(_query->segs);
+  _query->segs = segs;
+  _query->nsegs = nsegs;
+  return YATL_OK;
+}
+
+YATL_Result_t YATL_query_exec(const YATL_Doc_t *doc, const YATL_Query_t *query,
+                              YATL_Span_t *out_span) {
+  if (!doc || !query || !out_span)
+    return YATL_ERR_INVALID_ARG;
+  const _YATL_Query_t *_query = (const _YATL_Query_t *)query;
+  YATL_Result_t res = _YATL_check_query(_query);
+  if (res != YATL_OK)
+    return res;
+  if (!_query->segs)
+    return YATL_ERR_INVALID_ARG; // not compiled
+
+  return _path_find(doc, _query->segs, _query->nsegs, out_span);
+}
+
+void YATL_query_free(YATL_Query_t *query) {
+  if (!query)
+    return;
+  _YATL_Query_t *_query = (_YATL_Query_t *)query;
+  if (_YATL_check_query(_query) != YATL_OK)
+    return;
+  free(_query->segs);
+  *query = YATL_query_create();
+}
+
+// ---------------------------------------------------------------------
+// Freezing
+//
+// The read path fills in two caches: the position index and the name hash
+// of each header line. Freezing builds both up front and refuses edits
+// from then on, so lookups only read and need no locking.
+// ---------------------------------------------------------------------
+
+YATL_Result_t YATL_doc_freeze(YATL_Doc_t *doc) {
+  if (!doc)
+    return YATL_ERR_INVALID_ARG;
+  _YATL_Doc_t *_doc = (_YATL_Doc_t *)doc;
+  YATL_Result_t res = _YATL_check_doc(_doc);
+  if (res != YATL_OK)
+    return res;
+  if (_doc->frozen)
+    return YATL_OK;
+  if (_doc->txn)
+    return YATL_ERR_INVALID_ARG;
+
+  res = _span_index_prepare(_doc);
+  if (res != YATL_OK)
+    return res;
+
+  // Headers are only matched at document level, as in _path_resolve
+  YATL_Span_t doc_span, child;
+  YATL_Cursor_t cursor = YATL_cursor_create();
+  if (_doc->head && YATL_doc_span(doc, &doc_span) == YATL_OK) {
+    while (YATL_span_find_next(&doc_span, &cursor, &child) == YATL_OK) {
+      _YATL_Span_t *_child = (_YATL_Span_t *)&child;
+      if (_child->type != YATL_S_NODE_TABLE &&
+          _child->type != YATL_S_NODE_ARRAY_TABLE)
+        continue;
+      size_t name_len = 0, name_nsegs;
+      const char *name = _span_get_name(_child, &name_len);
+      if (name)
+        _line_name_hash(_child->c_start.line, name, name_len, &name_nsegs);
+    }
+  }
+
+  // Undo steps can never be taken again
+  _history_free(_doc->history);
+  _doc->history = NULL;
+  _doc->frozen = true;
+  return YATL_OK;
+}
+
 YATL_Result_t YATL_span_iter_line(const YATL_Span_t *span,
                                   YATL_Cursor_t *cursor, const char **out_text,
                                   size_t *out_len) {
@@ -828,7 +1557,8 @@ YATL_Result_t YATL_span_iter_line(const YATL_Span_t *span,
 // Sets both lexical bounds (c_start/c_end) and semantic bounds
 // (s_c_start/s_c_end). For quoted keys: lexical includes quotes, semantic
 // excludes them. For bare keys: s_c_start.line is NULL, meaning semantic ==
-// lexical.
+// lexical. Dotted keys (a."b".c) keep their raw text: the lexical bounds run
+// from the first to the last segment and there are no semantic bounds.
 static YATL_Result_t _toml_key_parse(const _YATL_Span_t *key_span,
                                      _YATL_Span_t *out_span,
                                      YATL_ValueType_t *out_type) {
@@ -842,98 +1572,44 @@ static YATL_Result_t _toml_key_parse(const _YATL_Span_t *key_span,
   if (_skipWS(&cr) == YATL_DONE)
     return YATL_ERR_SYNTAX;
 
-  char first_char = cr.line->text[cr.pos];
+  const char *text = cr.line->text;
+  size_t len = cr.line->len;
+  size_t pos = cr.pos;
+  _TOMLKeySeg_t first, seg;
+  size_t nseg = 0;
+  bool more;
+  do {
+    if (_key_segment(text, len, &pos, &seg, &more) != YATL_OK) {
+      YATL_LOG(YATL_LOG_ERROR, "Invalid key segment at pos %zu", pos);
+      return YATL_ERR_SYNTAX;
+    }
+    if (nseg++ == 0)
+      first = seg;
+  } while (more);
+
+  // grammar check - after key should be whitespace then =
+  if (pos >= len || text[pos] != '=') {
+    YATL_LOG(YATL_LOG_ERROR, "Invalid character after key");
+    return YATL_ERR_SYNTAX;
+  }
 
   // Work on temp to handle in==out case safely
   _YATL_Span_t temp_span = _YATL_EMPTY_SPAN;
   temp_span.type = YATL_S_SLICE_KEY;
-
-  // Double-quoted key: "key" - supports escape sequences
-  if (first_char == '"') {
-    temp_span.c_start = cr;   // Lexical start: at opening "
-    cr.pos++;                 // skip opening quote
-    temp_span.s_c_start = cr; // Semantic start: after opening "
-    bool escaped = false;
-    while (cr.pos < cr.line->len) {
-      char c = cr.line->text[cr.pos];
-
-      if (escaped) {
-        escaped = false;
-        cr.pos++;
-        continue;
-      }
-      if (c == '\\') {
-        escaped = true;
-        cr.pos++;
-        continue;
-      }
-      if (c == '"') {
-        // end of string
-        temp_span.s_c_end = cr; // Semantic end: at closing "
-        *out_type = YATL_TYPE_STRING;
-        // grammar check - after closing quote should be whitespace then =
-        cr.pos++;             // move past closing quote
-        temp_span.c_end = cr; // Lexical end: after closing "
-        if (_skipWS(&cr) != YATL_DONE && cr.line->text[cr.pos] != '=') {
-          YATL_LOG(YATL_LOG_ERROR, "Invalid character after key string");
-          return YATL_ERR_SYNTAX;
-        }
-        *out_span = temp_span;
-        return YATL_OK;
-      }
-      cr.pos++;
-    }
-    return YATL_ERR_SYNTAX; // unclosed quote
-  }
-
-  // Single-quoted key: 'key' - literal, no escape sequences
-  if (first_char == '\'') {
-    temp_span.c_start = cr;   // Lexical start: at opening '
-    cr.pos++;                 // skip opening quote
-    temp_span.s_c_start = cr; // Semantic start: after opening '
-    while (cr.pos < cr.line->len) {
-      char c = cr.line->text[cr.pos];
-
-      if (c == '\'') {
-        // end of string - no escape sequences in single-quoted
-        temp_span.s_c_end = cr; // Semantic end: at closing '
-        *out_type = YATL_TYPE_STRING;
-        // grammar check - after closing quote should be whitespace then =
-        cr.pos++;             // move past closing quote
-        temp_span.c_end = cr; // Lexical end: after closing '
-        if (_skipWS(&cr) != YATL_DONE && cr.line->text[cr.pos] != '=') {
-          YATL_LOG(YATL_LOG_ERROR, "Invalid character after key string");
-          return YATL_ERR_SYNTAX;
-        }
-        *out_span = temp_span;
-        return YATL_OK;
-      }
-      cr.pos++;
-    }
-    return YATL_ERR_SYNTAX; // unclosed quote
+  temp_span.c_start = cr;
+  temp_span.c_start.pos = first.start;
+  temp_span.c_end = cr;
+  temp_span.c_end.pos = seg.end;
+  if (nseg == 1 && first.s_start != first.start) {
+    // Single quoted key: semantic bounds exclude the quotes
+    temp_span.s_c_start = cr;
+    temp_span.s_c_start.pos = first.s_start;
+    temp_span.s_c_end = cr;
+    temp_span.s_c_end.pos = first.s_end;
   }
-
-  // Bare key: only A-Za-z0-9_- allowed
-  // semantic == lexical, so s_c_start/s_c_end stay NULL (zero-initialized)
-  if (_is_bare_key_char(first_char)) {
-    temp_span.c_start = cr;
-
-    while (cr.pos < cr.line->len && _is_bare_key_char(cr.line->text[cr.pos])) {
-      cr.pos++;
-    }
-
-    temp_span.c_end = cr; // one past last bare key char (exclusive)
-    *out_type = YATL_TYPE_STRING;
-    // grammar check - after bare key should be whitespace then =
-    if (_skipWS(&cr) != YATL_DONE && cr.line->text[cr.pos] != '=') {
-      YATL_LOG(YATL_LOG_ERROR, "Invalid character after bare key");
-      return YATL_ERR_SYNTAX;
-    }
-    *out_span = temp_span;
-    return YATL_OK;
-  }
-
-  return YATL_ERR_SYNTAX; // invalid key start character
+  *out_type = YATL_TYPE_STRING;
+  *out_span = temp_span;
+  return YATL_OK;
 }
 
 // Parse value from a cursor position (should be after the =)
@@ -1093,6 +1769,9 @@ YATL_Result_t YATL_span_keyval_slice(const YATL_Span_t *span, YATL_Span_t *key,
   if (_span->type != YATL_S_LEAF_KEYVAL)
     return YATL_ERR_TYPE;
 
+  if (_span->kv.cached)
+    return _keyval_cache_slice(_span, _key, _val);
+
   _YATL_Cursor_t c = _span->c_start;
 
   // First, consume the raw key portion (up to =)
@@ -1193,3 +1872,102 @@ YATL_Result_t YATL_span_get_string(const YATL_Span_t *in_span, const char *key,
   // Get the text from the value span
   return YATL_span_text(&val_span, out_text, out_len);
 }
+
+// Hash table sizes above this many slots are heap-allocated
+#define _GET_MANY_STACK_SLOTS 512
+
+YATL_Result_t YATL_span_get_many(const YATL_Span_t *in_span,
+                                 const char *const keys[], size_t nkeys,
+                                 YATL_Span_t out_spans[],
+                                 YATL_Result_t out_results[]) {
+  if (!in_span || (nkeys > 0 && (!keys || !out_spans || !out_results)))
+    return YATL_ERR_INVALID_ARG;
+  YATL_Result_t res = _YATL_check_span((const _YATL_Span_t *)in_span);
+  if (res != YATL_OK)
+    return res;
+  for (size_t i = 0; i < nkeys; i++) {
+    if (!keys[i])
+      return YATL_ERR_INVALID_ARG;
+    out_results[i] = YATL_ERR_NOT_FOUND;
+  }
+  if (nkeys == 0)
+    return YATL_OK;
+
+  // Open-addressing table of requested key indices, at most half full.
+  // Repeated names are chained through dup[] so each is filled on a match.
+  size_t nslots = 16;
+  while (nslots < nkeys * 2)
+    nslots <<= 1;
+  size_t stack_slots[nslots <= _GET_MANY_STACK_SLOTS ? nslots : 1];
+  size_t *slots = stack_slots;
+  size_t *heap = NULL;
+  if (nslots > _GET_MANY_STACK_SLOTS) {
+    heap = malloc((nslots + nkeys * 2) * sizeof(size_t));
+    if (!heap)
+      return YATL_ERR_NOMEM;
+    slots = heap;
+  }
+  size_t stack_aux[heap ? 1 : nkeys * 2];
+  size_t *lens = heap ? heap + nslots : stack_aux;
+  size_t *dup = lens + nkeys;
+
+  size_t unique = 0;
+  for (size_t i = 0; i < nslots; i++)
+    slots[i] = SIZE_MAX;
+  for (size_t i = 0; i < nkeys; i++) {
+    lens[i] = strlen(keys[i]);
+    dup[i] = SIZE_MAX;
+    size_t s = _hash_name(keys[i], lens[i]) & (nslots - 1);
+    while (slots[s] != SIZE_MAX) {
+      size_t j = slots[s];
+      if (lens[j] == lens[i] && memcmp(keys[j], keys[i], lens[i]) == 0) {
+        while (dup[j] != SIZE_MAX)
+          j = dup[j];
+        dup[j] = i;
+        break;
+      }
+      s = (s + 1) & (nslots - 1);
+    }
+    if (slots[s] == SIZE_MAX) {
+      slots[s] = i;
+      unique++;
+    }
+  }
+
+  // Single pass over the span, stopping once every name is resolved
+  size_t found = 0;
+  YATL_Cursor_t cursor = YATL_cursor_create();
+  YATL_Span_t child;
+  while (found < unique &&
+         YATL_span_find_next(in_span, &cursor, &child) == YATL_OK) {
+    _YATL_Span_t *_child = (_YATL_Span_t *)&child;
+    if (_child->type != YATL_S_LEAF_KEYVAL)
+      continue;
+    size_t name_len;
+    const char *name = _span_get_name(_child, &name_len);
+    if (!name)
+      continue;
+
+    size_t s = _hash_name(name, name_len) & (nslots - 1);
+    for (; slots[s] != SIZE_MAX; s = (s + 1) & (nslots - 1)) {
+      size_t i = slots[s];
+      if (lens[i] != name_len || memcmp(keys[i], name, name_len) != 0)
+        continue;
+      if (out_results[i] != YATL_ERR_NOT_FOUND)
+        break; // first definition wins, as with YATL_span_find_name
+      YATL_Span_t key_span;
+      YATL_Result_t slice_res =
+          YATL_span_keyval_slice(&child, &key_span, &out_spans[i]);
+      for (size_t j = dup[i]; j != SIZE_MAX; j = dup[j]) {
+        out_spans[j] = out_spans[i];
+        out_results[j] = slice_res;
+      }
+      out_results[i] = slice_res;
+      found++;
+      break;
+    }
+  }
+
+  free(heap);
+  return (found == unique) ? YATL_OK : YATL_ERR_NOT_FOUND;
+}
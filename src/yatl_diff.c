@@ -0,0 +1,210 @@
+#include "yatl_private.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// ---------------------------------------------------------------------
+// Unified diff against the file last loaded or saved
+//
+// Lines keep the number they had in that file (origin_line). Walking the
+// document, lines whose origin_line keeps increasing are unchanged and every
+// other line was added. Lines of the file no longer among them sit in the
+// boneyard, or were moved, and are reported as removed. Line text is never
+// compared; the document and the boneyard are each walked once.
+// ---------------------------------------------------------------------
+
+#define _YATL_DIFF_CONTEXT 3
+
+typedef struct {
+  char kind; // ' ', '-' or '+'
+  const _YATL_Line_t *line;
+  uint32_t old_no, new_no; // line numbers on each side
+} _YATL_DiffOp_t;
+
+typedef struct {
+  YATL_WriteFn_t write;
+  void *ctx;
+  const char *name;        // file name for the ---/+++ header, may be NULL
+  bool started;            // header written
+  uint32_t old_no, new_no; // next line number on each side
+  _YATL_DiffOp_t *hunk;    // pending hunk, leading context included
+  size_t n, cap;
+  size_t tail; // unchanged ops ending the hunk
+  bool open;   // hunk holds a change
+} _YATL_Diff_t;
+
+// Makes room for one more element of size in *items
+static YATL_Result_t _grow(void **items, size_t *cap, size_t n, size_t size) {
+  if (n < *cap)
+    return YATL_OK;
+  size_t new_cap = *cap ? *cap * 2 : 16;
+  void *p = realloc(*items, new_cap * size);
+  if (!p)
+    return YATL_ERR_NOMEM;
+  *items = p;
+  *cap = new_cap;
+  return YATL_OK;
+}
+
+static int _cmp_origin(const void *a, const void *b) {
+  uint32_t la = (*(const _YATL_Line_t *const *)a)->origin_line;
+  uint32_t lb = (*(const _YATL_Line_t *const *)b)->origin_line;
+  return (la > lb) - (la < lb);
+}
+
+// Writes the first n pending ops as one hunk
+static YATL_Result_t _hunk_flush(_YATL_Diff_t *d, size_t n) {
+  char buf[64];
+  YATL_Result_t res;
+  if (!d->started && d->name) {
+    const char *parts[] = {"--- ", d->name, "\n+++ ", d->name, "\n"};
+    for (size_t i = 0; i < sizeof(parts) / sizeof(parts[0]); i++) {
+      res = d->write(d->ctx, parts[i], strlen(parts[i]));
+      if (res != YATL_OK)
+        return res;
+    }
+  }
+  d->started = true;
+
+  uint32_t old_n = 0, new_n = 0;
+  for (size_t i = 0; i < n; i++) {
+    old_n += d->hunk[i].kind != '+';
+    new_n += d->hunk[i].kind != '-';
+  }
+  // An empty side starts at the line before, as in GNU diff
+  uint32_t old_start = d->hunk[0].old_no - (old_n == 0);
+  uint32_t new_start = d->hunk[0].new_no - (new_n == 0);
+  int len = snprintf(buf, sizeof(buf), "@@ -%u,%u +%u,%u @@\n", old_start,
+                     old_n, new_start, new_n);
+  res = d->write(d->ctx, buf, (size_t)len);
+
+  for (size_t i = 0; i < n && res == YATL_OK; i++) {
+    const _YATL_Line_t *line = d->hunk[i].line;
+    res = d->write(d->ctx, &d->hunk[i].kind, 1);
+    if (res == YATL_OK)
+      res = d->write(d->ctx, line->text, line->len);
+    if (res == YATL_OK)
+      res = d->write(d->ctx, "\n", 1);
+  }
+  return res;
+}
+
+static YATL_Result_t _diff_op(_YATL_Diff_t *d, char kind,
+                              const _YATL_Line_t *line) {
+  _YATL_DiffOp_t op = {kind, line, d->old_no, d->new_no};
+  d->old_no += kind != '+';
+  d->new_no += kind != '-';
+
+  if (kind != ' ') {
+    d->open = true;
+    d->tail = 0;
+  } else if (!d->open && d->n == _YATL_DIFF_CONTEXT) {
+    // Only the last few unchanged lines can lead a hunk
+    memmove(d->hunk, d->hunk + 1, (d->n - 1) * sizeof(*d->hunk));
+    d->n--;
+  } else if (d->open) {
+    d->tail++;
+  }
+
+  YATL_Result_t res =
+      _grow((void **)&d->hunk, &d->cap, d->n, sizeof(*d->hunk));
+  if (res != YATL_OK)
+    return res;
+  d->hunk[d->n++] = op;
+
+  if (d->open && d->tail > 2 * _YATL_DIFF_CONTEXT) {
+    // Gap too wide to join: close this hunk, keep the leading context of
+    // the next
+    res = _hunk_flush(d, d->n - d->tail + _YATL_DIFF_CONTEXT);
+    memmove(d->hunk, d->hunk + d->n - _YATL_DIFF_CONTEXT,
+            _YATL_DIFF_CONTEXT * sizeof(*d->hunk));
+    d->n = _YATL_DIFF_CONTEXT;
+    d->open = false;
+    d->tail = 0;
+  }
+  return res;
+}
+
+// Emits removed lines numbered below limit, then the added lines waiting
+static YATL_Result_t _diff_changes(_YATL_Diff_t *d,
+                                   const _YATL_Line_t **removed, size_t nrem,
+                                   size_t *irem, uint32_t limit,
+                                   const _YATL_Line_t **added, size_t *nadd) {
+  YATL_Result_t res = YATL_OK;
+  while (*irem < nrem && removed[*irem]->origin_line < limit && res == YATL_OK)
+    res = _diff_op(d, '-', removed[(*irem)++]);
+  for (size_t i = 0; i < *nadd && res == YATL_OK; i++)
+    res = _diff_op(d, '+', added[i]);
+  *nadd = 0;
+  return res;
+}
+
+YATL_Result_t YATL_doc_diff(const YATL_Doc_t *doc, const char *name,
+                            YATL_WriteFn_t write, void *ctx) {
+  if (!doc || !write)
+    return YATL_ERR_INVALID_ARG;
+
+  const _YATL_Doc_t *_doc = (const _YATL_Doc_t *)doc;
+  YATL_Result_t res = _YATL_check_doc(_doc);
+  if (res != YATL_OK)
+    return res;
+  if (_doc->origin_lost)
+    return YATL_ERR_NOT_FOUND;
+
+  // Removed lines: original lines in the boneyard or out of order
+  const _YATL_Line_t **removed = NULL;
+  size_t nrem = 0, rem_cap = 0;
+  for (const _YATL_Line_t *line = _doc->boneyard_head; line && res == YATL_OK;
+       line = line->next) {
+    if (!line->origin_line)
+      continue;
+    res = _grow((void **)&removed, &rem_cap, nrem, sizeof(*removed));
+    if (res == YATL_OK)
+      removed[nrem++] = line;
+  }
+  uint32_t last = 0;
+  for (const _YATL_Line_t *line = _doc->head; line && res == YATL_OK;
+       line = line->next) {
+    if (line->origin_line > last) {
+      last = line->origin_line;
+    } else if (line->origin_line) {
+      res = _grow((void **)&removed, &rem_cap, nrem, sizeof(*removed));
+      if (res == YATL_OK)
+        removed[nrem++] = line;
+    }
+  }
+  if (nrem > 1)
+    qsort(removed, nrem, sizeof(*removed), _cmp_origin);
+
+  // Added lines wait until the removed lines before them are out, so a
+  // replacement reads as - then +
+  const _YATL_Line_t **added = NULL;
+  size_t nadd = 0, add_cap = 0, irem = 0;
+  _YATL_Diff_t d = {.write = write, .ctx = ctx, .name = name,
+                    .old_no = 1, .new_no = 1};
+  last = 0;
+  for (const _YATL_Line_t *line = _doc->head; line && res == YATL_OK;
+       line = line->next) {
+    if (line->origin_line > last) {
+      last = line->origin_line;
+      res = _diff_changes(&d, removed, nrem, &irem, last, added, &nadd);
+      if (res == YATL_OK)
+        res = _diff_op(&d, ' ', line);
+    } else {
+      res = _grow((void **)&added, &add_cap, nadd, sizeof(*added));
+      if (res == YATL_OK)
+        added[nadd++] = line;
+    }
+  }
+  if (res == YATL_OK)
+    res = _diff_changes(&d, removed, nrem, &irem, UINT32_MAX, added, &nadd);
+  if (res == YATL_OK && d.open) {
+    size_t trim = d.tail > _YATL_DIFF_CONTEXT ? d.tail - _YATL_DIFF_CONTEXT : 0;
+    res = _hunk_flush(&d, d.n - trim);
+  }
+
+  free(d.hunk);
+  free(added);
+  free(removed);
+  return res;
+}
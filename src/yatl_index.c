@@ -0,0 +1,349 @@
+#include "yatl_private.h"
+#include <stdlib.h>
+#include <string.h>
+
+// ---------------------------------------------------------------------
+// Position index
+//
+// Maps line numbers and byte offsets to lines, and positions to the
+// top-level items and table children containing them. Built on first use
+// and rebuilt when the document generation changes. Items are disjoint
+// and in document order, so both levels are binary searched; only the
+// value of a single key-value is descended linearly.
+// ---------------------------------------------------------------------
+
+// Start and (exclusive) end of an indexed table or key-value. A span is
+// rebuilt from its start with one YATL_span_find_next call.
+typedef struct {
+  _YATL_Line_t *line;
+  size_t pos;
+  _YATL_Line_t *end_line;
+  size_t end_pos;
+  size_t kids;  // first child in _YATL_SpanIndex.kids (tables only)
+  size_t nkids; // number of children
+} _YATL_IndexItem_t;
+
+struct _YATL_SpanIndex {
+  uint64_t gen; // _YATL_Doc_t.gen the index was built at
+  _YATL_Line_t **lines; // lines[i] has linenum i + 1
+  size_t *offsets;      // byte offset of each line, one byte per line break
+  size_t nlines;
+  _YATL_IndexItem_t *items; // top-level tables and key-values
+  size_t nitems;
+  _YATL_IndexItem_t *kids; // key-values of every table, grouped by table
+  size_t nkids;
+};
+
+typedef struct _YATL_SpanIndex _YATL_SpanIndex_t;
+
+void _span_index_free(_YATL_Doc_t *doc) {
+  _YATL_SpanIndex_t *index = doc->span_index;
+  if (!index)
+    return;
+  free(index->lines);
+  free(index->offsets);
+  free(index->items);
+  free(index->kids);
+  free(index);
+  doc->span_index = NULL;
+}
+
+// Orders two positions by line number, then column. Valid only while the
+// index is current, as that is when line numbers are.
+static int _pos_cmp(const _YATL_Line_t *la, size_t pa, const _YATL_Line_t *lb,
+                    size_t pb) {
+  if (la->linenum != lb->linenum)
+    return la->linenum < lb->linenum ? -1 : 1;
+  return (pa > pb) - (pa < pb);
+}
+
+// True if (line, pos) lies in [start, end). A range ending at the end of
+// the document also contains that final position.
+static bool _pos_within(const _YATL_Line_t *line, size_t pos,
+                        const _YATL_Line_t *start, size_t start_pos,
+                        const _YATL_Line_t *end, size_t end_pos) {
+  if (_pos_cmp(line, pos, start, start_pos) < 0)
+    return false;
+  int c = _pos_cmp(line, pos, end, end_pos);
+  return c < 0 || (c == 0 && !end->next && end_pos == end->len);
+}
+
+static YATL_Result_t _index_push(_YATL_IndexItem_t **items, size_t *n,
+                                 size_t *cap, const _YATL_Span_t *span) {
+  if (*n == *cap) {
+    size_t new_cap = *cap ? *cap * 2 : 64;
+    _YATL_IndexItem_t *grown = realloc(*items, new_cap * sizeof(**items));
+    if (!grown)
+      return YATL_ERR_NOMEM;
+    *items = grown;
+    *cap = new_cap;
+  }
+  (*items)[(*n)++] = (_YATL_IndexItem_t){.line = span->c_start.line,
+                                         .pos = span->c_start.pos,
+                                         .end_line = span->c_end.line,
+                                         .end_pos = span->c_end.pos};
+  return YATL_OK;
+}
+
+static YATL_Result_t _index_build(_YATL_Doc_t *doc, _YATL_SpanIndex_t *index) {
+  // Renumber lines so positions compare by linenum
+  size_t nlines = 0;
+  for (_YATL_Line_t *line = doc->head; line; line = line->next)
+    nlines++;
+  index->lines = malloc((nlines ? nlines : 1) * sizeof(*index->lines));
+  index->offsets = malloc((nlines ? nlines : 1) * sizeof(*index->offsets));
+  if (!index->lines || !index->offsets)
+    return YATL_ERR_NOMEM;
+  size_t offset = 0;
+  size_t i = 0;
+  for (_YATL_Line_t *line = doc->head; line; line = line->next, i++) {
+    line->linenum = (uint32_t)(i + 1);
+    index->lines[i] = line;
+    index->offsets[i] = offset;
+    offset += line->len + 1;
+  }
+  index->nlines = nlines;
+  if (!doc->head)
+    return YATL_OK;
+
+  size_t items_cap = 0, kids_cap = 0;
+  YATL_Span_t doc_span;
+  YATL_Result_t res = YATL_doc_span((const YATL_Doc_t *)doc, &doc_span);
+  if (res != YATL_OK)
+    return res;
+  YATL_Cursor_t cursor = YATL_cursor_create();
+  YATL_Span_t item;
+  while (YATL_span_find_next(&doc_span, &cursor, &item) == YATL_OK) {
+    const _YATL_Span_t *_item = (const _YATL_Span_t *)&item;
+    if (_item->type != YATL_S_NODE_TABLE &&
+        _item->type != YATL_S_NODE_ARRAY_TABLE &&
+        _item->type != YATL_S_LEAF_KEYVAL)
+      continue;
+    res = _index_push(&index->items, &index->nitems, &items_cap, _item);
+    if (res != YATL_OK)
+      return res;
+    if (_item->type == YATL_S_LEAF_KEYVAL)
+      continue;
+
+    _YATL_IndexItem_t *entry = &index->items[index->nitems - 1];
+    entry->kids = index->nkids;
+    YATL_Cursor_t kid_cursor = YATL_cursor_create();
+    YATL_Span_t kid;
+    while (YATL_span_find_next(&item, &kid_cursor, &kid) == YATL_OK) {
+      const _YATL_Span_t *_kid = (const _YATL_Span_t *)&kid;
+      if (_kid->type != YATL_S_LEAF_KEYVAL)
+        continue;
+      res = _index_push(&index->kids, &index->nkids, &kids_cap, _kid);
+      if (res != YATL_OK)
+        return res;
+    }
+    entry->nkids = index->nkids - entry->kids;
+  }
+  return YATL_OK;
+}
+
+// Returns the current index of the document, building it if needed
+static YATL_Result_t _index_get(const YATL_Doc_t *doc,
+                                _YATL_SpanIndex_t **out_index) {
+  _YATL_Doc_t *_doc = (_YATL_Doc_t *)doc;
+  YATL_Result_t res = _YATL_check_doc(_doc);
+  if (res != YATL_OK)
+    return res;
+  if (_doc->span_index && _doc->span_index->gen == _doc->gen) {
+    *out_index = _doc->span_index;
+    return YATL_OK;
+  }
+
+  _span_index_free(_doc);
+  _YATL_SpanIndex_t *index = calloc(1, sizeof(*index));
+  if (!index)
+    return YATL_ERR_NOMEM;
+  _doc->span_index = index;
+  res = _index_build(_doc, index);
+  if (res != YATL_OK) {
+    _span_index_free(_doc);
+    return res;
+  }
+  index->gen = _doc->gen;
+  *out_index = index;
+  return YATL_OK;
+}
+
+YATL_Result_t _span_index_prepare(_YATL_Doc_t *doc) {
+  _YATL_SpanIndex_t *index;
+  return _index_get((const YATL_Doc_t *)doc, &index);
+}
+
+// Binary search for the item containing (line, pos)
+static const _YATL_IndexItem_t *_index_find(const _YATL_IndexItem_t *items,
+                                            size_t n, const _YATL_Line_t *line,
+                                            size_t pos) {
+  // Last item starting at or before the position
+  size_t lo = 0, hi = n;
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (_pos_cmp(items[mid].line, items[mid].pos, line, pos) <= 0)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  if (lo == 0)
+    return NULL;
+  const _YATL_IndexItem_t *item = &items[lo - 1];
+  return _pos_within(line, pos, item->line, item->pos, item->end_line,
+                     item->end_pos)
+             ? item
+             : NULL;
+}
+
+// Rebuilds the span of an indexed item found inside parent
+static YATL_Result_t _index_item_span(const YATL_Span_t *parent,
+                                      const _YATL_IndexItem_t *item,
+                                      YATL_Span_t *out_span) {
+  _YATL_Cursor_t at = _YATL_EMPTY_CURSOR;
+  at.line = item->line;
+  at.pos = item->pos;
+  return YATL_span_find_next(parent, (YATL_Cursor_t *)&at, out_span);
+}
+
+static void _path_push(const YATL_Span_t *span, YATL_Span_t out_spans[],
+                       size_t max_spans, size_t *depth) {
+  if (*depth < max_spans)
+    out_spans[*depth] = *span;
+  (*depth)++;
+}
+
+// Appends span and, while the position lies inside them, its nested
+// key-values and values
+static void _path_descend(const YATL_Span_t *span, const _YATL_Line_t *line,
+                          size_t pos, YATL_Span_t out_spans[], size_t max_spans,
+                          size_t *depth) {
+  _path_push(span, out_spans, max_spans, depth);
+
+  YATL_SpanType_t type = YATL_span_type(span);
+  if (type == YATL_S_LEAF_KEYVAL) {
+    YATL_Span_t key, val;
+    if (YATL_span_keyval_slice(span, &key, &val) != YATL_OK)
+      return;
+    const _YATL_Span_t *_val = (const _YATL_Span_t *)&val;
+    if (_pos_within(line, pos, _val->c_start.line, _val->c_start.pos,
+                    _val->c_end.line, _val->c_end.pos))
+      _path_descend(&val, line, pos, out_spans, max_spans, depth);
+    return;
+  }
+  if (type != YATL_S_NODE_ARRAY && type != YATL_S_NODE_INLINE_TABLE)
+    return;
+
+  YATL_Cursor_t cursor = YATL_cursor_create();
+  YATL_Span_t child;
+  while (YATL_span_find_next(span, &cursor, &child) == YATL_OK) {
+    const _YATL_Span_t *_child = (const _YATL_Span_t *)&child;
+    if (_pos_cmp(line, pos, _child->c_start.line, _child->c_start.pos) < 0)
+      return; // children are in order, the position is between them
+    if (_pos_within(line, pos, _child->c_start.line, _child->c_start.pos,
+                    _child->c_end.line, _child->c_end.pos)) {
+      _path_descend(&child, line, pos, out_spans, max_spans, depth);
+      return;
+    }
+  }
+}
+
+// ---------------------------------------------------------------------
+// Public API
+// ---------------------------------------------------------------------
+
+YATL_Result_t YATL_doc_cursor_at(const YATL_Doc_t *doc, size_t line,
+                                 size_t col, YATL_Cursor_t *out_cursor) {
+  if (!doc || !out_cursor)
+    return YATL_ERR_INVALID_ARG;
+  _YATL_SpanIndex_t *index;
+  YATL_Result_t res = _index_get(doc, &index);
+  if (res != YATL_OK)
+    return res;
+  if (line == 0 || line > index->nlines || col > index->lines[line - 1]->len)
+    return YATL_ERR_NOT_FOUND;
+
+  _YATL_Cursor_t *_out = (_YATL_Cursor_t *)out_cursor;
+  *_out = _YATL_EMPTY_CURSOR;
+  _out->line = index->lines[line - 1];
+  _out->pos = col;
+  return YATL_OK;
+}
+
+YATL_Result_t YATL_doc_cursor_at_offset(const YATL_Doc_t *doc, size_t offset,
+                                        YATL_Cursor_t *out_cursor) {
+  if (!doc || !out_cursor)
+    return YATL_ERR_INVALID_ARG;
+  _YATL_SpanIndex_t *index;
+  YATL_Result_t res = _index_get(doc, &index);
+  if (res != YATL_OK)
+    return res;
+
+  // Last line starting at or before offset
+  size_t lo = 0, hi = index->nlines;
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (index->offsets[mid] <= offset)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  if (lo == 0)
+    return YATL_ERR_NOT_FOUND;
+  size_t col = offset - index->offsets[lo - 1];
+  if (col > index->lines[lo - 1]->len)
+    return YATL_ERR_NOT_FOUND; // past the end of the document
+
+  _YATL_Cursor_t *_out = (_YATL_Cursor_t *)out_cursor;
+  *_out = _YATL_EMPTY_CURSOR;
+  _out->line = index->lines[lo - 1];
+  _out->pos = col;
+  return YATL_OK;
+}
+
+YATL_Result_t YATL_doc_span_at(const YATL_Doc_t *doc, const YATL_Cursor_t *at,
+                               YATL_Span_t out_spans[], size_t max_spans,
+                               size_t *out_depth) {
+  if (!doc || !at || !out_depth || (max_spans > 0 && !out_spans))
+    return YATL_ERR_INVALID_ARG;
+  const _YATL_Cursor_t *_at = (const _YATL_Cursor_t *)at;
+  YATL_Result_t res = _YATL_check_cursor(_at);
+  if (res != YATL_OK)
+    return res;
+  if (!_at->line || _at->line->doc != (const _YATL_Doc_t *)doc)
+    return YATL_ERR_INVALID_ARG;
+  _YATL_SpanIndex_t *index;
+  res = _index_get(doc, &index);
+  if (res != YATL_OK)
+    return res;
+
+  *out_depth = 0;
+  const _YATL_IndexItem_t *top =
+      _index_find(index->items, index->nitems, _at->line, _at->pos);
+  if (!top)
+    return YATL_ERR_NOT_FOUND;
+
+  YATL_Span_t doc_span, top_span;
+  YATL_doc_span(doc, &doc_span);
+  res = _index_item_span(&doc_span, top, &top_span);
+  if (res != YATL_OK)
+    return res;
+  if (YATL_span_type(&top_span) == YATL_S_LEAF_KEYVAL) {
+    _path_descend(&top_span, _at->line, _at->pos, out_spans, max_spans,
+                  out_depth);
+    return YATL_OK;
+  }
+
+  _path_push(&top_span, out_spans, max_spans, out_depth);
+  const _YATL_IndexItem_t *kid = _index_find(
+      index->kids + top->kids, top->nkids, _at->line, _at->pos);
+  if (kid) {
+    YATL_Span_t kid_span;
+    res = _index_item_span(&top_span, kid, &kid_span);
+    if (res != YATL_OK)
+      return res;
+    _path_descend(&kid_span, _at->line, _at->pos, out_spans, max_spans,
+                  out_depth);
+  }
+  return YATL_OK;
+}
@@ -1,6 +1,5 @@
 #include "yatl_lexer.h"
 #include "yatl_private.h"
-#include <string.h>
 
 const char *_TOMLToken_name(_TOMLToken_t token) {
   switch (token) {
@@ -35,7 +34,44 @@ const char *_TOMLToken_name(_TOMLToken_t token) {
   }
 }
 
+// ---------------------------------------------------------------------
+// Character class table
+// ---------------------------------------------------------------------
+
+#define _CC_OF(c)                                                              \
+  (((c) == ' ' || (c) == '\t' ? _CC_WS | _CC_VALUE_END : 0) |                 \
+   ((c) == '\n' || (c) == '\r' ? _CC_NEWLINE : 0) |                           \
+   (((c) >= 'A' && (c) <= 'Z') || ((c) >= 'a' && (c) <= 'z') ||               \
+            (c) == '_' || (c) == '-'                                           \
+        ? _CC_BARE                                                             \
+        : 0) |                                                                 \
+   ((c) >= '0' && (c) <= '9' ? _CC_BARE | _CC_DIGIT | _CC_HEX : 0) |           \
+   (((c) >= 'a' && (c) <= 'f') || ((c) >= 'A' && (c) <= 'F') ? _CC_HEX : 0) |  \
+   ((c) == '"' || (c) == '\'' ? _CC_QUOTE : 0) |                               \
+   ((c) == ']' || (c) == '}' || (c) == '#' ? _CC_VALUE_END : 0) |              \
+   ((c) == ',' ? _CC_COMMA | _CC_VALUE_END : 0))
+
+#define _CC_ROW(b)                                                             \
+  _CC_OF(b + 0x0), _CC_OF(b + 0x1), _CC_OF(b + 0x2), _CC_OF(b + 0x3),          \
+      _CC_OF(b + 0x4), _CC_OF(b + 0x5), _CC_OF(b + 0x6), _CC_OF(b + 0x7),      \
+      _CC_OF(b + 0x8), _CC_OF(b + 0x9), _CC_OF(b + 0xA), _CC_OF(b + 0xB),      \
+      _CC_OF(b + 0xC), _CC_OF(b + 0xD), _CC_OF(b + 0xE), _CC_OF(b + 0xF)
+
+const uint8_t _cclass[256] = {
+    _CC_ROW(0x00), _CC_ROW(0x10), _CC_ROW(0x20), _CC_ROW(0x30),
+    _CC_ROW(0x40), _CC_ROW(0x50), _CC_ROW(0x60), _CC_ROW(0x70),
+    _CC_ROW(0x80), _CC_ROW(0x90), _CC_ROW(0xA0), _CC_ROW(0xB0),
+    _CC_ROW(0xC0), _CC_ROW(0xD0), _CC_ROW(0xE0), _CC_ROW(0xF0),
+};
+
+#undef _CC_ROW
+#undef _CC_OF
+
 YATL_Result_t _skipWS(_YATL_Cursor_t *cursor) {
+  return _skipany(cursor, _CC_WS);
+}
+
+YATL_Result_t _skipany(_YATL_Cursor_t *cursor, uint8_t set) {
   if (!cursor)
     return YATL_ERR_INVALID_ARG;
   if (!cursor->line)
@@ -44,13 +80,15 @@ YATL_Result_t _skipWS(_YATL_Cursor_t *cursor) {
   _YATL_Cursor_t cr = *cursor;
 
   while (cr.line) {
-    while (cr.pos < cr.line->len) {
-      char c = cr.line->text[cr.pos];
-      if (!_is_ws(c)) {
-        *cursor = cr;
-        return YATL_OK;
-      }
-      cr.pos++;
+    const unsigned char *text = (const unsigned char *)cr.line->text;
+    size_t pos = cr.pos;
+    size_t len = cr.line->len;
+    while (pos < len && (_cclass[text[pos]] & set))
+      pos++;
+    if (pos < len) {
+      cr.pos = pos;
+      *cursor = cr;
+      return YATL_OK;
     }
     cr.line = cr.line->next;
     cr.pos = 0;
@@ -60,39 +98,44 @@ YATL_Result_t _skipWS(_YATL_Cursor_t *cursor) {
   return YATL_DONE;
 }
 
-YATL_Result_t _skipany(_YATL_Cursor_t *cursor, const char *chars) {
-  if (!cursor)
-    return YATL_ERR_INVALID_ARG;
-  if (!cursor->line)
-    return YATL_ERR_INVALID_ARG;
-  if (!chars)
-    return YATL_ERR_INVALID_ARG;
-
-  _YATL_Cursor_t cr = *cursor;
-  size_t chars_len = strlen(chars);
+YATL_Result_t _key_segment(const char *text, size_t len, size_t *pos,
+                           _TOMLKeySeg_t *out_seg, bool *out_more) {
+  size_t p = *pos;
+  while (p < len && _is_ws(text[p]))
+    p++;
+  if (p >= len)
+    return YATL_ERR_SYNTAX;
 
-  while (cr.line) {
-    while (cr.pos < cr.line->len) {
-      char c = cr.line->text[cr.pos];
-      bool skip = false;
-      for (size_t i = 0; i < chars_len; i++) {
-        if (c == chars[i]) {
-          skip = true;
-          break;
-        }
-      }
-      if (!skip) {
-        *cursor = cr;
-        return YATL_OK;
-      }
-      cr.pos++;
+  _TOMLKeySeg_t seg = {.start = p};
+  char c = text[p];
+  if (c == '"' || c == '\'') {
+    seg.s_start = ++p;
+    while (p < len && text[p] != c) {
+      if (c == '"' && text[p] == '\\')
+        p++; // escaped char
+      p++;
     }
-    cr.line = cr.line->next;
-    cr.pos = 0;
+    if (p >= len)
+      return YATL_ERR_SYNTAX; // unclosed quote
+    seg.s_end = p++;
+  } else {
+    seg.s_start = p;
+    while (p < len && _is_bare_key_char(text[p]))
+      p++;
+    if (p == seg.s_start)
+      return YATL_ERR_SYNTAX; // empty bare key
+    seg.s_end = p;
   }
-  cr.complete = true;
-  *cursor = cr;
-  return YATL_DONE;
+  seg.end = p;
+
+  while (p < len && _is_ws(text[p]))
+    p++;
+  *out_more = (p < len && text[p] == '.');
+  if (*out_more)
+    p++;
+  *pos = p;
+  *out_seg = seg;
+  return YATL_OK;
 }
 
 YATL_Result_t _consume(_YATL_Cursor_t *cursor, _TOMLToken_t token) {
@@ -136,22 +179,25 @@ YATL_Result_t _consume(_YATL_Cursor_t *cursor, _TOMLToken_t token) {
     return YATL_ERR_NOT_FOUND;
 
   case _TOML_TABLE_BODY:
-    while (cr.line) {
-      if (cr.pos == 0 && cr.line->len > 0 && cr.line->text[0] == '[') {
+  case _TOML_TABLE_ARRAY_BODY:
+    // Body runs until the next line starting with '['. Lines linked into a
+    // document carry a next-header pointer, so skipping a body is one jump.
+    if (cr.line->doc) {
+      if (cr.pos == 0 && cr.line->is_header) {
         *cursor = cr;
         return YATL_OK;
       }
-      if (!cr.line->next) {
+      if (cr.line->next_header) {
+        cr.line = cr.line->next_header;
+        cr.pos = 0;
+      } else {
+        cr.line = cr.line->doc->tail;
         cr.pos = cr.line->len;
-        *cursor = cr;
-        return YATL_OK;
       }
-      cr.line = cr.line->next;
-      cr.pos = 0;
+      *cursor = cr;
+      return YATL_OK;
     }
-    return YATL_ERR_NOT_FOUND;
-
-  case _TOML_TABLE_ARRAY_BODY:
+    // Detached lines (boneyard) are not indexed, walk them
     while (cr.line) {
       if (cr.pos == 0 && cr.line->len > 0 && cr.line->text[0] == '[') {
         *cursor = cr;
@@ -196,8 +242,9 @@ YATL_Result_t _consume(_YATL_Cursor_t *cursor, _TOMLToken_t token) {
         *cursor = cr;
         return YATL_OK;
       }
-      // Only bare key chars and whitespace are valid in unquoted context
-      if (!_is_bare_key_char(c) && !_is_ws(c)) {
+      // Only bare key chars, whitespace and dots (dotted keys) are valid in
+      // unquoted context
+      if (!_is_class(c, _CC_BARE | _CC_WS) && c != '.') {
         YATL_LOG(YATL_LOG_WARN,
                  "_TOML_KEY: illegal char '%c' (0x%02X) before '='", c,
                  (unsigned char)c);
@@ -307,9 +354,20 @@ YATL_Result_t _consume(_YATL_Cursor_t *cursor, _TOMLToken_t token) {
     }
 
     // Bare value (number, bool, date, etc.)
+    size_t bare_start = cr.pos;
     while (cr.pos < cr.line->len) {
       c = cr.line->text[cr.pos];
-      if (_is_ws(c) || c == ',' || c == ']' || c == '}' || c == '#') {
+      // RFC 3339 allows a space between date and time: "1979-05-27 07:32:00"
+      if (c == ' ' && cr.pos - bare_start == 10 &&
+          cr.line->text[bare_start + 4] == '-' &&
+          cr.line->text[bare_start + 7] == '-' && cr.pos + 3 < cr.line->len &&
+          _is_digit(cr.line->text[cr.pos + 1]) &&
+          _is_digit(cr.line->text[cr.pos + 2]) &&
+          cr.line->text[cr.pos + 3] == ':') {
+        cr.pos++;
+        continue;
+      }
+      if (_is_class(c, _CC_VALUE_END)) {
         if (_compare_cursor(&cr, cursor)) {
           YATL_LOG(YATL_LOG_WARN, "_TOML_VALUE: bare value has zero length");
           return YATL_ERR_NOT_FOUND;
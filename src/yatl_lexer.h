@@ -5,22 +5,38 @@
 
 // ---------------------------------------------------------------------
 // Character classification helpers
+//
+// Every predicate is a single lookup into _cclass, a 256-entry table of
+// class bits built at compile time in yatl_lexer.c. The bits double as
+// skip-sets for _skipany().
 // ---------------------------------------------------------------------
 
-static inline bool _is_ws(char c) { return c == ' ' || c == '\t'; }
+enum {
+  _CC_WS = 1 << 0,        // ' ' '\t'
+  _CC_NEWLINE = 1 << 1,   // '\n' '\r'
+  _CC_BARE = 1 << 2,      // bare key chars: A-Za-z0-9_-
+  _CC_DIGIT = 1 << 3,     // 0-9
+  _CC_HEX = 1 << 4,       // 0-9a-fA-F
+  _CC_QUOTE = 1 << 5,     // '"' '\''
+  _CC_VALUE_END = 1 << 6, // ends a bare value: ws , ] } #
+  _CC_COMMA = 1 << 7,     // ','
+};
 
-static inline bool _is_newline(char c) { return c == '\n' || c == '\r'; }
+extern const uint8_t _cclass[256];
 
-static inline bool _is_bare_key_char(char c) {
-  return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') ||
-         (c >= '0' && c <= '9') || c == '_' || c == '-';
+static inline bool _is_class(char c, uint8_t cls) {
+  return (_cclass[(unsigned char)c] & cls) != 0;
 }
 
-static inline bool _is_digit(char c) { return c >= '0' && c <= '9'; }
+static inline bool _is_ws(char c) { return _is_class(c, _CC_WS); }
 
-static inline bool _is_hex(char c) {
-  return _is_digit(c) || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
-}
+static inline bool _is_newline(char c) { return _is_class(c, _CC_NEWLINE); }
+
+static inline bool _is_bare_key_char(char c) { return _is_class(c, _CC_BARE); }
+
+static inline bool _is_digit(char c) { return _is_class(c, _CC_DIGIT); }
+
+static inline bool _is_hex(char c) { return _is_class(c, _CC_HEX); }
 
 // ---------------------------------------------------------------------
 // Token types for lexical consumption
@@ -53,9 +69,23 @@ const char *_TOMLToken_name(_TOMLToken_t token);
 // Returns YATL_DONE if end of document reached
 YATL_Result_t _skipWS(_YATL_Cursor_t *cursor);
 
-// Skip any characters in the given set (plus whitespace), crossing newlines
+// Skip any characters whose class intersects the skip-set (a mask of _CC_*
+// bits), crossing newlines
 // Returns YATL_DONE if end of document reached
-YATL_Result_t _skipany(_YATL_Cursor_t *cursor, const char *chars);
+YATL_Result_t _skipany(_YATL_Cursor_t *cursor, uint8_t set);
 
 // Consume a token, advancing cursor to end of token
 YATL_Result_t _consume(_YATL_Cursor_t *cursor, _TOMLToken_t token);
+
+// One simple key of a (possibly dotted) key, as byte offsets into the text
+typedef struct {
+  size_t start, end;     // Lexical bounds (quotes included)
+  size_t s_start, s_end; // Content bounds (quotes excluded, escapes kept)
+} _TOMLKeySeg_t;
+
+// Read one simple key (bare, "basic" or 'literal') from text[*pos..len),
+// skipping surrounding whitespace. If a '.' follows, it is consumed and
+// *out_more is set. *pos ends after the trailing whitespace/dot.
+// Returns YATL_ERR_SYNTAX if no valid simple key starts at *pos
+YATL_Result_t _key_segment(const char *text, size_t len, size_t *pos,
+                           _TOMLKeySeg_t *out_seg, bool *out_more);
@@ -2,10 +2,16 @@
 #include "yatl.h"
 #include <stdint.h>
 
+// POSIX file descriptors and writev, used for saving and streaming
+#if defined(__unix__) || defined(__APPLE__)
+#define _YATL_HAVE_WRITEV 1
+#endif
+
 #define YATL_CURSOR_MAGIC 0x43555253 // 'CURS'
 #define YATL_SPAN_MAGIC 0x5350414E   // 'SPAN'
 #define YATL_DOC_MAGIC 0x444F4354    // 'DOCT'
 #define YATL_LINE_MAGIC 0x4C494E45   // 'LINE'
+#define YATL_QUERY_MAGIC 0x51555259  // 'QURY'
 
 // YATL private header - not part of public API
 //
@@ -21,8 +27,21 @@ typedef struct _YATL_Line {
   char *text;
   size_t len;
   uint32_t linenum; // line number in document (starting from 1)
+  // Line number in the file last loaded or saved, 0 for lines created since;
+  // see YATL_doc_diff
+  uint32_t origin_line;
+  // Byte offset of the line in the file last loaded or saved, SIZE_MAX for
+  // lines created or moved since; see YATL_doc_save_incremental
+  size_t origin;
   struct _YATL_Line *prev, *next;
   _YATL_Doc_t *doc; // Back-pointer to owning document (for boneyard access)
+  struct _YATL_Line *next_header; // First header line after this one (NULL if
+                                  // none), see _line_index_repair
+  bool is_header;                 // Line starts with '['
+  // Lazily computed hash of a header line's table name, see _line_name_hash
+  bool name_hashed;
+  uint16_t name_nsegs; // number of dotted segments, 0 if unparsable
+  uint32_t name_hash;
 } _YATL_Line_t;
 
 typedef struct _YATL_Cursor {
@@ -32,6 +51,16 @@ typedef struct _YATL_Cursor {
   bool complete;
 } _YATL_Cursor_t;
 
+// Value kind recorded in the keyval cache. Decides the value span type and
+// whether the value has semantic (quote-stripped) bounds.
+typedef enum {
+  _YATL_VK_BARE,         // number, bool, datetime: semantic == lexical
+  _YATL_VK_STRING,       // single-line basic or literal string
+  _YATL_VK_STRING_ML,    // multiline string: no semantic bounds
+  _YATL_VK_ARRAY,        // [...]
+  _YATL_VK_INLINE_TABLE, // {...}
+} _YATL_ValueKind_t;
+
 typedef struct {
   uint32_t magic; // YATL_SPAN_MAGIC
   YATL_SpanType_t type;
@@ -40,12 +69,40 @@ typedef struct {
   _YATL_Cursor_t
       s_c_start; // Semantic start (content only, NULL line if same as lexical)
   _YATL_Cursor_t s_c_end; // Semantic end (NULL line if same as lexical)
+
+  // Keyval boundary cache, filled by YATL_span_find_next for
+  // YATL_S_LEAF_KEYVAL spans so slicing does not re-lex the value. The raw
+  // key runs from c_start to '='; it is parsed the first time the key is
+  // asked for and its bounds kept here (key_parsed). Key and '=' positions
+  // and val_start are on c_start.line, val_end is on c_end.line. Only valid
+  // when cached is set.
+  struct {
+    uint32_t key_start, key_end; // Semantic key bounds (quotes excluded)
+    uint32_t eq;                 // Position of '='
+    uint32_t val_start, val_end; // Lexical value bounds
+    uint8_t val_kind;            // _YATL_ValueKind_t
+    bool key_quoted;
+    bool key_parsed;
+    bool cached;
+  } kv;
+  // Set on document spans by YATL_doc_span, so an insert into a document
+  // without lines still finds it; NULL otherwise
+  _YATL_Doc_t *doc;
 } _YATL_Span_t;
 
 // ---------------------------------------------------------------------
 // Document - doubly linked list of lines
 // ---------------------------------------------------------------------
 
+// The file a document was last loaded from or saved to, all zero if none.
+// Line origins are only trusted while the file on disk still matches.
+typedef struct {
+  uint64_t dev;
+  uint64_t ino;
+  int64_t mtime_sec;
+  int64_t mtime_nsec;
+} _YATL_FileId_t;
+
 struct _YATL_Doc {
   uint32_t magic; // YATL_DOC_MAGIC
   _YATL_Line_t *head;
@@ -53,8 +110,39 @@ struct _YATL_Doc {
   _YATL_Line_t *boneyard_head; // Head of deleted lines list (freed on doc_free
                                // or clear_boneyard)
   _YATL_Line_t *boneyard_tail; // Tail for O(1) append
+  // Bumped whenever lines are linked or unlinked (_doc_append_line,
+  // _line_relink, _line_unlink); derived indexes compare against it
+  uint64_t gen;
+  struct _YATL_SpanIndex *span_index; // Lazily built, see yatl_index.c
+  struct _YATL_Journal *txn; // Open transaction's splices, see yatl_txn.c
+  struct _YATL_History *history; // Undo steps, NULL unless a limit is set
+  size_t origin_size; // Size of the file last loaded or saved
+  _YATL_FileId_t origin_file;
+  // Lines of the file last loaded or saved were freed from the boneyard, so
+  // YATL_doc_diff can no longer show them as removed
+  bool origin_lost;
+  // Set by YATL_doc_freeze; edits are refused and nothing is built lazily
+  bool frozen;
 };
 
+// One segment of a dotted lookup path (content only, quotes stripped)
+typedef struct {
+  const char *text;
+  size_t len;
+  size_t index;  // [n] element selector, _YATL_NO_INDEX if none
+  uint32_t hash; // _hash_name of the segments up to and including this one,
+                 // joined by '.'; compared against _line_name_hash
+} _YATL_PathSeg_t;
+
+#define _YATL_NO_INDEX SIZE_MAX
+
+// Compiled lookup path, see YATL_query_compile
+typedef struct {
+  uint32_t magic;        // YATL_QUERY_MAGIC
+  _YATL_PathSeg_t *segs; // single allocation, path copy follows the segments
+  size_t nsegs;
+} _YATL_Query_t;
+
 static const _YATL_Span_t _YATL_EMPTY_SPAN = {
     .magic = YATL_SPAN_MAGIC,
     .c_start = {.magic = YATL_CURSOR_MAGIC},
@@ -68,6 +156,8 @@ static const _YATL_Doc_t _YATL_EMPTY_DOC = {.magic = YATL_DOC_MAGIC};
 
 static const _YATL_Line_t _YATL_EMPTY_LINE = {.magic = YATL_LINE_MAGIC};
 
+static const _YATL_Query_t _YATL_EMPTY_QUERY = {.magic = YATL_QUERY_MAGIC};
+
 // ---------------------------------------------------------------------
 // Magic value validation
 // Use at entry points of functions that receive these types as input
@@ -104,6 +194,16 @@ static inline YATL_Result_t _YATL_check_doc(const _YATL_Doc_t *d) {
   return YATL_OK;
 }
 
+static inline YATL_Result_t _YATL_check_query(const _YATL_Query_t *q) {
+  if (q && q->magic != YATL_QUERY_MAGIC) {
+    YATL_LOG(YATL_LOG_ERROR,
+             "Query not initialized (magic: 0x%08X, expected: 0x%08X)",
+             q->magic, YATL_QUERY_MAGIC);
+    return YATL_ERR_INVALID_ARG;
+  }
+  return YATL_OK;
+}
+
 static inline YATL_Result_t _YATL_check_line(const _YATL_Line_t *l) {
   if (l && l->magic != YATL_LINE_MAGIC) {
     YATL_LOG(YATL_LOG_ERROR,
@@ -132,6 +232,55 @@ void _line_unlink(_YATL_Line_t *line);
 void _line_relink(_YATL_Doc_t *doc, _YATL_Line_t *line, _YATL_Line_t *before);
 void _boneyard_append(_YATL_Doc_t *doc, _YATL_Line_t *first);
 
+// One _doc_splice: the run first..last (NULL for a pure insertion) was
+// replaced by new_first..new_last (NULL for a pure removal) in front of
+// before (NULL at the end of the document).
+typedef struct {
+  _YATL_Line_t *first, *last;
+  _YATL_Line_t *new_first, *new_last;
+  _YATL_Line_t *before;
+} _YATL_Splice_t;
+
+typedef struct _YATL_Journal _YATL_Journal_t;
+typedef struct _YATL_History _YATL_History_t;
+
+// Line splicing (yatl_txn.c). Replaces first..last with the chain
+// new_first..new_last (linked through next, may be NULL), or inserts the
+// chain in front of before when first is NULL. Old lines go to the
+// boneyard, the header index is repaired and an open transaction, or else
+// the undo history, records the splice. Fails with YATL_ERR_NOMEM, or
+// YATL_ERR_INVALID_ARG if the document is frozen, before anything changes.
+YATL_Result_t _doc_splice(_YATL_Doc_t *doc, _YATL_Line_t *first,
+                          _YATL_Line_t *last, _YATL_Line_t *new_first,
+                          _YATL_Line_t *new_last, _YATL_Line_t *before);
+// Undoes a splice; the document must be as the splice left it
+void _splice_revert(_YATL_Doc_t *doc, const _YATL_Splice_t *splice);
+void _journal_free(_YATL_Journal_t *journal);
+// Undo history (yatl_txn.c). Cleared when the boneyard lines it refers to
+// are freed.
+void _history_free(_YATL_History_t *history);
+void _history_clear(_YATL_History_t *history);
+
+#ifdef _YATL_HAVE_WRITEV
+// Writes every line and its newline to fd with batched writev (yatl_writer.c)
+YATL_Result_t _doc_write_fd(const _YATL_Doc_t *doc, int fd);
+// Reads the device, inode and modification time of fd, zeroed on failure
+void _file_id_get(int fd, _YATL_FileId_t *id);
+#endif
+
+// Position index (yatl_index.c). Freed with the document.
+void _span_index_free(_YATL_Doc_t *doc);
+// Builds the index now unless it is current
+YATL_Result_t _span_index_prepare(_YATL_Doc_t *doc);
+
+// Header index maintenance. Every linked line caches is_header and
+// next_header so table bodies are skipped with a single jump. After lines
+// are linked into or removed from a document, call with the last line whose
+// successor changed. The first nforce lines walking backward (the newly
+// linked ones) are reclassified unconditionally; the walk then continues
+// until a line whose cached next_header is already correct.
+void _line_index_repair(_YATL_Line_t *line, size_t nforce);
+
 // ---------------------------------------------------------------------
 // Span unlink/relink - atomic modification support
 //
@@ -161,6 +310,36 @@ YATL_Result_t _YATL_span_relink(YATL_Doc_t *doc, YATL_Span_t *span,
                                 const YATL_Cursor_t *prefix_cursor,
                                 const YATL_Cursor_t *suffix_cursor);
 
+// Replaces a value (or a key-value's value) including its quotes or
+// brackets with text, which must be a complete single-line TOML value.
+// Validation and rollback follow YATL_span_ml_set_value; on success span
+// is updated to cover the new value.
+YATL_Result_t _YATL_span_replace_value(YATL_Span_t *span, const char *text,
+                                       size_t len);
+
+// TOML string encoding (yatl_value.c). _string_encoded_len returns the
+// quoted length and picks literal quoting when that avoids escapes;
+// _encode_string writes exactly that many bytes.
+size_t _string_encoded_len(const char *str, size_t len, bool *literal);
+void _encode_string(const char *str, size_t len, bool literal, char *out);
+
+// FNV-1a hash for key name lookups. _hash_name_add continues a running
+// hash so dotted names can be hashed segment by segment.
+#define _HASH_NAME_BASIS 2166136261u
+
+static inline uint32_t _hash_name_add(uint32_t h, const char *name,
+                                      size_t len) {
+  for (size_t i = 0; i < len; i++) {
+    h ^= (unsigned char)name[i];
+    h *= 16777619u;
+  }
+  return h;
+}
+
+static inline uint32_t _hash_name(const char *name, size_t len) {
+  return _hash_name_add(_HASH_NAME_BASIS, name, len);
+}
+
 static inline bool _compare_cursor(const _YATL_Cursor_t *a,
                                    const _YATL_Cursor_t *b) {
   if (a->line == b->line && a->pos == b->pos) {
@@ -0,0 +1,180 @@
+#include "yatl_private.h"
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _YATL_HAVE_WRITEV
+#include <errno.h>
+#include <unistd.h>
+#endif
+
+// ---------------------------------------------------------------------
+// Streaming filter
+//
+// The input is cut into chunks at header lines, the same lines the header
+// index treats as headers, so each chunk is the root table or one table.
+// A chunk is loaded into a scratch document, shown to the callback and
+// written out before the next one is read. Chunks the callback left alone
+// are copied through byte for byte.
+// ---------------------------------------------------------------------
+
+#ifdef _YATL_HAVE_WRITEV
+
+#define _YATL_STREAM_READ 65536
+
+static YATL_Result_t _write_all(int fd, const char *buf, size_t len) {
+  while (len > 0) {
+    ssize_t n = write(fd, buf, len);
+    if (n < 0) {
+      if (errno == EINTR)
+        continue;
+      return YATL_ERR_IO;
+    }
+    buf += n;
+    len -= (size_t)n;
+  }
+  return YATL_OK;
+}
+
+// Calls fn for every key-value in span. The callback may change the value
+// through the span; iteration resumes from the span's updated end.
+static YATL_Result_t _stream_keyvals(const _YATL_Doc_t *doc,
+                                     const YATL_Span_t *span,
+                                     YATL_StreamFn_t fn, void *ctx) {
+  YATL_Cursor_t cursor = YATL_cursor_create();
+  YATL_Span_t kv;
+  YATL_Result_t res;
+  while ((res = YATL_span_find_next(span, &cursor, &kv)) == YATL_OK) {
+    if (YATL_span_type(&kv) != YATL_S_LEAF_KEYVAL)
+      continue;
+    res = fn(ctx, &kv);
+    if (res != YATL_OK)
+      return res;
+    _YATL_Cursor_t end = ((const _YATL_Span_t *)&kv)->c_end;
+    if (!end.line || end.line->doc != doc)
+      return YATL_ERR_INVALID_ARG; // the key-value was removed
+    ((_YATL_Cursor_t *)&cursor)->line = end.line;
+    ((_YATL_Cursor_t *)&cursor)->pos = end.pos;
+  }
+  return res == YATL_DONE || res == YATL_ERR_NOT_FOUND ? YATL_OK : res;
+}
+
+// Shows one chunk to the callback and writes it to out_fd
+static YATL_Result_t _stream_chunk(const char *buf, size_t len, int out_fd,
+                                   YATL_StreamFn_t fn, void *ctx) {
+  YATL_Doc_t doc;
+  YATL_Result_t res = YATL_doc_loads(&doc, buf, len);
+  if (res != YATL_OK)
+    return res;
+  _YATL_Doc_t *_doc = (_YATL_Doc_t *)&doc;
+  uint64_t gen = _doc->gen;
+
+  YATL_Span_t doc_span, table;
+  YATL_Span_t *span = &doc_span;
+  res = YATL_doc_span(&doc, &doc_span);
+  if (res == YATL_OK && _doc->head->is_header) {
+    span = &table;
+    YATL_Cursor_t cursor = YATL_cursor_create();
+    res = YATL_span_find_next(&doc_span, &cursor, &table);
+    if (res == YATL_OK)
+      res = fn(ctx, &table);
+    if (res == YATL_OK && _doc->gen != gen) {
+      // The table was edited; find it again
+      cursor = YATL_cursor_create();
+      res = YATL_doc_span(&doc, &doc_span);
+      if (res == YATL_OK && _doc->head && _doc->head->is_header)
+        res = YATL_span_find_next(&doc_span, &cursor, &table);
+      else if (res == YATL_OK)
+        res = YATL_DONE; // removed
+    }
+  }
+  if (res == YATL_OK)
+    res = _stream_keyvals(_doc, span, fn, ctx);
+  else if (res == YATL_DONE)
+    res = YATL_OK;
+
+  if (res == YATL_OK)
+    res = _doc->gen == gen ? _write_all(out_fd, buf, len)
+                           : _doc_write_fd(_doc, out_fd);
+  YATL_doc_free(&doc);
+  return res;
+}
+
+YATL_Result_t YATL_stream_filter(int in_fd, int out_fd, YATL_StreamFn_t fn,
+                                 void *ctx) {
+  if (in_fd < 0 || out_fd < 0 || !fn)
+    return YATL_ERR_INVALID_ARG;
+
+  char *buf = NULL;
+  size_t len = 0, cap = 0;
+  size_t start = 0; // start of the current chunk
+  size_t scan = 0;  // start of the first line not yet classified
+  bool eof = false;
+  YATL_Result_t res = YATL_OK;
+
+  while (res == YATL_OK) {
+    // Classify complete lines; a header line ends the chunk before it
+    bool cut = false;
+    while (scan < len) {
+      const char *nl = memchr(buf + scan, '\n', len - scan);
+      if (!nl && !eof)
+        break;
+      if (buf[scan] == '[' && scan > start) {
+        cut = true;
+        break;
+      }
+      scan = nl ? (size_t)(nl - buf) + 1 : len;
+    }
+    if (cut || (eof && scan > start)) {
+      res = _stream_chunk(buf + start, scan - start, out_fd, fn, ctx);
+      start = scan;
+      continue;
+    }
+    if (eof)
+      break;
+
+    // Drop written chunks, then grow if a read would not fit
+    if (start > 0) {
+      memmove(buf, buf + start, len - start);
+      len -= start;
+      scan -= start;
+      start = 0;
+    }
+    if (cap - len < _YATL_STREAM_READ) {
+      size_t new_cap = cap ? cap * 2 : 2 * _YATL_STREAM_READ;
+      while (new_cap - len < _YATL_STREAM_READ)
+        new_cap *= 2;
+      char *p = realloc(buf, new_cap);
+      if (!p) {
+        res = YATL_ERR_NOMEM;
+        break;
+      }
+      buf = p;
+      cap = new_cap;
+    }
+    ssize_t n = read(in_fd, buf + len, cap - len);
+    if (n < 0) {
+      if (errno != EINTR)
+        res = YATL_ERR_IO;
+      continue;
+    }
+    if (n == 0)
+      eof = true;
+    len += (size_t)n;
+  }
+
+  free(buf);
+  return res;
+}
+
+#else
+
+YATL_Result_t YATL_stream_filter(int in_fd, int out_fd, YATL_StreamFn_t fn,
+                                 void *ctx) {
+  (void)in_fd;
+  (void)out_fd;
+  (void)fn;
+  (void)ctx;
+  return YATL_ERR_IO; // needs POSIX file descriptors
+}
+
+#endif
@@ -0,0 +1,363 @@
+#include "yatl_private.h"
+#include <stdlib.h>
+#include <string.h>
+
+// ---------------------------------------------------------------------
+// Line splicing, edit transactions and undo
+//
+// Every edit that swaps document lines goes through _doc_splice. Replaced
+// lines move to the boneyard as before; while a transaction is open each
+// splice is also recorded in a journal. Commit just drops the journal,
+// abort replays it backwards, relinking boneyard lines with _line_relink.
+//
+// With an undo limit set, each splice outside a transaction, and each
+// committed transaction as a whole, becomes one step of the undo history.
+// Undo reverts a step's splices like abort does; redo swaps the lines back.
+// ---------------------------------------------------------------------
+
+struct _YATL_Journal {
+  _YATL_Splice_t *entries;
+  size_t n, cap;
+};
+
+struct _YATL_History {
+  _YATL_Splice_t *splices; // oldest first
+  size_t nsplices, splice_cap;
+  size_t *steps; // steps[i] is the index of the first splice of step i
+  size_t nsteps, step_cap;
+  size_t first; // oldest step that can still be undone
+  size_t done;  // steps applied; steps done..nsteps can be redone
+  size_t limit;
+};
+
+// Reserves room for one more journal entry so a splice never fails after
+// the document has been changed
+static YATL_Result_t _journal_reserve(_YATL_Journal_t *journal) {
+  if (journal->n < journal->cap)
+    return YATL_OK;
+  size_t cap = journal->cap ? journal->cap * 2 : 16;
+  _YATL_Splice_t *entries = realloc(journal->entries, cap * sizeof(*entries));
+  if (!entries)
+    return YATL_ERR_NOMEM;
+  journal->entries = entries;
+  journal->cap = cap;
+  return YATL_OK;
+}
+
+void _journal_free(_YATL_Journal_t *journal) {
+  if (!journal)
+    return;
+  free(journal->entries);
+  free(journal);
+}
+
+void _history_free(_YATL_History_t *history) {
+  if (!history)
+    return;
+  free(history->splices);
+  free(history->steps);
+  free(history);
+}
+
+void _history_clear(_YATL_History_t *history) {
+  if (history)
+    history->nsplices = history->nsteps = history->first = history->done = 0;
+}
+
+// End of step i's splices
+static size_t _step_end(const _YATL_History_t *history, size_t i) {
+  return i + 1 < history->nsteps ? history->steps[i + 1] : history->nsplices;
+}
+
+// Reserves room for a new step of n splices, replacing any redo steps
+static YATL_Result_t _history_reserve(_YATL_History_t *history, size_t n) {
+  size_t base = history->done < history->nsteps ? history->steps[history->done]
+                                                 : history->nsplices;
+  if (base + n > history->splice_cap) {
+    size_t cap = history->splice_cap ? history->splice_cap : 16;
+    while (cap < base + n)
+      cap *= 2;
+    _YATL_Splice_t *splices =
+        realloc(history->splices, cap * sizeof(*splices));
+    if (!splices)
+      return YATL_ERR_NOMEM;
+    history->splices = splices;
+    history->splice_cap = cap;
+  }
+  if (history->done + 1 > history->step_cap) {
+    size_t cap = history->step_cap ? history->step_cap * 2 : 16;
+    size_t *steps = realloc(history->steps, cap * sizeof(*steps));
+    if (!steps)
+      return YATL_ERR_NOMEM;
+    history->steps = steps;
+    history->step_cap = cap;
+  }
+  return YATL_OK;
+}
+
+// Drops steps older than the limit. They are only compacted away once as
+// many have piled up as the limit, so each push costs O(1) amortized.
+static void _history_trim(_YATL_History_t *history) {
+  if (history->done - history->first > history->limit)
+    history->first = history->done - history->limit;
+  if (history->first < history->limit)
+    return;
+  size_t drop = history->first;
+  size_t base =
+      drop < history->nsteps ? history->steps[drop] : history->nsplices;
+  memmove(history->splices, history->splices + base,
+          (history->nsplices - base) * sizeof(*history->splices));
+  history->nsplices -= base;
+  for (size_t i = drop; i < history->nsteps; i++)
+    history->steps[i - drop] = history->steps[i] - base;
+  history->nsteps -= drop;
+  history->done -= drop;
+  history->first = 0;
+}
+
+// Records n splices as one step; _history_reserve must have succeeded
+static void _history_push(_YATL_History_t *history,
+                          const _YATL_Splice_t *splices, size_t n) {
+  if (history->done < history->nsteps) {
+    history->nsplices = history->steps[history->done];
+    history->nsteps = history->done;
+  }
+  history->steps[history->nsteps++] = history->nsplices;
+  memcpy(history->splices + history->nsplices, splices, n * sizeof(*splices));
+  history->nsplices += n;
+  history->done = history->nsteps;
+  _history_trim(history);
+}
+
+// Links the chain first..last into doc between after and before
+static size_t _chain_link(_YATL_Doc_t *doc, _YATL_Line_t *first,
+                          _YATL_Line_t *last, _YATL_Line_t *after,
+                          _YATL_Line_t *before) {
+  size_t n = 0;
+  _YATL_Line_t *line = first;
+  while (line) {
+    _YATL_Line_t *next = line->next;
+    line->doc = doc;
+    line->prev = after;
+    line->next = before;
+    if (after)
+      after->next = line;
+    else
+      doc->head = line;
+    if (before)
+      before->prev = line;
+    else
+      doc->tail = line;
+    after = line;
+    n++;
+    if (line == last)
+      break;
+    line = next;
+  }
+  doc->gen++;
+  return n;
+}
+
+// Moves the linked run first..last to the boneyard
+static void _chain_unlink(_YATL_Line_t *first, _YATL_Line_t *last) {
+  _YATL_Line_t *line = first;
+  while (line) {
+    _YATL_Line_t *next = line->next;
+    _line_unlink(line);
+    if (line == last)
+      break;
+    line = next;
+  }
+}
+
+YATL_Result_t _doc_splice(_YATL_Doc_t *doc, _YATL_Line_t *first,
+                          _YATL_Line_t *last, _YATL_Line_t *new_first,
+                          _YATL_Line_t *new_last, _YATL_Line_t *before) {
+  if (doc->frozen)
+    return YATL_ERR_INVALID_ARG;
+  YATL_Result_t res = YATL_OK;
+  if (doc->txn)
+    res = _journal_reserve(doc->txn);
+  else if (doc->history)
+    res = _history_reserve(doc->history, 1);
+  if (res != YATL_OK)
+    return res;
+
+  _YATL_Line_t *after = first ? first->prev : before ? before->prev : doc->tail;
+  if (first)
+    before = last->next;
+  _YATL_Splice_t splice = {first, last, new_first, new_last, before};
+  if (doc->txn)
+    doc->txn->entries[doc->txn->n++] = splice;
+  else if (doc->history)
+    _history_push(doc->history, &splice, 1);
+
+  _chain_unlink(first, last);
+  size_t n =
+      new_first ? _chain_link(doc, new_first, new_last, after, before) : 0;
+  _line_index_repair(n ? new_last : after, n);
+  return YATL_OK;
+}
+
+// Swaps the linked run out_first..out_last for the boneyard run
+// in_first..in_last, placed in front of before
+static void _run_swap(_YATL_Doc_t *doc, _YATL_Line_t *out_first,
+                      _YATL_Line_t *out_last, _YATL_Line_t *in_first,
+                      _YATL_Line_t *in_last, _YATL_Line_t *before) {
+  _chain_unlink(out_first, out_last);
+
+  size_t n = 0;
+  _YATL_Line_t *line = in_first;
+  while (line) {
+    _YATL_Line_t *next = line->next; // boneyard successor
+    _line_relink(doc, line, before);
+    n++;
+    if (line == in_last)
+      break;
+    line = next;
+  }
+  _YATL_Line_t *tail = before ? before->prev : doc->tail;
+  _line_index_repair(tail, n);
+}
+
+void _splice_revert(_YATL_Doc_t *doc, const _YATL_Splice_t *splice) {
+  _run_swap(doc, splice->new_first, splice->new_last, splice->first,
+            splice->last, splice->before);
+}
+
+// Redoes a reverted splice; the document must be as the revert left it
+static void _splice_replay(_YATL_Doc_t *doc, const _YATL_Splice_t *splice) {
+  _run_swap(doc, splice->first, splice->last, splice->new_first,
+            splice->new_last, splice->before);
+}
+
+// ---------------------------------------------------------------------
+// Public API
+// ---------------------------------------------------------------------
+
+YATL_Result_t YATL_txn_begin(YATL_Doc_t *doc) {
+  if (!doc)
+    return YATL_ERR_INVALID_ARG;
+  _YATL_Doc_t *_doc = (_YATL_Doc_t *)doc;
+  YATL_Result_t res = _YATL_check_doc(_doc);
+  if (res != YATL_OK)
+    return res;
+  if (_doc->txn)
+    return YATL_ERR_INVALID_ARG; // no nesting
+  if (_doc->frozen)
+    return YATL_ERR_INVALID_ARG;
+
+  _doc->txn = calloc(1, sizeof(*_doc->txn));
+  return _doc->txn ? YATL_OK : YATL_ERR_NOMEM;
+}
+
+YATL_Result_t YATL_txn_commit(YATL_Doc_t *doc) {
+  if (!doc)
+    return YATL_ERR_INVALID_ARG;
+  _YATL_Doc_t *_doc = (_YATL_Doc_t *)doc;
+  YATL_Result_t res = _YATL_check_doc(_doc);
+  if (res != YATL_OK)
+    return res;
+  if (!_doc->txn)
+    return YATL_ERR_INVALID_ARG;
+
+  // The whole transaction becomes one undo step. Rather than fail a commit
+  // for want of memory, the history is dropped.
+  _YATL_Journal_t *journal = _doc->txn;
+  _YATL_History_t *history = _doc->history;
+  if (history && journal->n) {
+    if (_history_reserve(history, journal->n) == YATL_OK)
+      _history_push(history, journal->entries, journal->n);
+    else
+      _history_clear(history);
+  }
+  _journal_free(journal);
+  _doc->txn = NULL;
+  return YATL_OK;
+}
+
+YATL_Result_t YATL_txn_abort(YATL_Doc_t *doc) {
+  if (!doc)
+    return YATL_ERR_INVALID_ARG;
+  _YATL_Doc_t *_doc = (_YATL_Doc_t *)doc;
+  YATL_Result_t res = _YATL_check_doc(_doc);
+  if (res != YATL_OK)
+    return res;
+  if (!_doc->txn)
+    return YATL_ERR_INVALID_ARG;
+
+  _YATL_Journal_t *journal = _doc->txn;
+  for (size_t i = journal->n; i-- > 0;)
+    _splice_revert(_doc, &journal->entries[i]);
+  _journal_free(journal);
+  _doc->txn = NULL;
+  return YATL_OK;
+}
+
+YATL_Result_t YATL_doc_set_undo_limit(YATL_Doc_t *doc, size_t max_steps) {
+  if (!doc)
+    return YATL_ERR_INVALID_ARG;
+  _YATL_Doc_t *_doc = (_YATL_Doc_t *)doc;
+  YATL_Result_t res = _YATL_check_doc(_doc);
+  if (res != YATL_OK)
+    return res;
+  if (_doc->frozen)
+    return YATL_ERR_INVALID_ARG;
+
+  if (!max_steps) {
+    _history_free(_doc->history);
+    _doc->history = NULL;
+    return YATL_OK;
+  }
+  if (!_doc->history) {
+    _doc->history = calloc(1, sizeof(*_doc->history));
+    if (!_doc->history)
+      return YATL_ERR_NOMEM;
+  }
+  _YATL_History_t *history = _doc->history;
+  if (history->done < history->nsteps) { // drop redo steps
+    history->nsplices = history->steps[history->done];
+    history->nsteps = history->done;
+  }
+  history->limit = max_steps;
+  _history_trim(history);
+  return YATL_OK;
+}
+
+YATL_Result_t YATL_doc_undo(YATL_Doc_t *doc) {
+  if (!doc)
+    return YATL_ERR_INVALID_ARG;
+  _YATL_Doc_t *_doc = (_YATL_Doc_t *)doc;
+  YATL_Result_t res = _YATL_check_doc(_doc);
+  if (res != YATL_OK)
+    return res;
+  if (_doc->txn || _doc->frozen)
+    return YATL_ERR_INVALID_ARG;
+
+  _YATL_History_t *history = _doc->history;
+  if (!history || history->done == history->first)
+    return YATL_ERR_NOT_FOUND;
+  size_t step = --history->done;
+  for (size_t i = _step_end(history, step); i-- > history->steps[step];)
+    _splice_revert(_doc, &history->splices[i]);
+  return YATL_OK;
+}
+
+YATL_Result_t YATL_doc_redo(YATL_Doc_t *doc) {
+  if (!doc)
+    return YATL_ERR_INVALID_ARG;
+  _YATL_Doc_t *_doc = (_YATL_Doc_t *)doc;
+  YATL_Result_t res = _YATL_check_doc(_doc);
+  if (res != YATL_OK)
+    return res;
+  if (_doc->txn || _doc->frozen)
+    return YATL_ERR_INVALID_ARG;
+
+  _YATL_History_t *history = _doc->history;
+  if (!history || history->done == history->nsteps)
+    return YATL_ERR_NOT_FOUND;
+  size_t step = history->done++;
+  for (size_t i = history->steps[step]; i < _step_end(history, step); i++)
+    _splice_replay(_doc, &history->splices[i]);
+  return YATL_OK;
+}
@@ -0,0 +1,1002 @@
+#include "yatl_lexer.h"
+#include "yatl_private.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// ---------------------------------------------------------------------
+// Typed value access
+//
+// Bare values are parsed straight from the line text. Integers follow
+// the TOML grammar (sign only on decimals, '_' between digits, 0x/0o/0b
+// prefixes). Floats take Clinger's exact fast path when the decimal
+// significand fits in 53 bits and the power of ten in a double; anything
+// else goes to strtod with a normalized, locale-independent copy.
+// ---------------------------------------------------------------------
+
+// Resolves span (a value, or a key-value whose value is used) to the text
+// of a bare scalar. Strings, arrays and inline tables are YATL_ERR_TYPE.
+static YATL_Result_t _span_bare_text(const YATL_Span_t *span,
+                                     const char **out_text, size_t *out_len) {
+  if (!span || !out_text || !out_len)
+    return YATL_ERR_INVALID_ARG;
+  const _YATL_Span_t *_span = (const _YATL_Span_t *)span;
+  YATL_Result_t res = _YATL_check_span(_span);
+  if (res != YATL_OK)
+    return res;
+
+  YATL_Span_t key, val;
+  if (_span->type == YATL_S_LEAF_KEYVAL) {
+    res = YATL_span_keyval_slice(span, &key, &val);
+    if (res != YATL_OK)
+      return res;
+    _span = (const _YATL_Span_t *)&val;
+  }
+  if (_span->type != YATL_S_SLICE_VALUE || !_span->s_c_start.line ||
+      _span->s_c_start.line != _span->s_c_end.line)
+    return YATL_ERR_TYPE;
+  const _YATL_Line_t *line = _span->s_c_start.line;
+  if (_is_class(line->text[_span->c_start.pos], _CC_QUOTE))
+    return YATL_ERR_TYPE;
+
+  *out_text = line->text + _span->s_c_start.pos;
+  *out_len = _span->s_c_end.pos - _span->s_c_start.pos;
+  return *out_len ? YATL_OK : YATL_ERR_TYPE;
+}
+
+static int _digit_value(char c) {
+  if (c >= '0' && c <= '9')
+    return c - '0';
+  if (c >= 'a' && c <= 'f')
+    return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F')
+    return c - 'A' + 10;
+  return 99;
+}
+
+// Accumulates digits of the given base from text[*pos..len), allowing
+// single '_' between digits. Fails on overflow past limit.
+static YATL_Result_t _parse_digits(const char *text, size_t len, size_t *pos,
+                                   unsigned base, uint64_t limit,
+                                   uint64_t *out_value) {
+  uint64_t value = 0;
+  size_t p = *pos;
+  bool digit_before = false;
+  for (; p < len; p++) {
+    if (text[p] == '_') {
+      if (!digit_before || p + 1 >= len ||
+          _digit_value(text[p + 1]) >= (int)base)
+        return YATL_ERR_TYPE;
+      digit_before = false;
+      continue;
+    }
+    unsigned d = (unsigned)_digit_value(text[p]);
+    if (d >= base)
+      break;
+    if (value > (limit - d) / base)
+      return YATL_ERR_TYPE; // out of range
+    value = value * base + d;
+    digit_before = true;
+  }
+  if (p == *pos)
+    return YATL_ERR_TYPE;
+  *pos = p;
+  *out_value = value;
+  return YATL_OK;
+}
+
+static YATL_Result_t _parse_int64(const char *text, size_t len,
+                                  int64_t *out_value) {
+  size_t p = 0;
+  uint64_t value;
+  YATL_Result_t res;
+
+  if (len > 2 && text[0] == '0' &&
+      (text[1] == 'x' || text[1] == 'o' || text[1] == 'b')) {
+    unsigned base = text[1] == 'x' ? 16 : text[1] == 'o' ? 8 : 2;
+    p = 2;
+    res = _parse_digits(text, len, &p, base, INT64_MAX, &value);
+    if (res != YATL_OK || p != len)
+      return YATL_ERR_TYPE;
+    *out_value = (int64_t)value;
+    return YATL_OK;
+  }
+
+  bool negative = text[0] == '-';
+  if (text[0] == '+' || text[0] == '-')
+    p++;
+  if (p + 1 < len && text[p] == '0')
+    return YATL_ERR_TYPE; // leading zero
+  res = _parse_digits(text, len, &p, 10,
+                      negative ? (uint64_t)INT64_MAX + 1 : INT64_MAX, &value);
+  if (res != YATL_OK || p != len)
+    return YATL_ERR_TYPE;
+  *out_value = negative ? (int64_t)(0 - value) : (int64_t)value;
+  return YATL_OK;
+}
+
+// Significant digits kept for strtod; enough to round any double correctly
+#define _FLOAT_MAX_DIGITS 768
+
+static const double _pow10[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,
+                                1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+                                1e12, 1e13, 1e14, 1e15, 1e16, 1e17,
+                                1e18, 1e19, 1e20, 1e21, 1e22};
+
+static YATL_Result_t _parse_double(const char *text, size_t len,
+                                   double *out_value) {
+  size_t p = 0;
+  bool negative = text[0] == '-';
+  if (text[0] == '+' || text[0] == '-')
+    p++;
+
+  if (len - p == 3 && memcmp(text + p, "inf", 3) == 0) {
+    *out_value = negative ? -INFINITY : INFINITY;
+    return YATL_OK;
+  }
+  if (len - p == 3 && memcmp(text + p, "nan", 3) == 0) {
+    *out_value = negative ? -NAN : NAN;
+    return YATL_OK;
+  }
+  if (p + 1 < len && text[p] == '0' &&
+      (_is_digit(text[p + 1]) || text[p + 1] == '_'))
+    return YATL_ERR_TYPE; // leading zero
+
+  // Collect significant digits without '_' or '.', tracking the decimal
+  // exponent they are scaled by
+  char digits[_FLOAT_MAX_DIGITS + 1];
+  size_t ndigits = 0;
+  bool truncated = false;
+  uint64_t mantissa = 0;
+  int64_t exp10 = 0;
+  bool in_fraction = false;
+  bool digit_before = false;
+  size_t start = p;
+  for (; p < len; p++) {
+    char c = text[p];
+    if (c == '_') {
+      if (!digit_before || p + 1 >= len || !_is_digit(text[p + 1]))
+        return YATL_ERR_TYPE;
+      digit_before = false;
+      continue;
+    }
+    if (c == '.') {
+      if (in_fraction || !digit_before || p + 1 >= len ||
+          !_is_digit(text[p + 1]))
+        return YATL_ERR_TYPE;
+      in_fraction = true;
+      digit_before = false;
+      continue;
+    }
+    if (!_is_digit(c))
+      break;
+    digit_before = true;
+    if (ndigits == 0 && c == '0') {
+      if (in_fraction)
+        exp10--;
+      continue; // leading zeros are not significant
+    }
+    if (ndigits < _FLOAT_MAX_DIGITS) {
+      digits[ndigits++] = c;
+      if (ndigits <= 19)
+        mantissa = mantissa * 10 + (uint64_t)(c - '0');
+      if (in_fraction)
+        exp10--;
+    } else {
+      truncated |= (c != '0');
+      if (!in_fraction)
+        exp10++;
+    }
+  }
+  if (p == start)
+    return YATL_ERR_TYPE;
+
+  if (p < len && (text[p] == 'e' || text[p] == 'E')) {
+    p++;
+    bool exp_negative = p < len && text[p] == '-';
+    if (p < len && (text[p] == '+' || text[p] == '-'))
+      p++;
+    uint64_t exp_value;
+    // Clamped far beyond the double range, keeping exp10 from overflowing
+    if (_parse_digits(text, len, &p, 10, UINT64_MAX, &exp_value) != YATL_OK)
+      return YATL_ERR_TYPE;
+    if (exp_value > 100000)
+      exp_value = 100000;
+    exp10 += exp_negative ? -(int64_t)exp_value : (int64_t)exp_value;
+  }
+  if (p != len)
+    return YATL_ERR_TYPE;
+
+  if (ndigits == 0) {
+    *out_value = negative ? -0.0 : 0.0;
+    return YATL_OK;
+  }
+
+  // Clinger: both operands exact, so one rounding gives the exact result
+  if (ndigits <= 19 && mantissa <= (1ULL << 53) && exp10 >= -22 &&
+      exp10 <= 22) {
+    double value = (double)mantissa;
+    value = exp10 < 0 ? value / _pow10[-exp10] : value * _pow10[exp10];
+    *out_value = negative ? -value : value;
+    return YATL_OK;
+  }
+
+  // digits plus an exponent only: no decimal point, so no locale issue
+  char buf[_FLOAT_MAX_DIGITS + 32];
+  memcpy(buf, digits, ndigits);
+  size_t n = ndigits;
+  if (truncated) {
+    buf[n++] = '1'; // sticky digit for correct rounding
+    exp10--;
+  }
+  snprintf(buf + n, sizeof(buf) - n, "e%lld", (long long)exp10);
+  double value = strtod(buf, NULL);
+  *out_value = negative ? -value : value;
+  return YATL_OK;
+}
+
+// Reads exactly n decimal digits at text[*pos]
+static bool _fixed_digits(const char *text, size_t len, size_t *pos, size_t n,
+                          int *out_value) {
+  if (*pos + n > len)
+    return false;
+  int value = 0;
+  for (size_t i = 0; i < n; i++) {
+    char c = text[*pos + i];
+    if (!_is_digit(c))
+      return false;
+    value = value * 10 + (c - '0');
+  }
+  *pos += n;
+  *out_value = value;
+  return true;
+}
+
+static bool _expect(const char *text, size_t len, size_t *pos, char c) {
+  if (*pos >= len || text[*pos] != c)
+    return false;
+  (*pos)++;
+  return true;
+}
+
+// full-date = YYYY-MM-DD
+static bool _parse_date(const char *text, size_t len, size_t *pos,
+                        YATL_DateTime_t *dt) {
+  static const int days[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+  if (!_fixed_digits(text, len, pos, 4, &dt->year) ||
+      !_expect(text, len, pos, '-') ||
+      !_fixed_digits(text, len, pos, 2, &dt->month) ||
+      !_expect(text, len, pos, '-') ||
+      !_fixed_digits(text, len, pos, 2, &dt->day))
+    return false;
+  if (dt->month < 1 || dt->month > 12 || dt->day < 1)
+    return false;
+  bool leap = (dt->year % 4 == 0 && dt->year % 100 != 0) || dt->year % 400 == 0;
+  int mdays = days[dt->month - 1] + (dt->month == 2 && leap);
+  return dt->day <= mdays;
+}
+
+// partial-time = HH:MM:SS[.frac]
+static bool _parse_time(const char *text, size_t len, size_t *pos,
+                        YATL_DateTime_t *dt) {
+  if (!_fixed_digits(text, len, pos, 2, &dt->hour) ||
+      !_expect(text, len, pos, ':') ||
+      !_fixed_digits(text, len, pos, 2, &dt->minute) ||
+      !_expect(text, len, pos, ':') ||
+      !_fixed_digits(text, len, pos, 2, &dt->second))
+    return false;
+  if (dt->hour > 23 || dt->minute > 59 || dt->second > 60)
+    return false;
+  if (*pos < len && text[*pos] == '.') {
+    size_t start = ++(*pos);
+    int32_t ns = 0;
+    for (; *pos < len && _is_digit(text[*pos]); (*pos)++) {
+      if (*pos - start < 9)
+        ns = ns * 10 + (text[*pos] - '0');
+    }
+    size_t n = *pos - start;
+    if (n == 0)
+      return false;
+    for (; n < 9; n++)
+      ns *= 10;
+    dt->nanosecond = ns;
+  }
+  return true;
+}
+
+static YATL_Result_t _parse_datetime(const char *text, size_t len,
+                                     YATL_DateTime_t *out_value) {
+  YATL_DateTime_t dt = {0};
+  size_t pos = 0;
+
+  // A time starts with HH:, a date with YYYY-
+  if (len > 2 && text[2] == ':') {
+    if (!_parse_time(text, len, &pos, &dt) || pos != len)
+      return YATL_ERR_TYPE;
+    dt.kind = YATL_DT_LOCAL_TIME;
+    *out_value = dt;
+    return YATL_OK;
+  }
+
+  if (!_parse_date(text, len, &pos, &dt))
+    return YATL_ERR_TYPE;
+  if (pos == len) {
+    dt.kind = YATL_DT_LOCAL_DATE;
+    *out_value = dt;
+    return YATL_OK;
+  }
+  if (text[pos] != 'T' && text[pos] != 't' && text[pos] != ' ')
+    return YATL_ERR_TYPE;
+  pos++;
+  if (!_parse_time(text, len, &pos, &dt))
+    return YATL_ERR_TYPE;
+  if (pos == len) {
+    dt.kind = YATL_DT_LOCAL_DATETIME;
+    *out_value = dt;
+    return YATL_OK;
+  }
+
+  if (text[pos] == 'Z' || text[pos] == 'z') {
+    pos++;
+  } else if (text[pos] == '+' || text[pos] == '-') {
+    int sign = text[pos++] == '-' ? -1 : 1;
+    int hours, minutes;
+    if (!_fixed_digits(text, len, &pos, 2, &hours) ||
+        !_expect(text, len, &pos, ':') ||
+        !_fixed_digits(text, len, &pos, 2, &minutes) || hours > 23 ||
+        minutes > 59)
+      return YATL_ERR_TYPE;
+    dt.offset_minutes = sign * (hours * 60 + minutes);
+  } else {
+    return YATL_ERR_TYPE;
+  }
+  if (pos != len)
+    return YATL_ERR_TYPE;
+  dt.kind = YATL_DT_OFFSET_DATETIME;
+  *out_value = dt;
+  return YATL_OK;
+}
+
+// Content bounds of a string value. Single-line strings use the semantic
+// bounds; multi-line strings run from after the opening delimiter (and the
+// newline directly after it) to before the closing one.
+typedef struct {
+  bool basic;
+  const _YATL_Line_t *first, *last;
+  size_t start, end; // start on first line, end on last line
+} _StrContent_t;
+
+static YATL_Result_t _span_string(const YATL_Span_t *span,
+                                  _StrContent_t *out_content) {
+  if (!span)
+    return YATL_ERR_INVALID_ARG;
+  const _YATL_Span_t *_span = (const _YATL_Span_t *)span;
+  YATL_Result_t res = _YATL_check_span(_span);
+  if (res != YATL_OK)
+    return res;
+
+  YATL_Span_t key, val;
+  if (_span->type == YATL_S_LEAF_KEYVAL) {
+    res = YATL_span_keyval_slice(span, &key, &val);
+    if (res != YATL_OK)
+      return res;
+    _span = (const _YATL_Span_t *)&val;
+  }
+  if (_span->type != YATL_S_SLICE_VALUE || !_span->c_start.line)
+    return YATL_ERR_TYPE;
+  char quote = _span->c_start.line->text[_span->c_start.pos];
+  if (!_is_class(quote, _CC_QUOTE))
+    return YATL_ERR_TYPE;
+
+  _StrContent_t content = {.basic = quote == '"'};
+  if (_span->s_c_start.line) {
+    content.first = _span->s_c_start.line;
+    content.start = _span->s_c_start.pos;
+    content.last = _span->s_c_end.line;
+    content.end = _span->s_c_end.pos;
+  } else {
+    content.first = _span->c_start.line;
+    content.start = _span->c_start.pos + 3;
+    content.last = _span->c_end.line;
+    content.end = _span->c_end.pos - 3;
+    if (content.start == content.first->len && content.first != content.last) {
+      content.first = content.first->next;
+      content.start = 0;
+    }
+  }
+  *out_content = content;
+  return YATL_OK;
+}
+
+// Output that counts every byte but only stores what fits
+typedef struct {
+  char *buf;
+  size_t cap;
+  size_t len;
+} _StrOut_t;
+
+static void _out_append(_StrOut_t *out, const char *text, size_t len) {
+  if (out->len < out->cap) {
+    size_t room = out->cap - out->len;
+    memcpy(out->buf + out->len, text, len < room ? len : room);
+  }
+  out->len += len;
+}
+
+static YATL_Result_t _out_utf8(_StrOut_t *out, uint32_t cp) {
+  char bytes[4];
+  size_t n;
+  if (cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF))
+    return YATL_ERR_SYNTAX; // not a Unicode scalar value
+  if (cp < 0x80) {
+    bytes[0] = (char)cp;
+    n = 1;
+  } else if (cp < 0x800) {
+    bytes[0] = (char)(0xC0 | (cp >> 6));
+    bytes[1] = (char)(0x80 | (cp & 0x3F));
+    n = 2;
+  } else if (cp < 0x10000) {
+    bytes[0] = (char)(0xE0 | (cp >> 12));
+    bytes[1] = (char)(0x80 | ((cp >> 6) & 0x3F));
+    bytes[2] = (char)(0x80 | (cp & 0x3F));
+    n = 3;
+  } else {
+    bytes[0] = (char)(0xF0 | (cp >> 18));
+    bytes[1] = (char)(0x80 | ((cp >> 12) & 0x3F));
+    bytes[2] = (char)(0x80 | ((cp >> 6) & 0x3F));
+    bytes[3] = (char)(0x80 | (cp & 0x3F));
+    n = 4;
+  }
+  _out_append(out, bytes, n);
+  return YATL_OK;
+}
+
+// Decodes the escape sequence at text[*pos] == '\\'
+static YATL_Result_t _decode_escape(const char *text, size_t len, size_t *pos,
+                                    _StrOut_t *out) {
+  size_t p = *pos + 1;
+  if (p >= len)
+    return YATL_ERR_SYNTAX;
+  char c = text[p++];
+  char decoded;
+  switch (c) {
+  case 'b':
+    decoded = '\b';
+    break;
+  case 't':
+    decoded = '\t';
+    break;
+  case 'n':
+    decoded = '\n';
+    break;
+  case 'f':
+    decoded = '\f';
+    break;
+  case 'r':
+    decoded = '\r';
+    break;
+  case 'e':
+    decoded = '\x1B';
+    break;
+  case '"':
+  case '\\':
+    decoded = c;
+    break;
+  case 'u':
+  case 'U': {
+    size_t ndigits = c == 'u' ? 4 : 8;
+    if (p + ndigits > len)
+      return YATL_ERR_SYNTAX;
+    uint32_t cp = 0;
+    for (size_t i = 0; i < ndigits; i++) {
+      int d = _digit_value(text[p + i]);
+      if (d > 15)
+        return YATL_ERR_SYNTAX;
+      cp = (cp << 4) | (uint32_t)d;
+    }
+    *pos = p + ndigits;
+    return _out_utf8(out, cp);
+  }
+  default:
+    return YATL_ERR_SYNTAX;
+  }
+  _out_append(out, &decoded, 1);
+  *pos = p;
+  return YATL_OK;
+}
+
+// Decodes text[0..len) of one line of a basic string. In multi-line
+// strings a backslash followed only by whitespace sets *out_trim instead.
+static YATL_Result_t _decode_basic(const char *text, size_t len, bool ml,
+                                   _StrOut_t *out, bool *out_trim) {
+  size_t p = 0;
+  while (p < len) {
+    const char *bs = memchr(text + p, '\\', len - p);
+    size_t run = bs ? (size_t)(bs - (text + p)) : len - p;
+    _out_append(out, text + p, run);
+    p += run;
+    if (!bs)
+      break;
+    if (ml) {
+      size_t q = p + 1;
+      while (q < len && _is_ws(text[q]))
+        q++;
+      if (q == len) {
+        *out_trim = true;
+        return YATL_OK;
+      }
+    }
+    YATL_Result_t res = _decode_escape(text, len, &p, out);
+    if (res != YATL_OK)
+      return res;
+  }
+  return YATL_OK;
+}
+
+// ---------------------------------------------------------------------
+// Bulk array decoding
+//
+// Numeric arrays are decoded by scanning the raw line text from '[' to
+// ']' once, without building a span per element. Plain decimal integers
+// take a SWAR path that converts eight ASCII digits with three multiplies.
+// ---------------------------------------------------------------------
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define _YATL_SWAR_DIGITS 1
+#endif
+
+#ifdef _YATL_SWAR_DIGITS
+// True if all eight bytes of chunk are ASCII digits
+static inline bool _swar_all_digits(uint64_t chunk) {
+  const uint64_t high = UINT64_C(0xF0F0F0F0F0F0F0F0);
+  const uint64_t zeros = UINT64_C(0x3030303030303030);
+  return (chunk & high) == zeros &&
+         ((chunk + UINT64_C(0x0606060606060606)) & high) == zeros;
+}
+
+// Value of eight ASCII digits, first digit in the lowest byte
+static inline uint64_t _swar_parse8(uint64_t chunk) {
+  chunk = (chunk & UINT64_C(0x0F0F0F0F0F0F0F0F)) * 2561 >> 8;
+  chunk = (chunk & UINT64_C(0x00FF00FF00FF00FF)) * 6553601 >> 16;
+  return (chunk & UINT64_C(0x0000FFFF0000FFFF)) * UINT64_C(42949672960001) >>
+         32;
+}
+#endif
+
+// Integer parse with a fast path for signed decimal literals of at most 18
+// digits, which cannot overflow; everything else goes to _parse_int64.
+static YATL_Result_t _parse_int64_fast(const char *text, size_t len,
+                                       int64_t *out_value) {
+  size_t p = (text[0] == '+' || text[0] == '-') ? 1 : 0;
+  size_t ndigits = len - p;
+  if (ndigits == 0 || ndigits > 18 || (ndigits > 1 && text[p] == '0'))
+    return _parse_int64(text, len, out_value);
+
+  uint64_t value = 0;
+#ifdef _YATL_SWAR_DIGITS
+  while (len - p >= 8) {
+    uint64_t chunk;
+    memcpy(&chunk, text + p, sizeof(chunk));
+    if (!_swar_all_digits(chunk))
+      return _parse_int64(text, len, out_value);
+    value = value * 100000000 + _swar_parse8(chunk);
+    p += 8;
+  }
+#endif
+  for (; p < len; p++) {
+    if (!_is_digit(text[p]))
+      return _parse_int64(text, len, out_value);
+    value = value * 10 + (uint64_t)(text[p] - '0');
+  }
+  *out_value = text[0] == '-' ? -(int64_t)value : (int64_t)value;
+  return YATL_OK;
+}
+
+static YATL_Result_t _elem_int64(const char *text, size_t len, void *out,
+                                 size_t i) {
+  int64_t value;
+  YATL_Result_t res = _parse_int64_fast(text, len, &value);
+  if (res == YATL_OK && out)
+    ((int64_t *)out)[i] = value;
+  return res;
+}
+
+static YATL_Result_t _elem_double(const char *text, size_t len, void *out,
+                                  size_t i) {
+  double value;
+  YATL_Result_t res;
+  if (text[0] != '0' || len < 3 ||
+      (text[1] != 'x' && text[1] != 'o' && text[1] != 'b')) {
+    res = _parse_double(text, len, &value);
+  } else {
+    int64_t ivalue;
+    res = _parse_int64(text, len, &ivalue);
+    value = (double)ivalue;
+  }
+  if (res == YATL_OK && out)
+    ((double *)out)[i] = value;
+  return res;
+}
+
+typedef YATL_Result_t (*_ElemParse_t)(const char *text, size_t len, void *out,
+                                      size_t i);
+
+// Decodes every element of an array span with parse. Elements past cap are
+// still validated and counted so *out_n reports the full length.
+static YATL_Result_t _array_decode(const YATL_Span_t *span, _ElemParse_t parse,
+                                   void *out, size_t cap, size_t *out_n) {
+  if (!span || !out_n || (cap > 0 && !out))
+    return YATL_ERR_INVALID_ARG;
+  const _YATL_Span_t *_span = (const _YATL_Span_t *)span;
+  YATL_Result_t res = _YATL_check_span(_span);
+  if (res != YATL_OK)
+    return res;
+
+  YATL_Span_t key, val;
+  if (_span->type == YATL_S_LEAF_KEYVAL) {
+    res = YATL_span_keyval_slice(span, &key, &val);
+    if (res != YATL_OK)
+      return res;
+    _span = (const _YATL_Span_t *)&val;
+  }
+  if (_span->type != YATL_S_NODE_ARRAY || !_span->c_start.line)
+    return YATL_ERR_TYPE;
+
+  const _YATL_Line_t *line = _span->c_start.line;
+  size_t pos = _span->c_start.pos + 1; // past '['
+  size_t n = 0;
+  bool want_value = true; // no element since the last comma
+  for (;;) {
+    if (pos >= line->len || line->text[pos] == '#') {
+      line = line->next;
+      pos = 0;
+      if (!line)
+        return YATL_ERR_SYNTAX; // unterminated
+      continue;
+    }
+    char c = line->text[pos];
+    if (_is_ws(c)) {
+      pos++;
+    } else if (c == ']') {
+      break;
+    } else if (c == ',') {
+      if (want_value)
+        return YATL_ERR_SYNTAX;
+      want_value = true;
+      pos++;
+    } else {
+      if (!want_value)
+        return YATL_ERR_SYNTAX;
+      if (_is_class(c, _CC_QUOTE) || c == '[' || c == '{')
+        return YATL_ERR_TYPE;
+      size_t start = pos;
+      while (pos < line->len && !_is_class(line->text[pos], _CC_VALUE_END))
+        pos++;
+      if (pos == start)
+        return YATL_ERR_SYNTAX;
+      res = parse(line->text + start, pos - start, n < cap ? out : NULL, n);
+      if (res != YATL_OK)
+        return res;
+      n++;
+      want_value = false;
+    }
+  }
+
+  *out_n = n;
+  return n > cap ? YATL_ERR_BUFFER : YATL_OK;
+}
+
+// ---------------------------------------------------------------------
+// Public API
+// ---------------------------------------------------------------------
+
+YATL_Result_t YATL_span_get_int64(const YATL_Span_t *span,
+                                  int64_t *out_value) {
+  if (!out_value)
+    return YATL_ERR_INVALID_ARG;
+  const char *text;
+  size_t len;
+  YATL_Result_t res = _span_bare_text(span, &text, &len);
+  if (res != YATL_OK)
+    return res;
+  return _parse_int64(text, len, out_value);
+}
+
+YATL_Result_t YATL_span_get_double(const YATL_Span_t *span,
+                                   double *out_value) {
+  if (!out_value)
+    return YATL_ERR_INVALID_ARG;
+  const char *text;
+  size_t len;
+  YATL_Result_t res = _span_bare_text(span, &text, &len);
+  if (res != YATL_OK)
+    return res;
+
+  // Hex, octal and binary integers are not floats, but are numbers
+  if (len > 2 && text[0] == '0' &&
+      (text[1] == 'x' || text[1] == 'o' || text[1] == 'b')) {
+    int64_t value;
+    res = _parse_int64(text, len, &value);
+    if (res == YATL_OK)
+      *out_value = (double)value;
+    return res;
+  }
+  return _parse_double(text, len, out_value);
+}
+
+YATL_Result_t YATL_span_get_bool(const YATL_Span_t *span, bool *out_value) {
+  if (!out_value)
+    return YATL_ERR_INVALID_ARG;
+  const char *text;
+  size_t len;
+  YATL_Result_t res = _span_bare_text(span, &text, &len);
+  if (res != YATL_OK)
+    return res;
+  if (len == 4 && memcmp(text, "true", 4) == 0) {
+    *out_value = true;
+    return YATL_OK;
+  }
+  if (len == 5 && memcmp(text, "false", 5) == 0) {
+    *out_value = false;
+    return YATL_OK;
+  }
+  return YATL_ERR_TYPE;
+}
+
+YATL_Result_t YATL_span_get_datetime(const YATL_Span_t *span,
+                                     YATL_DateTime_t *out_value) {
+  if (!out_value)
+    return YATL_ERR_INVALID_ARG;
+  const char *text;
+  size_t len;
+  YATL_Result_t res = _span_bare_text(span, &text, &len);
+  if (res != YATL_OK)
+    return res;
+  return _parse_datetime(text, len, out_value);
+}
+
+YATL_Result_t YATL_span_get_string_view(const YATL_Span_t *span,
+                                        const char **out_text,
+                                        size_t *out_len) {
+  if (!out_text || !out_len)
+    return YATL_ERR_INVALID_ARG;
+  _StrContent_t content;
+  YATL_Result_t res = _span_string(span, &content);
+  if (res != YATL_OK)
+    return res;
+  if (content.first != content.last)
+    return YATL_ERR_BUFFER;
+  const char *text = content.first->text + content.start;
+  size_t len = content.end - content.start;
+  if (content.basic && memchr(text, '\\', len))
+    return YATL_ERR_BUFFER;
+  *out_text = text;
+  *out_len = len;
+  return YATL_OK;
+}
+
+YATL_Result_t YATL_span_get_string_decoded(const YATL_Span_t *span, char *buf,
+                                           size_t cap, size_t *out_len) {
+  if (!out_len || (cap > 0 && !buf))
+    return YATL_ERR_INVALID_ARG;
+  _StrContent_t content;
+  YATL_Result_t res = _span_string(span, &content);
+  if (res != YATL_OK)
+    return res;
+
+  _StrOut_t out = {.buf = buf, .cap = cap};
+  bool ml = content.first != content.last;
+  bool trim = false; // inside a line-ending backslash's whitespace run
+  for (const _YATL_Line_t *line = content.first;; line = line->next) {
+    size_t start = (line == content.first) ? content.start : 0;
+    size_t end = (line == content.last) ? content.end : line->len;
+    if (line != content.first && !trim)
+      _out_append(&out, "\n", 1);
+    if (trim) {
+      while (start < end && _is_ws(line->text[start]))
+        start++;
+      trim = start == end;
+    }
+    if (!content.basic)
+      _out_append(&out, line->text + start, end - start);
+    else if (start < end) {
+      res = _decode_basic(line->text + start, end - start, ml, &out, &trim);
+      if (res != YATL_OK)
+        return res;
+    }
+    if (line == content.last)
+      break;
+  }
+
+  *out_len = out.len;
+  if (out.len >= cap)
+    return YATL_ERR_BUFFER;
+  buf[out.len] = '\0';
+  return YATL_OK;
+}
+
+YATL_Result_t YATL_span_array_get_int64s(const YATL_Span_t *array,
+                                         int64_t *out, size_t cap,
+                                         size_t *out_n) {
+  return _array_decode(array, _elem_int64, out, cap, out_n);
+}
+
+YATL_Result_t YATL_span_array_get_doubles(const YATL_Span_t *array,
+                                          double *out, size_t cap,
+                                          size_t *out_n) {
+  return _array_decode(array, _elem_double, out, cap, out_n);
+}
+
+// ---------------------------------------------------------------------
+// Typed setters
+//
+// Values are encoded into a stack buffer and spliced in with
+// _YATL_span_replace_value, which validates the result and leaves the
+// document untouched on failure.
+// ---------------------------------------------------------------------
+
+// Strings up to this encoded length are built on the stack
+#define _SET_STRING_STACK 256
+
+// Longest encoded double: sign, 17 digits, '.', "e-308" and a NUL
+#define _DOUBLE_BUF 32
+
+static size_t _encode_int64(int64_t value, char *buf) {
+  char digits[20];
+  size_t n = 0;
+  uint64_t u = value < 0 ? 0 - (uint64_t)value : (uint64_t)value;
+  do {
+    digits[n++] = (char)('0' + u % 10);
+    u /= 10;
+  } while (u);
+  size_t len = 0;
+  if (value < 0)
+    buf[len++] = '-';
+  while (n)
+    buf[len++] = digits[--n];
+  return len;
+}
+
+// "%.*g" form of value with '.' as the decimal separator whatever the locale
+static size_t _format_double(double value, int prec, char *buf) {
+  size_t len = (size_t)snprintf(buf, _DOUBLE_BUF, "%.*g", prec, value);
+  for (size_t i = 0; i < len; i++) {
+    if (buf[i] == ',')
+      buf[i] = '.'; // locale decimal separator
+  }
+  return len;
+}
+
+// "%.15g" form of value if it parses back exactly, "%.17g" otherwise, with a
+// '.' or exponent so TOML reads it as a float. 15 digits keep values written
+// by hand short; 17 always round-trip.
+static size_t _encode_double(double value, char *buf) {
+  if (isnan(value)) {
+    memcpy(buf, "nan", 3);
+    return 3;
+  }
+  if (isinf(value)) {
+    memcpy(buf, value < 0 ? "-inf" : "inf", value < 0 ? 4 : 3);
+    return value < 0 ? 4 : 3;
+  }
+
+  size_t len = _format_double(value, 15, buf);
+  double back;
+  if (_parse_double(buf, len, &back) != YATL_OK || back != value)
+    len = _format_double(value, 17, buf);
+  if (!memchr(buf, '.', len) && !memchr(buf, 'e', len) &&
+      !memchr(buf, 'i', len)) {
+    memcpy(buf + len, ".0", 2);
+    len += 2;
+  }
+  return len;
+}
+
+// Characters a basic string must escape
+static inline bool _needs_escape(unsigned char c) {
+  return c == '"' || c == '\\' || (c < 0x20 && c != '\t') || c == 0x7F;
+}
+
+// Encoded length of str as a TOML string, and the quoting style: literal
+// when that avoids escapes, basic otherwise
+size_t _string_encoded_len(const char *str, size_t len, bool *literal) {
+  size_t extra = 0;
+  bool escapes = false, controls = false, apostrophe = false;
+  for (size_t i = 0; i < len; i++) {
+    unsigned char c = (unsigned char)str[i];
+    apostrophe |= c == '\'';
+    if (!_needs_escape(c))
+      continue;
+    escapes = true;
+    // \" \\ \b \n \f \r take two bytes, other controls \u00XX six
+    bool short_form = c == '"' || c == '\\' || c == '\b' || c == '\n' ||
+                      c == '\f' || c == '\r';
+    controls |= c != '"' && c != '\\';
+    extra += short_form ? 1 : 5;
+  }
+  // Literal strings cannot hold ' or control characters other than tab
+  *literal = escapes && !apostrophe && !controls;
+  return len + 2 + (*literal ? 0 : extra);
+}
+
+void _encode_string(const char *str, size_t len, bool literal, char *out) {
+  char quote = literal ? '\'' : '"';
+  size_t n = 0;
+  out[n++] = quote;
+  if (literal) {
+    memcpy(out + n, str, len);
+    n += len;
+  } else {
+    for (size_t i = 0; i < len; i++) {
+      unsigned char c = (unsigned char)str[i];
+      if (!_needs_escape(c)) {
+        out[n++] = (char)c;
+        continue;
+      }
+      out[n++] = '\\';
+      switch (c) {
+      case '"':
+      case '\\':
+        out[n++] = (char)c;
+        break;
+      case '\b':
+        out[n++] = 'b';
+        break;
+      case '\n':
+        out[n++] = 'n';
+        break;
+      case '\f':
+        out[n++] = 'f';
+        break;
+      case '\r':
+        out[n++] = 'r';
+        break;
+      default:
+        memcpy(out + n, "u00", 3);
+        out[n + 3] = "0123456789ABCDEF"[c >> 4];
+        out[n + 4] = "0123456789ABCDEF"[c & 0xF];
+        n += 5;
+        break;
+      }
+    }
+  }
+  out[n] = quote;
+}
+
+YATL_Result_t YATL_span_set_int64(YATL_Span_t *span, int64_t value) {
+  char buf[24];
+  size_t len = _encode_int64(value, buf);
+  return _YATL_span_replace_value(span, buf, len);
+}
+
+YATL_Result_t YATL_span_set_double(YATL_Span_t *span, double value) {
+  char buf[_DOUBLE_BUF];
+  size_t len = _encode_double(value, buf);
+  return _YATL_span_replace_value(span, buf, len);
+}
+
+YATL_Result_t YATL_span_set_bool(YATL_Span_t *span, bool value) {
+  return value ? _YATL_span_replace_value(span, "true", 4)
+               : _YATL_span_replace_value(span, "false", 5);
+}
+
+YATL_Result_t YATL_span_set_string(YATL_Span_t *span, const char *str,
+                                   size_t len) {
+  if (!str)
+    return YATL_ERR_INVALID_ARG;
+  bool literal;
+  size_t enc_len = _string_encoded_len(str, len, &literal);
+  char stack[_SET_STRING_STACK];
+  char *buf = stack;
+  if (enc_len > sizeof(stack)) {
+    buf = malloc(enc_len);
+    if (!buf)
+      return YATL_ERR_NOMEM;
+  }
+  _encode_string(str, len, literal, buf);
+  YATL_Result_t res = _YATL_span_replace_value(span, buf, enc_len);
+  if (buf != stack)
+    free(buf);
+  return res;
+}
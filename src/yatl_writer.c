@@ -1,8 +1,22 @@
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE // O_TMPFILE
+#endif
+
 #include "yatl_lexer.h"
 #include "yatl_private.h"
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
+#ifdef _YATL_HAVE_WRITEV
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
 // ---------------------------------------------------------------------
 // Span unlink/relink implementation
 // ---------------------------------------------------------------------
@@ -70,62 +84,27 @@ YATL_Result_t _YATL_span_unlink(YATL_Span_t *span,
     }
   }
 
-  // Save insertion points before unlinking
-  _YATL_Line_t *insert_before = last->next;
-  _YATL_Line_t *insert_after = first->prev;
-
-  // Initialize output cursors
-  _out_reinsert->line = insert_before;
-  _out_reinsert->pos = 0;
-  _out_prefix->line = NULL;
-  _out_prefix->pos = 0;
-  _out_suffix->line = NULL;
-  _out_suffix->pos = 0;
-
-  // Unlink each line (save next before _line_unlink nulls it)
-  // Lines go to boneyard with full original content (no trimming)
-  _YATL_Line_t *line = first;
-  while (line) {
-    _YATL_Line_t *next_in_chain = line->next;
-    _line_unlink(line);
-    if (line == last)
-      break;
-    line = next_in_chain;
+  // Chain the replacement lines and swap them in for first..last; the old
+  // lines go to the boneyard with full original content (no trimming)
+  if (prefix_line && suffix_line) {
+    prefix_line->next = suffix_line;
+    suffix_line->prev = prefix_line;
   }
-
-  // Link prefix line into document
-  if (prefix_line) {
-    prefix_line->doc = doc;
-    prefix_line->prev = insert_after;
-    prefix_line->next = insert_before;
-    if (insert_after)
-      insert_after->next = prefix_line;
-    else
-      doc->head = prefix_line;
-    if (insert_before)
-      insert_before->prev = prefix_line;
-    else
-      doc->tail = prefix_line;
-    insert_after = prefix_line;
-    _out_prefix->line = prefix_line;
-  }
-
-  // Link suffix line into document
-  if (suffix_line) {
-    suffix_line->doc = doc;
-    suffix_line->prev = insert_after;
-    suffix_line->next = insert_before;
-    if (insert_after)
-      insert_after->next = suffix_line;
-    else
-      doc->head = suffix_line;
-    if (insert_before)
-      insert_before->prev = suffix_line;
-    else
-      doc->tail = suffix_line;
-    _out_suffix->line = suffix_line;
+  _out_reinsert->line = last->next;
+  _out_reinsert->pos = 0;
+  YATL_Result_t res =
+      _doc_splice(doc, first, last, prefix_line ? prefix_line : suffix_line,
+                  suffix_line ? suffix_line : prefix_line, NULL);
+  if (res != YATL_OK) {
+    _line_free(prefix_line);
+    _line_free(suffix_line);
+    return res;
   }
 
+  _out_prefix->line = prefix_line;
+  _out_prefix->pos = 0;
+  _out_suffix->line = suffix_line;
+  _out_suffix->pos = 0;
   return YATL_OK;
 }
 
@@ -159,14 +138,17 @@ YATL_Result_t _YATL_span_relink(YATL_Doc_t *doc, YATL_Span_t *span,
   // Relink each span line from boneyard into document
   _YATL_Line_t *insert_before = _reinsert->line;
   _YATL_Line_t *line = first;
+  size_t relinked = 0;
   while (line) {
     _YATL_Line_t *next_in_chain = line->next;
     _line_relink(_doc, line, insert_before);
+    relinked++;
     if (line == last)
       break;
     line = next_in_chain;
   }
 
+  _line_index_repair(last, relinked);
   return YATL_OK;
 }
 YATL_Result_t YATL_span_set_value(YATL_Span_t *span, const char *value,
@@ -174,9 +156,8 @@ YATL_Result_t YATL_span_set_value(YATL_Span_t *span, const char *value,
   if (!span || !value)
     return YATL_ERR_INVALID_ARG;
 
-  size_t value_len = strlen(value);
   const char *lines[] = {value};
-  return YATL_span_ml_set_value(span, lines, &value_len, 1);
+  return YATL_span_ml_set_value(span, lines, &length, 1);
 }
 
 YATL_Result_t YATL_span_ml_set_value(YATL_Span_t *span, const char **lines,
@@ -203,6 +184,14 @@ YATL_Result_t YATL_span_ml_set_value(YATL_Span_t *span, const char **lines,
   if (!doc)
     return YATL_ERR_INVALID_ARG;
 
+  // Closing delimiter length: how far the value lexically extends past the
+  // replaced content (a closing quote, or nothing for bare values)
+  size_t delim_len = 0;
+  _YATL_Cursor_t value_end = _span->c_start;
+  if (_consume(&value_end, _TOML_VALUE) == YATL_OK &&
+      value_end.line == last_old_line && value_end.pos >= sem_end.pos)
+    delim_len = value_end.pos - sem_end.pos;
+
   // Calculate prefix (content before semantic start on first line)
   size_t prefix_len = sem_start.pos;
   // Calculate suffix (content after semantic end on last line, includes closing
@@ -272,13 +261,12 @@ YATL_Result_t YATL_span_ml_set_value(YATL_Span_t *span, const char **lines,
 
   res = _consume(&test_cursor, _TOML_VALUE);
 
-  // Calculate expected lexical end position after parsing:
-  // For single line: prefix + content + suffix
-  // For multi-line: last line at content + suffix
+  // The new value must end right after the content plus the original
+  // closing delimiter; anything following (comments, commas) is suffix
+  size_t content_end =
+      (line_count == 1) ? prefix_len + lengths[0] : lengths[line_count - 1];
   _YATL_Line_t *expected_end_line = new_lines[line_count - 1];
-  size_t expected_end_pos = (line_count == 1)
-                                ? prefix_len + lengths[0] + suffix_len
-                                : lengths[line_count - 1] + suffix_len;
+  size_t expected_end_pos = content_end + delim_len;
 
   if (res != YATL_OK || test_cursor.line != expected_end_line ||
       test_cursor.pos != expected_end_pos) {
@@ -288,55 +276,30 @@ YATL_Result_t YATL_span_ml_set_value(YATL_Span_t *span, const char **lines,
     goto cleanup_error;
   }
 
-  // Save insertion points before modifying document
-  _YATL_Line_t *insert_after = first_old_line->prev;
-  _YATL_Line_t *insert_before = last_old_line->next;
-
-  // Unlink old lines (move to boneyard)
-  _YATL_Line_t *old_line = first_old_line;
-  while (old_line) {
-    _YATL_Line_t *next_old = old_line->next;
-    _line_unlink(old_line);
-    if (old_line == last_old_line)
-      break;
-    old_line = next_old;
-  }
-
-  // Link new lines into document
-  for (size_t i = 0; i < line_count; i++) {
-    new_lines[i]->doc = doc;
-    new_lines[i]->prev = insert_after;
-    new_lines[i]->next = insert_before;
-
-    if (insert_after)
-      insert_after->next = new_lines[i];
-    else
-      doc->head = new_lines[i];
-
-    if (insert_before)
-      insert_before->prev = new_lines[i];
-    else
-      doc->tail = new_lines[i];
-
-    insert_after = new_lines[i];
+  // Swap the new lines in; the old ones go to the boneyard
+  res = _doc_splice(doc, first_old_line, last_old_line, new_lines[0],
+                    new_lines[line_count - 1], NULL);
+  if (res != YATL_OK) {
+    error_result = res;
+    goto cleanup_error;
   }
 
-  // Update span cursors to point to new lines
+  // Update span cursors to point to new lines. The lexical end keeps its
+  // distance from the content end when it was on the replaced last line.
+  _span->kv.cached = false; // boundaries moved
   _span->c_start.line = new_lines[0];
+  if (_span->c_end.line == last_old_line && _span->c_end.pos >= sem_end.pos)
+    _span->c_end.pos = content_end + (_span->c_end.pos - sem_end.pos);
+  else
+    _span->c_end.pos = content_end + suffix_len;
   _span->c_end.line = new_lines[line_count - 1];
 
-  // Calculate new lexical end position
-  size_t last_line_content_len =
-      (line_count == 1) ? prefix_len + lengths[0] : lengths[line_count - 1];
-  _span->c_end.pos = last_line_content_len + suffix_len;
-
   // Update semantic cursors
   if (_span->s_c_start.line) {
     _span->s_c_start.line = new_lines[0];
     _span->s_c_start.pos = prefix_len;
     _span->s_c_end.line = new_lines[line_count - 1];
-    _span->s_c_end.pos =
-        (line_count == 1) ? prefix_len + lengths[0] : lengths[line_count - 1];
+    _span->s_c_end.pos = content_end;
   }
 
   return YATL_OK;
@@ -350,36 +313,979 @@ cleanup_error:
   return error_result;
 }
 
+YATL_Result_t _YATL_span_replace_value(YATL_Span_t *span, const char *text,
+                                       size_t len) {
+  if (!span || !text)
+    return YATL_ERR_INVALID_ARG;
+  _YATL_Span_t *_span = (_YATL_Span_t *)span;
+  YATL_Result_t res = _YATL_check_span(_span);
+  if (res != YATL_OK)
+    return res;
+
+  YATL_Span_t key, val;
+  _YATL_Span_t *_val = _span;
+  if (_span->type == YATL_S_LEAF_KEYVAL) {
+    res = YATL_span_keyval_slice(span, &key, &val);
+    if (res != YATL_OK)
+      return res;
+    _val = (_YATL_Span_t *)&val;
+  }
+  if ((_val->type != YATL_S_SLICE_VALUE && _val->type != YATL_S_NODE_ARRAY &&
+       _val->type != YATL_S_NODE_INLINE_TABLE) ||
+      !_val->c_start.line)
+    return YATL_ERR_TYPE;
+
+  // Replace the whole lexical value, delimiters included
+  _YATL_Cursor_t value_end = _val->c_start;
+  res = _consume(&value_end, _TOML_VALUE);
+  if (res != YATL_OK)
+    return res;
+  _YATL_Span_t tmp = *_val;
+  tmp.s_c_start = tmp.c_start;
+  tmp.s_c_end = value_end;
+  res = YATL_span_ml_set_value((YATL_Span_t *)&tmp, &text, &len, 1);
+  if (res != YATL_OK)
+    return res;
+
+  // Re-derive bounds for the new value: single-line strings get semantic
+  // bounds inside their quotes, bare values have semantic == lexical
+  _YATL_Line_t *line = tmp.c_start.line;
+  size_t start = tmp.c_start.pos;
+  if (_span->type == YATL_S_LEAF_KEYVAL) {
+    _span->kv.cached = false;
+    _span->c_start.line = line;
+    if (_span->c_end.line == value_end.line) {
+      _span->c_end.pos = start + len + (_span->c_end.pos - value_end.pos);
+      _span->c_end.line = line;
+    }
+    return YATL_OK;
+  }
+  _span->type = YATL_S_SLICE_VALUE;
+  _span->c_start.line = line;
+  _span->c_end = tmp.c_end;
+  _span->s_c_start = tmp.s_c_start;
+  _span->s_c_end = tmp.s_c_end;
+  if (len >= 2 && _is_class(text[0], _CC_QUOTE)) {
+    _span->s_c_start.pos++;
+    _span->s_c_end.pos--;
+  }
+  return YATL_OK;
+}
+
+// ---------------------------------------------------------------------
+// Structural inserts
+//
+// New lines are built next to a reference line, copying its indentation,
+// and spliced in with _doc_splice; existing lines are never rewritten
+// except the one line that gains an array element or separator.
+// ---------------------------------------------------------------------
+
+// True if name is a (possibly dotted) key that can sit between [ and ]:
+// every segment bare or quoted, nothing left over. Brackets, '#' and line
+// breaks are refused even inside quotes, as header lookups do not expect
+// them.
+static bool _table_name_valid(const char *name, size_t len) {
+  if (strpbrk(name, "[]#\r\n"))
+    return false;
+  size_t pos = 0;
+  bool more;
+  do {
+    _TOMLKeySeg_t seg;
+    if (_key_segment(name, len, &pos, &seg, &more) != YATL_OK)
+      return false;
+  } while (more);
+  return pos == len;
+}
+
+// True if text is exactly one single-line TOML value (checked lexically,
+// as YATL_span_set_value does)
+static bool _value_text_valid(const char *text, size_t len) {
+  if (len == 0 || _is_ws(text[0]) || memchr(text, '\n', len) ||
+      memchr(text, '\r', len))
+    return false;
+  _YATL_Line_t tmp = {.magic = YATL_LINE_MAGIC, .text = (char *)text,
+                      .len = len};
+  _YATL_Cursor_t cr = {.magic = YATL_CURSOR_MAGIC, .line = &tmp};
+  return _consume(&cr, _TOML_VALUE) == YATL_OK && cr.line == &tmp &&
+         cr.pos == len;
+}
+
+static size_t _indent_len(const _YATL_Line_t *line) {
+  size_t n = 0;
+  while (line && n < line->len && _is_ws(line->text[n]))
+    n++;
+  return n;
+}
+
+// Line ending the value of a key-value or array element span
+static _YATL_Line_t *_value_end_line(const YATL_Span_t *span) {
+  YATL_Span_t key, val;
+  const _YATL_Span_t *_val = (const _YATL_Span_t *)span;
+  if (_val->type == YATL_S_LEAF_KEYVAL) {
+    if (YATL_span_keyval_slice(span, &key, &val) != YATL_OK)
+      return _val->c_start.line;
+    _val = (const _YATL_Span_t *)&val;
+  }
+  _YATL_Cursor_t end = _val->c_start;
+  if (_consume(&end, _TOML_VALUE) != YATL_OK)
+    return _val->c_start.line;
+  return end.line;
+}
+
+// Points the cursors of span that are on old_line at new_line, moving
+// those at or after pos by shift
+static void _span_move_line(_YATL_Span_t *span, const _YATL_Line_t *old_line,
+                            _YATL_Line_t *new_line, size_t pos, size_t shift) {
+  _YATL_Cursor_t *cursors[] = {&span->c_start, &span->c_end, &span->s_c_start,
+                               &span->s_c_end};
+  for (size_t i = 0; i < 4; i++) {
+    if (cursors[i]->line != old_line)
+      continue;
+    cursors[i]->line = new_line;
+    if (cursors[i]->pos >= pos)
+      cursors[i]->pos += shift;
+  }
+  span->kv.cached = false;
+}
+
+YATL_Result_t YATL_span_insert_keyval(YATL_Span_t *table, const char *key,
+                                      const char *value, YATL_Span_t *out_kv) {
+  if (!table || !key || !value)
+    return YATL_ERR_INVALID_ARG;
+  _YATL_Span_t *_table = (_YATL_Span_t *)table;
+  YATL_Result_t res = _YATL_check_span(_table);
+  if (res != YATL_OK)
+    return res;
+  if (_table->type != YATL_S_NONE && _table->type != YATL_S_NODE_TABLE &&
+      _table->type != YATL_S_NODE_ARRAY_TABLE)
+    return YATL_ERR_TYPE;
+  size_t key_len = strlen(key), value_len = strlen(value);
+  if (key_len == 0 || !_value_text_valid(value, value_len))
+    return YATL_ERR_SYNTAX;
+
+  YATL_Span_t item;
+  if (YATL_span_find_name(table, key, &item) == YATL_OK)
+    return YATL_ERR_SYNTAX; // duplicate key
+
+  // Insert after the last key-value, else after the header; at document
+  // level with no key-values, in front of the first table. A document
+  // without lines has nothing to scan and gets the key as its first line.
+  _YATL_Line_t *after = _table->type == YATL_S_NONE ? NULL
+                                                    : _table->c_start.line;
+  _YATL_Line_t *first_table = NULL;
+  _YATL_Line_t *ref = after; // indentation source
+  YATL_Cursor_t cursor = YATL_cursor_create();
+  while (_table->c_start.line &&
+         (res = YATL_span_find_next(table, &cursor, &item)) == YATL_OK) {
+    YATL_SpanType_t type = YATL_span_type(&item);
+    if (type == YATL_S_NODE_TABLE || type == YATL_S_NODE_ARRAY_TABLE) {
+      first_table = ((_YATL_Span_t *)&item)->c_start.line;
+      break;
+    }
+    if (type == YATL_S_LEAF_KEYVAL) {
+      ref = ((_YATL_Span_t *)&item)->c_start.line;
+      after = _value_end_line(&item);
+    }
+  }
+  if (res != YATL_OK && res != YATL_DONE && res != YATL_ERR_NOT_FOUND)
+    return res;
+
+  _YATL_Doc_t *doc =
+      _table->c_start.line ? _table->c_start.line->doc : _table->doc;
+  if (!doc)
+    return YATL_ERR_INVALID_ARG;
+  _YATL_Line_t *before = after ? after->next : first_table;
+
+  // Bare keys as given, anything else quoted
+  bool bare = true;
+  for (size_t i = 0; i < key_len; i++)
+    bare &= _is_bare_key_char(key[i]);
+  bool literal = false;
+  size_t enc_len = bare ? key_len : _string_encoded_len(key, key_len, &literal);
+  size_t indent = _indent_len(ref);
+
+  _YATL_Line_t *line = _line_alloc(NULL, indent + enc_len + 3 + value_len);
+  if (!line)
+    return YATL_ERR_NOMEM;
+  char *p = line->text;
+  memcpy(p, ref ? ref->text : "", indent);
+  p += indent;
+  if (bare)
+    memcpy(p, key, key_len);
+  else
+    _encode_string(key, key_len, literal, p);
+  p += enc_len;
+  memcpy(p, " = ", 3);
+  memcpy(p + 3, value, value_len);
+
+  res = _doc_splice(doc, NULL, NULL, line, line, before);
+  if (res != YATL_OK) {
+    _line_free(line);
+    return res;
+  }
+
+  // A span ending at the end of the preceding line now ends at the end of
+  // the new one; a document span starting at its old head starts here, and
+  // one of an empty document also ends here
+  _YATL_Line_t *prev = line->prev;
+  if ((prev && _table->c_end.line == prev &&
+       _table->c_end.pos == prev->len) ||
+      !_table->c_end.line) {
+    _table->c_end.line = line;
+    _table->c_end.pos = line->len;
+  }
+  if (_table->type == YATL_S_NONE && !prev)
+    _table->c_start.line = line;
+  if (out_kv)
+    return YATL_span_find_name(table, key, out_kv);
+  return YATL_OK;
+}
+
+YATL_Result_t YATL_doc_append_table(YATL_Doc_t *doc, const char *name,
+                                    YATL_Span_t *out_table) {
+  if (!doc || !name)
+    return YATL_ERR_INVALID_ARG;
+  _YATL_Doc_t *_doc = (_YATL_Doc_t *)doc;
+  YATL_Result_t res = _YATL_check_doc(_doc);
+  if (res != YATL_OK)
+    return res;
+  size_t name_len = strlen(name);
+  if (!_table_name_valid(name, name_len))
+    return YATL_ERR_SYNTAX;
+
+  YATL_Span_t doc_span, item;
+  YATL_doc_span(doc, &doc_span);
+  if (_doc->head && YATL_span_find_name(&doc_span, name, &item) == YATL_OK)
+    return YATL_ERR_SYNTAX; // already defined
+
+  // Separate from preceding content by a blank line
+  _YATL_Line_t *blank = NULL;
+  if (_doc->tail && _indent_len(_doc->tail) < _doc->tail->len) {
+    blank = _line_alloc(NULL, 0);
+    if (!blank)
+      return YATL_ERR_NOMEM;
+  }
+  _YATL_Line_t *header = _line_alloc(NULL, name_len + 2);
+  if (!header) {
+    _line_free(blank);
+    return YATL_ERR_NOMEM;
+  }
+  header->text[0] = '[';
+  memcpy(header->text + 1, name, name_len);
+  header->text[name_len + 1] = ']';
+  if (blank) {
+    blank->next = header;
+    header->prev = blank;
+  }
+
+  res = _doc_splice(_doc, NULL, NULL, blank ? blank : header, header, NULL);
+  if (res != YATL_OK) {
+    _line_free(blank);
+    _line_free(header);
+    return res;
+  }
+  if (out_table) {
+    YATL_doc_span(doc, &doc_span);
+    YATL_Cursor_t at = YATL_cursor_create();
+    ((_YATL_Cursor_t *)&at)->line = header;
+    res = YATL_span_find_next(&doc_span, &at, out_table);
+  }
+  return res;
+}
+
+YATL_Result_t YATL_span_array_append(YATL_Span_t *array, const char *value) {
+  if (!array || !value)
+    return YATL_ERR_INVALID_ARG;
+  _YATL_Span_t *_array = (_YATL_Span_t *)array;
+  YATL_Result_t res = _YATL_check_span(_array);
+  if (res != YATL_OK)
+    return res;
+  size_t value_len = strlen(value);
+  if (!_value_text_valid(value, value_len))
+    return YATL_ERR_SYNTAX;
+
+  YATL_Span_t key, val;
+  YATL_Span_t *arr = array;
+  if (_array->type == YATL_S_LEAF_KEYVAL) {
+    res = YATL_span_keyval_slice(array, &key, &val);
+    if (res != YATL_OK)
+      return res;
+    arr = &val;
+  }
+  const _YATL_Span_t *_arr = (const _YATL_Span_t *)arr;
+  if (_arr->type != YATL_S_NODE_ARRAY || !_arr->c_start.line)
+    return YATL_ERR_TYPE;
+  _YATL_Doc_t *doc = _arr->c_start.line->doc;
+
+  // Closing bracket and the end of the last element's value
+  _YATL_Cursor_t close = _arr->c_start;
+  res = _consume(&close, _TOML_VALUE);
+  if (res != YATL_OK)
+    return res;
+  close.pos--;
+  YATL_Cursor_t cursor = YATL_cursor_create();
+  YATL_Span_t elem;
+  _YATL_Cursor_t last_end = {.line = NULL};
+  while ((res = YATL_span_find_next(arr, &cursor, &elem)) == YATL_OK) {
+    last_end = ((_YATL_Span_t *)&elem)->c_start;
+    res = _consume(&last_end, _TOML_VALUE);
+    if (res != YATL_OK)
+      return res;
+  }
+  if (res != YATL_DONE)
+    return res;
+
+  // Inline: "[a]" -> "[a, v]", "[]" -> "[v]". Multi-line: a new line
+  // under the last element, adding its separator if it had none.
+  _YATL_Line_t *line;
+  size_t at, sep_len = 0;
+  _YATL_Line_t *added = NULL;
+  if (!last_end.line || last_end.line == close.line) {
+    line = last_end.line ? last_end.line : close.line;
+    at = last_end.line ? last_end.pos : close.pos;
+    sep_len = last_end.line ? 2 : 0;
+  } else {
+    line = last_end.line;
+    at = last_end.pos;
+    size_t p = at;
+    while (p < line->len && _is_ws(line->text[p]))
+      p++;
+    bool has_comma = p < line->len && line->text[p] == ',';
+    size_t indent = _indent_len(line);
+    size_t extra = (line == _arr->c_start.line) ? 4 : 0;
+    added = _line_alloc(NULL, indent + extra + value_len + has_comma);
+    if (!added)
+      return YATL_ERR_NOMEM;
+    memcpy(added->text, line->text, indent);
+    memset(added->text + indent, ' ', extra);
+    memcpy(added->text + indent + extra, value, value_len);
+    if (has_comma)
+      added->text[added->len - 1] = ',';
+    if (has_comma) {
+      res = _doc_splice(doc, NULL, NULL, added, added, line->next);
+      if (res != YATL_OK)
+        _line_free(added);
+      return res;
+    }
+    sep_len = 1;
+    value_len = 0; // the value goes on the added line
+  }
+
+  // Rewrite the line with the separator and/or value inserted at `at`
+  size_t ins_len = sep_len + value_len;
+  _YATL_Line_t *new_line = _line_alloc(NULL, line->len + ins_len);
+  if (!new_line) {
+    _line_free(added);
+    return YATL_ERR_NOMEM;
+  }
+  memcpy(new_line->text, line->text, at);
+  memcpy(new_line->text + at, ", ", sep_len);
+  memcpy(new_line->text + at + sep_len, value, value_len);
+  memcpy(new_line->text + at + ins_len, line->text + at, line->len - at);
+  if (added) {
+    new_line->next = added;
+    added->prev = new_line;
+  }
+  res = _doc_splice(doc, line, line, new_line, added ? added : new_line, NULL);
+  if (res != YATL_OK) {
+    _line_free(new_line);
+    _line_free(added);
+    return res;
+  }
+  _span_move_line(_array, line, new_line, at, ins_len);
+  return YATL_OK;
+}
+
+// ---------------------------------------------------------------------
+// Removal
+// ---------------------------------------------------------------------
+
+// Position after the whitespace at or after pos on line
+static size_t _skip_ws_at(const _YATL_Line_t *line, size_t pos) {
+  while (pos < line->len && _is_ws(line->text[pos]))
+    pos++;
+  return pos;
+}
+
+// Position of the whitespace run ending at pos on line
+static size_t _skip_ws_back(const _YATL_Line_t *line, size_t pos) {
+  while (pos > 0 && _is_ws(line->text[pos - 1]))
+    pos--;
+  return pos;
+}
+
+YATL_Result_t YATL_span_remove(YATL_Span_t *span) {
+  if (!span)
+    return YATL_ERR_INVALID_ARG;
+  _YATL_Span_t *_span = (_YATL_Span_t *)span;
+  YATL_Result_t res = _YATL_check_span(_span);
+  if (res != YATL_OK)
+    return res;
+  _YATL_Line_t *first = _span->c_start.line;
+  if (!first || !first->doc)
+    return YATL_ERR_INVALID_ARG; // empty or already removed
+
+  // Work out the text range to cut: whole lines where the item owns its
+  // lines, else the item plus one neighbouring separator
+  size_t start = _span->c_start.pos;
+  bool own_line = _skip_ws_at(first, 0) >= start;
+  _YATL_Line_t *last = first;
+  size_t end = 0;
+  bool whole_lines = false;
+  switch (_span->type) {
+  case YATL_S_NODE_TABLE:
+  case YATL_S_NODE_ARRAY_TABLE:
+    // Body ends at the next header (pos 0) or the end of the document
+    last = _span->c_end.line;
+    if (last != first && _span->c_end.pos == 0)
+      last = last->prev;
+    whole_lines = true;
+    break;
+  case YATL_S_LEAF_COMMENT:
+    whole_lines = own_line;
+    start = _skip_ws_back(first, start);
+    end = first->len;
+    break;
+  case YATL_S_LEAF_KEYVAL:
+  case YATL_S_SLICE_VALUE:
+  case YATL_S_NODE_ARRAY:
+  case YATL_S_NODE_INLINE_TABLE: {
+    // A key-value's value cannot be removed on its own
+    size_t before = _skip_ws_back(first, start);
+    if (_span->type != YATL_S_LEAF_KEYVAL && before > 0 &&
+        first->text[before - 1] == '=')
+      return YATL_ERR_TYPE;
+
+    _YATL_Cursor_t vend = _span->c_start;
+    if (_span->type == YATL_S_LEAF_KEYVAL) {
+      res = _consume(&vend, _TOML_KEY);
+      if (res != YATL_OK)
+        return res;
+      vend.pos++; // '='
+    }
+    res = _consume(&vend, _TOML_VALUE);
+    if (res != YATL_OK)
+      return res;
+    last = vend.line;
+    size_t after = _skip_ws_at(last, vend.pos);
+    bool comma = after < last->len && last->text[after] == ',';
+    if (comma)
+      after = _skip_ws_at(last, after + 1);
+
+    if (own_line && (after == last->len || last->text[after] == '#')) {
+      whole_lines = true; // trailing comment goes with the item
+    } else if (comma) {
+      end = after; // "x, " of "[x, y]"
+    } else if (before > 0 && first->text[before - 1] == ',') {
+      start = before - 1; // ", y" of "[x, y]"
+      end = vend.pos;
+    } else {
+      end = vend.pos; // the only element
+    }
+    break;
+  }
+  default:
+    return YATL_ERR_TYPE;
+  }
+  if (whole_lines) {
+    start = 0;
+    end = last->len;
+  }
+
+  _YATL_Span_t cut = *_span;
+  cut.c_start.pos = start;
+  cut.c_end.line = last;
+  cut.c_end.pos = end;
+  YATL_Cursor_t reinsert, prefix, suffix;
+  return _YATL_span_unlink((YATL_Span_t *)&cut, &reinsert, &prefix, &suffix);
+}
+
+// ---------------------------------------------------------------------
+// Saving
+//
+// Lines are gathered into iovec batches, each line's text followed by a
+// shared newline, and flushed with writev. Platforms without writev fall
+// back to stdio.
+// ---------------------------------------------------------------------
+
+#ifdef _YATL_HAVE_WRITEV
+
+// Iovecs per writev call. A line and its newline take two, so each call
+// writes up to half as many lines.
+#if defined(IOV_MAX) && IOV_MAX < 1024
+#define _YATL_SAVE_IOV IOV_MAX
+#else
+#define _YATL_SAVE_IOV 1024
+#endif
+
+static char _newline = '\n';
+
+// Writes every iovec, resuming after short writes
+static YATL_Result_t _writev_all(int fd, struct iovec *iov, int n) {
+  while (n > 0) {
+    ssize_t written = writev(fd, iov, n);
+    if (written < 0) {
+      if (errno == EINTR)
+        continue;
+      return YATL_ERR_IO;
+    }
+    size_t left = (size_t)written;
+    while (n > 0 && left >= iov->iov_len) {
+      left -= iov->iov_len;
+      iov++;
+      n--;
+    }
+    if (n > 0) {
+      if (written == 0)
+        return YATL_ERR_IO;
+      iov->iov_base = (char *)iov->iov_base + left;
+      iov->iov_len -= left;
+    }
+  }
+  return YATL_OK;
+}
+
+// Writes the lines from first up to stop (NULL for the end) at the current
+// file offset
+static YATL_Result_t _lines_write_fd(int fd, _YATL_Line_t *first,
+                                     _YATL_Line_t *stop) {
+  struct iovec iov[_YATL_SAVE_IOV];
+  int n = 0;
+  for (_YATL_Line_t *line = first; line != stop; line = line->next) {
+    if (n + 2 > _YATL_SAVE_IOV) {
+      YATL_Result_t res = _writev_all(fd, iov, n);
+      if (res != YATL_OK)
+        return res;
+      n = 0;
+    }
+    if (line->len > 0)
+      iov[n++] = (struct iovec){line->text, line->len};
+    iov[n++] = (struct iovec){&_newline, 1};
+  }
+  return _writev_all(fd, iov, n);
+}
+
+YATL_Result_t _doc_write_fd(const _YATL_Doc_t *doc, int fd) {
+  return _lines_write_fd(fd, doc->head, NULL);
+}
+
+#ifdef __APPLE__
+#define st_mtim st_mtimespec
+#endif
+
+static _YATL_FileId_t _file_id(const struct stat *st) {
+  return (_YATL_FileId_t){(uint64_t)st->st_dev, (uint64_t)st->st_ino,
+                          (int64_t)st->st_mtim.tv_sec,
+                          (int64_t)st->st_mtim.tv_nsec};
+}
+
+void _file_id_get(int fd, _YATL_FileId_t *id) {
+  struct stat st;
+  if (fstat(fd, &st) == 0)
+    *id = _file_id(&st);
+  else
+    *id = (_YATL_FileId_t){0};
+}
+
+#else
+
+static YATL_Result_t _doc_write_file(const _YATL_Doc_t *doc, FILE *f) {
+  for (_YATL_Line_t *line = doc->head; line; line = line->next) {
+    if (line->len > 0 && fwrite(line->text, 1, line->len, f) != line->len)
+      return YATL_ERR_IO;
+    if (fputc('\n', f) == EOF)
+      return YATL_ERR_IO;
+  }
+  return YATL_OK;
+}
+
+#endif
+
+// Records the document's lines as written to file at their current offsets
+// and line numbers. Boneyard lines lose their origin since the bytes they
+// came from may be overwritten. A frozen document is left as it is, so
+// saving it stays a read.
+static void _doc_rebase(_YATL_Doc_t *doc, const _YATL_FileId_t *file) {
+  if (doc->frozen)
+    return;
+  doc->origin_file = *file;
+  size_t off = 0;
+  uint32_t n = 0;
+  for (_YATL_Line_t *line = doc->head; line; line = line->next) {
+    line->origin_line = ++n;
+    line->origin = off;
+    off += line->len + 1;
+  }
+  for (_YATL_Line_t *line = doc->boneyard_head; line; line = line->next) {
+    line->origin_line = 0;
+    line->origin = SIZE_MAX;
+  }
+  doc->origin_size = off;
+  doc->origin_lost = false;
+}
+
 YATL_Result_t YATL_doc_save(YATL_Doc_t *doc, const char *path) {
   if (!doc || !path)
     return YATL_ERR_INVALID_ARG;
 
-  const _YATL_Doc_t *_doc = (const _YATL_Doc_t *)doc;
+  _YATL_Doc_t *_doc = (_YATL_Doc_t *)doc;
   YATL_Result_t res = _YATL_check_doc(_doc);
   if (res != YATL_OK)
     return res;
 
+  _YATL_FileId_t file = {0};
+#ifdef _YATL_HAVE_WRITEV
+  int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+  if (fd < 0)
+    return YATL_ERR_IO;
+  res = _doc_write_fd(_doc, fd);
+  _file_id_get(fd, &file);
+  if (close(fd) != 0 && res == YATL_OK)
+    res = YATL_ERR_IO;
+#else
   FILE *f = fopen(path, "wb");
   if (!f)
     return YATL_ERR_IO;
+  res = _doc_write_file(_doc, f);
+  if (fclose(f) != 0 && res == YATL_OK)
+    res = YATL_ERR_IO;
+#endif
+  if (res == YATL_OK)
+    _doc_rebase(_doc, &file);
+  else if (!_doc->frozen)
+    _doc->origin_size = SIZE_MAX; // the file is in an unknown state
+  return res;
+}
 
-  _YATL_Line_t *line = _doc->head;
-  while (line) {
-    if (line->len > 0) {
-      size_t written = fwrite(line->text, 1, line->len, f);
-      if (written != line->len) {
-        fclose(f);
-        return YATL_ERR_IO;
+// Attempts at a free temporary name before giving up
+#define _YATL_TMP_TRIES 100
+
+#ifdef _YATL_HAVE_WRITEV
+
+#ifdef __APPLE__
+#define fdatasync fsync
+#endif
+
+// Creates path.tmp<pid>.<n> for the first free n, writing the name to tmp
+static int _tmp_create(const char *path, char *tmp, size_t cap) {
+  for (unsigned i = 0; i < _YATL_TMP_TRIES; i++) {
+    snprintf(tmp, cap, "%s.tmp%ld.%u", path, (long)getpid(), i);
+    int fd = open(tmp, O_WRONLY | O_CREAT | O_EXCL, 0666);
+    if (fd >= 0 || errno != EEXIST)
+      return fd;
+  }
+  return -1;
+}
+
+#ifdef O_TMPFILE
+// Gives the unnamed file fd a temporary name next to path
+static int _tmp_link(int fd, const char *path, char *tmp, size_t cap) {
+  char proc[32];
+  snprintf(proc, sizeof(proc), "/proc/self/fd/%d", fd);
+  for (unsigned i = 0; i < _YATL_TMP_TRIES; i++) {
+    snprintf(tmp, cap, "%s.tmp%ld.%u", path, (long)getpid(), i);
+    if (linkat(AT_FDCWD, proc, AT_FDCWD, tmp, AT_SYMLINK_FOLLOW) == 0)
+      return 0;
+    if (errno != EEXIST)
+      return -1;
+  }
+  return -1;
+}
+#endif
+
+// Writes the document to the temporary fd with the permission bits of an
+// existing path, then flushes it unless asked not to
+static YATL_Result_t _tmp_fill(const _YATL_Doc_t *doc, int fd,
+                               const char *path, unsigned flags) {
+  struct stat st;
+  if (stat(path, &st) == 0 && fchmod(fd, st.st_mode & 07777) != 0)
+    return YATL_ERR_IO;
+  YATL_Result_t res = _doc_write_fd(doc, fd);
+  if (res == YATL_OK && !(flags & YATL_SAVE_NO_SYNC) && fdatasync(fd) != 0)
+    res = YATL_ERR_IO;
+  return res;
+}
+
+static YATL_Result_t _save_atomic(const _YATL_Doc_t *doc, const char *path,
+                                  unsigned flags, char *tmp, size_t cap,
+                                  const char *dir, _YATL_FileId_t *file) {
+  int fd = -1;
+  YATL_Result_t res = YATL_OK;
+#ifdef O_TMPFILE
+  if (flags & YATL_SAVE_TMPFILE) {
+    fd = open(dir, O_TMPFILE | O_WRONLY, 0666);
+    if (fd >= 0) {
+      res = _tmp_fill(doc, fd, path, flags);
+      if (res != YATL_OK || _tmp_link(fd, path, tmp, cap) != 0) {
+        // Unnamed, the file goes away on close. A failed link (no /proc)
+        // falls back to a named temporary below.
+        close(fd);
+        fd = -1;
+        if (res != YATL_OK)
+          return res;
       }
     }
-    // Write newline after each line to preserve structure
-    if (fputc('\n', f) == EOF) {
-      fclose(f);
+  }
+#endif
+  if (fd < 0) {
+    fd = _tmp_create(path, tmp, cap);
+    if (fd < 0)
+      return YATL_ERR_IO;
+    res = _tmp_fill(doc, fd, path, flags);
+  }
+
+  // Renaming keeps the inode, so this is the identity of path afterwards
+  _file_id_get(fd, file);
+  if (close(fd) != 0 && res == YATL_OK)
+    res = YATL_ERR_IO;
+  if (res == YATL_OK && rename(tmp, path) != 0)
+    res = YATL_ERR_IO;
+  if (res != YATL_OK) {
+    unlink(tmp);
+    return res;
+  }
+
+  if (!(flags & YATL_SAVE_NO_SYNC)) {
+    int dfd = open(dir, O_RDONLY);
+    if (dfd < 0)
+      return YATL_ERR_IO;
+    if (fsync(dfd) != 0)
+      res = YATL_ERR_IO;
+    close(dfd);
+  }
+  return res;
+}
+
+#else
+
+static YATL_Result_t _save_atomic(const _YATL_Doc_t *doc, const char *path,
+                                  unsigned flags, char *tmp, size_t cap,
+                                  const char *dir, _YATL_FileId_t *file) {
+  (void)flags;
+  (void)dir;
+  (void)file;
+  FILE *f = NULL;
+  for (unsigned i = 0; i < _YATL_TMP_TRIES && !f; i++) {
+    snprintf(tmp, cap, "%s.tmp%u", path, i);
+    f = fopen(tmp, "wbx");
+  }
+  if (!f)
+    return YATL_ERR_IO;
+  YATL_Result_t res = _doc_write_file(doc, f);
+  if (fclose(f) != 0 && res == YATL_OK)
+    res = YATL_ERR_IO;
+  if (res == YATL_OK && rename(tmp, path) != 0)
+    res = YATL_ERR_IO;
+  if (res != YATL_OK)
+    remove(tmp);
+  return res;
+}
+
+#endif
+
+YATL_Result_t YATL_doc_save_atomic(YATL_Doc_t *doc, const char *path,
+                                   unsigned flags) {
+  if (!doc || !path)
+    return YATL_ERR_INVALID_ARG;
+
+  _YATL_Doc_t *_doc = (_YATL_Doc_t *)doc;
+  YATL_Result_t res = _YATL_check_doc(_doc);
+  if (res != YATL_OK)
+    return res;
+
+  // One block holds the temporary name and the directory of path
+  size_t len = strlen(path);
+  size_t cap = len + 32;
+  char *tmp = malloc(cap + len + 2);
+  if (!tmp)
+    return YATL_ERR_NOMEM;
+  char *dir = tmp + cap;
+  const char *slash = strrchr(path, '/');
+  if (!slash) {
+    strcpy(dir, ".");
+  } else {
+    size_t dlen = slash == path ? 1 : (size_t)(slash - path);
+    memcpy(dir, path, dlen);
+    dir[dlen] = '\0';
+  }
+
+  _YATL_FileId_t file = {0};
+  res = _save_atomic(_doc, path, flags, tmp, cap, dir, &file);
+  free(tmp);
+  if (res == YATL_OK)
+    _doc_rebase(_doc, &file);
+  return res;
+}
+
+// ---------------------------------------------------------------------
+// Incremental saving
+//
+// Lines remember where they sat in the file last loaded or saved. Walking
+// the document with a running offset, a line whose origin equals the offset
+// is already on disk. A run of other lines ending at a line back at its
+// origin covers the same bytes it replaces and is patched in place; a run
+// reaching the end is written from its start and the file truncated.
+// Origins are only trusted while the file keeps the size, device, inode
+// and modification time recorded when it was last loaded or saved.
+// ---------------------------------------------------------------------
+
+#ifdef _YATL_HAVE_WRITEV
+
+static bool _file_id_equal(const _YATL_FileId_t *a, const _YATL_FileId_t *b) {
+  return a->dev == b->dev && a->ino == b->ino &&
+         a->mtime_sec == b->mtime_sec && a->mtime_nsec == b->mtime_nsec;
+}
+
+static YATL_Result_t _save_incremental(_YATL_Doc_t *doc, int fd,
+                                       size_t *written, _YATL_FileId_t *file) {
+  struct stat st;
+  if (fstat(fd, &st) != 0)
+    return YATL_ERR_IO;
+  _YATL_FileId_t now = _file_id(&st);
+  if ((size_t)st.st_size != doc->origin_size ||
+      !_file_id_equal(&now, &doc->origin_file)) {
+    // Not the file the origins describe, rewrite it whole
+    if (ftruncate(fd, 0) != 0)
+      return YATL_ERR_IO;
+    for (_YATL_Line_t *line = doc->head; line; line = line->next)
+      line->origin = SIZE_MAX;
+  }
+
+  size_t off = 0;
+  _YATL_Line_t *line = doc->head;
+  while (line) {
+    if (line->origin == off) {
+      off += line->len + 1;
+      line = line->next;
+      continue;
+    }
+    size_t start = off;
+    _YATL_Line_t *first = line;
+    while (line && line->origin != off) {
+      off += line->len + 1;
+      line = line->next;
+    }
+    if (lseek(fd, (off_t)start, SEEK_SET) < 0)
       return YATL_ERR_IO;
+    YATL_Result_t res = _lines_write_fd(fd, first, line);
+    if (res != YATL_OK)
+      return res;
+    *written += off - start;
+  }
+  if ((size_t)st.st_size != off && ftruncate(fd, (off_t)off) != 0)
+    return YATL_ERR_IO;
+  _file_id_get(fd, file);
+  return YATL_OK;
+}
+
+#endif
+
+YATL_Result_t YATL_doc_save_incremental(YATL_Doc_t *doc, const char *path,
+                                        size_t *out_written) {
+  if (!doc || !path)
+    return YATL_ERR_INVALID_ARG;
+
+  _YATL_Doc_t *_doc = (_YATL_Doc_t *)doc;
+  YATL_Result_t res = _YATL_check_doc(_doc);
+  if (res != YATL_OK)
+    return res;
+  if (_doc->frozen)
+    return YATL_ERR_INVALID_ARG; // patching rewrites line origins
+
+  size_t written = 0;
+#ifdef _YATL_HAVE_WRITEV
+  int fd = open(path, O_WRONLY | O_CREAT, 0666);
+  if (fd < 0)
+    return YATL_ERR_IO;
+  _YATL_FileId_t file = {0};
+  res = _save_incremental(_doc, fd, &written, &file);
+  if (close(fd) != 0 && res == YATL_OK)
+    res = YATL_ERR_IO;
+  if (res == YATL_OK)
+    _doc_rebase(_doc, &file);
+  else if (!_doc->frozen)
+    _doc->origin_size = SIZE_MAX; // the file is in an unknown state
+#else
+  res = YATL_doc_save(doc, path);
+  written = _doc->origin_size;
+#endif
+  if (out_written)
+    *out_written = written;
+  return res;
+}
+
+// ---------------------------------------------------------------------
+// Serializing to memory
+//
+// A sizing pass sums line lengths, then each line is copied with one
+// memcpy. Nothing is written unless the whole result fits.
+// ---------------------------------------------------------------------
+
+// Copies the text from start to end into buf (NULL to only measure), lines
+// joined with '\n'; returns its length
+static size_t _range_copy(_YATL_Cursor_t start, _YATL_Cursor_t end,
+                          char *buf) {
+  size_t n = 0;
+  size_t pos = start.pos;
+  for (_YATL_Line_t *line = start.line; line; line = line->next) {
+    size_t stop = line == end.line ? end.pos : line->len;
+    if (stop > pos) {
+      if (buf)
+        memcpy(buf + n, line->text + pos, stop - pos);
+      n += stop - pos;
     }
-    line = line->next;
+    if (line == end.line)
+      break;
+    if (buf)
+      buf[n] = '\n';
+    n++;
+    pos = 0;
   }
+  return n;
+}
+
+YATL_Result_t YATL_doc_dumps(const YATL_Doc_t *doc, char *buf, size_t cap,
+                             size_t *out_len) {
+  if (!doc || !out_len || (!buf && cap))
+    return YATL_ERR_INVALID_ARG;
+
+  const _YATL_Doc_t *_doc = (const _YATL_Doc_t *)doc;
+  YATL_Result_t res = _YATL_check_doc(_doc);
+  if (res != YATL_OK)
+    return res;
+
+  size_t len = 0;
+  for (const _YATL_Line_t *line = _doc->head; line; line = line->next)
+    len += line->len + 1;
+  *out_len = len;
+  if (cap < len + 1)
+    return YATL_ERR_BUFFER;
+
+  char *p = buf;
+  for (const _YATL_Line_t *line = _doc->head; line; line = line->next) {
+    memcpy(p, line->text, line->len);
+    p += line->len;
+    *p++ = '\n';
+  }
+  *p = '\0';
+  return YATL_OK;
+}
+
+YATL_Result_t YATL_span_dumps(const YATL_Span_t *span, char *buf, size_t cap,
+                              size_t *out_len) {
+  if (!span || !out_len || (!buf && cap))
+    return YATL_ERR_INVALID_ARG;
+
+  const _YATL_Span_t *_span = (const _YATL_Span_t *)span;
+  YATL_Result_t res = _YATL_check_span(_span);
+  if (res != YATL_OK)
+    return res;
 
-  fclose(f);
+  size_t len = _range_copy(_span->c_start, _span->c_end, NULL);
+  *out_len = len;
+  if (cap < len + 1)
+    return YATL_ERR_BUFFER;
+  _range_copy(_span->c_start, _span->c_end, buf);
+  buf[len] = '\0';
   return YATL_OK;
 }
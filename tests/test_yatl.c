@@ -1,8 +1,15 @@
 #include "yatl.h"
 #include "yatl_private.h"
+#include "yatl_lexer.h"
 #include "munit.h"
+#include <math.h>
+#include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 // =============================================================================
 // Common helpers
 // =============================================================================
@@ -34,6 +41,204 @@ static void pretty_print(YATL_Span_t *span) {
     }
 }
 
+// Verifies every line's cached header flag and next-header pointer
+static void assert_header_index(YATL_Doc_t *doc) {
+    _YATL_Doc_t *_doc = (_YATL_Doc_t *)doc;
+    _YATL_Line_t *next_header = NULL;
+    for (_YATL_Line_t *line = _doc->tail; line; line = line->prev) {
+        munit_assert_ptr(line->next_header, ==, next_header);
+        munit_assert_int(line->is_header, ==, line->len > 0 && line->text[0] == '[');
+        if (line->is_header)
+            next_header = line;
+    }
+}
+
+// =============================================================================
+// Load tests
+// =============================================================================
+
+// Checks that the file at path holds exactly len bytes of expected
+static void assert_file(const char *path, const char *expected, size_t len) {
+    FILE *f = fopen(path, "rb");
+    munit_assert_not_null(f);
+    char *out = malloc(len + 1);
+    munit_assert_not_null(out);
+    size_t n = fread(out, 1, len + 1, f);
+    fclose(f);
+    munit_assert_size(n, ==, len);
+    munit_assert_memory_equal(len, out, expected);
+    free(out);
+}
+
+// Loads src with UTF-8 validation; returns the result and the bad offset
+static YATL_Result_t load_validated(const char *src, size_t *bad) {
+    YATL_Doc_t doc = YATL_doc_create();
+    *bad = SIZE_MAX;
+    YATL_Result_t res = YATL_doc_loads_ex(&doc, src, strlen(src),
+                                          YATL_LOAD_VALIDATE_UTF8, bad);
+    YATL_doc_free(&doc);
+    return res;
+}
+
+static MunitResult test_load_utf8(const MunitParameter params[], void *data) {
+    (void)params; (void)data;
+    size_t bad;
+
+    munit_assert_int(load_validated("name = \"caf\xC3\xA9\"\r\nsym = \"\xE2\x82\xAC \xF0\x9F\x98\x80\"\n", &bad), ==, YATL_OK);
+    munit_assert_size(bad, ==, SIZE_MAX);
+    munit_assert_int(load_validated("", &bad), ==, YATL_OK);
+
+    // Stray continuation byte after a long ASCII run on the second line
+    munit_assert_int(load_validated("a = 1\nlonger_key_name = \"\x80\"", &bad), ==, YATL_ERR_ENCODING);
+    munit_assert_size(bad, ==, 25);
+    // Overlong, surrogate, out of range and truncated sequences
+    munit_assert_int(load_validated("k = \"\xC0\xAF\"", &bad), ==, YATL_ERR_ENCODING);
+    munit_assert_size(bad, ==, 5);
+    munit_assert_int(load_validated("k = \"\xE0\x80\xAF\"", &bad), ==, YATL_ERR_ENCODING);
+    munit_assert_size(bad, ==, 5);
+    munit_assert_int(load_validated("k = \"\xED\xA0\x80\"", &bad), ==, YATL_ERR_ENCODING);
+    munit_assert_size(bad, ==, 5);
+    munit_assert_int(load_validated("k = \"\xF4\x90\x80\x80\"", &bad), ==, YATL_ERR_ENCODING);
+    munit_assert_size(bad, ==, 5);
+    munit_assert_int(load_validated("k = \"\xE2\x82\"\n", &bad), ==, YATL_ERR_ENCODING);
+    munit_assert_size(bad, ==, 5);
+    munit_assert_int(load_validated("k = \xF0\x9F\x98", &bad), ==, YATL_ERR_ENCODING);
+    munit_assert_size(bad, ==, 4);
+
+    // Without the flag any bytes are accepted
+    YATL_Doc_t doc = YATL_doc_create();
+    const char *src = "k = \"\xFF\"";
+    munit_assert_int(YATL_doc_loads(&doc, src, strlen(src)), ==, YATL_OK);
+    YATL_doc_free(&doc);
+
+    munit_assert_int(YATL_doc_loads_ex(NULL, src, 1, 0, NULL), ==, YATL_ERR_INVALID_ARG);
+    return MUNIT_OK;
+}
+
+static MunitResult test_load_save_roundtrip(const MunitParameter params[], void *data) {
+    (void)params; (void)data;
+    const char *path = "test_save_out.toml";
+
+    // Enough lines, empty ones included, to span several write batches
+    size_t cap = 2000 * 16, len = 0;
+    char *src = malloc(cap);
+    munit_assert_not_null(src);
+    for (int i = 0; i < 2000; i++)
+        len += (size_t)snprintf(src + len, cap - len, i % 7 ? "k%d = %d\n" : "\n", i, i);
+
+    YATL_Doc_t doc = YATL_doc_create();
+    munit_assert_int(YATL_doc_loads(&doc, src, len), ==, YATL_OK);
+    munit_assert_int(YATL_doc_save(&doc, path), ==, YATL_OK);
+    YATL_doc_free(&doc);
+
+    assert_file(path, src, len);
+    remove(path);
+
+    munit_assert_int(YATL_doc_save(NULL, path), ==, YATL_ERR_INVALID_ARG);
+    free(src);
+    return MUNIT_OK;
+}
+
+static MunitResult test_load_save_atomic(const MunitParameter params[], void *data) {
+    (void)params; (void)data;
+    const char *path = "test_save_atomic.toml";
+    const unsigned flags[] = { YATL_SAVE_DEFAULT, YATL_SAVE_NO_SYNC,
+                               YATL_SAVE_TMPFILE,
+                               YATL_SAVE_TMPFILE | YATL_SAVE_NO_SYNC };
+    char src[32];
+
+    FILE *f = fopen(path, "wb");
+    munit_assert_not_null(f);
+    fputs("old = true\n", f);
+    fclose(f);
+
+    for (size_t i = 0; i < sizeof(flags) / sizeof(flags[0]); i++) {
+        int len = snprintf(src, sizeof(src), "v = %zu\n", i);
+        YATL_Doc_t doc = YATL_doc_create();
+        munit_assert_int(YATL_doc_loads(&doc, src, (size_t)len), ==, YATL_OK);
+        munit_assert_int(YATL_doc_save_atomic(&doc, path, flags[i]), ==, YATL_OK);
+        assert_file(path, src, (size_t)len);
+#if defined(__unix__) || defined(__APPLE__)
+        // No temporary is left behind
+        char tmp[64];
+        snprintf(tmp, sizeof(tmp), "%s.tmp%ld.0", path, (long)getpid());
+        munit_assert_null(fopen(tmp, "rb"));
+#endif
+        YATL_doc_free(&doc);
+    }
+    remove(path);
+
+    YATL_Doc_t doc = YATL_doc_create();
+    munit_assert_int(YATL_doc_loads(&doc, "v = 1", 5), ==, YATL_OK);
+    munit_assert_int(YATL_doc_save_atomic(&doc, "no_such_dir/out.toml", 0), ==, YATL_ERR_IO);
+    munit_assert_int(YATL_doc_save_atomic(&doc, NULL, 0), ==, YATL_ERR_INVALID_ARG);
+    munit_assert_int(YATL_doc_save_atomic(NULL, path, 0), ==, YATL_ERR_INVALID_ARG);
+    YATL_doc_free(&doc);
+    return MUNIT_OK;
+}
+
+static MunitResult test_load_dumps(const MunitParameter params[], void *data) {
+    (void)params; (void)data;
+    const char *src = "a = 1 # one\n"
+                      "\n"
+                      "[t]\n"
+                      "s = \"\"\"\n"
+                      "two\"\"\"\n"
+                      "[u]\n"
+                      "v = [1, 2]";
+    YATL_Doc_t doc = YATL_doc_create();
+    munit_assert_int(YATL_doc_loads(&doc, src, strlen(src)), ==, YATL_OK);
+
+    // Sizing call, then a too-small buffer is left alone
+    char buf[128];
+    size_t len = SIZE_MAX;
+    munit_assert_int(YATL_doc_dumps(&doc, NULL, 0, &len), ==, YATL_ERR_BUFFER);
+    munit_assert_size(len, ==, strlen(src) + 1);
+    memset(buf, 'x', sizeof(buf));
+    munit_assert_int(YATL_doc_dumps(&doc, buf, len, &len), ==, YATL_ERR_BUFFER);
+    munit_assert_char(buf[0], ==, 'x');
+    munit_assert_int(YATL_doc_dumps(&doc, buf, len + 1, &len), ==, YATL_OK);
+    munit_assert_memory_equal(strlen(src), buf, src);
+    munit_assert_string_equal(buf + strlen(src), "\n");
+
+    YATL_Span_t doc_span, table, kv;
+    munit_assert_int(YATL_doc_span(&doc, &doc_span), ==, YATL_OK);
+    munit_assert_int(YATL_span_dumps(&doc_span, buf, sizeof(buf), &len), ==, YATL_OK);
+    munit_assert_string_equal(buf, src);
+
+    munit_assert_int(YATL_span_find_name(&doc_span, "a", &kv), ==, YATL_OK);
+    munit_assert_int(YATL_span_dumps(&kv, buf, sizeof(buf), &len), ==, YATL_OK);
+    munit_assert_string_equal(buf, "a = 1");
+
+    munit_assert_int(YATL_span_find_name(&doc_span, "t", &table), ==, YATL_OK);
+    munit_assert_int(YATL_span_dumps(&table, buf, sizeof(buf), &len), ==, YATL_OK);
+    munit_assert_string_equal(buf, "[t]\ns = \"\"\"\ntwo\"\"\"\n");
+    munit_assert_int(YATL_span_find_name(&table, "s", &kv), ==, YATL_OK);
+    munit_assert_int(YATL_span_dumps(&kv, buf, sizeof(buf), &len), ==, YATL_OK);
+    munit_assert_string_equal(buf, "s = \"\"\"\ntwo\"\"\"");
+    munit_assert_size(len, ==, 14);
+    munit_assert_int(YATL_span_dumps(&kv, buf, 14, &len), ==, YATL_ERR_BUFFER);
+
+    munit_assert_int(YATL_span_dumps(&kv, NULL, 1, &len), ==, YATL_ERR_INVALID_ARG);
+    munit_assert_int(YATL_doc_dumps(NULL, buf, sizeof(buf), &len), ==, YATL_ERR_INVALID_ARG);
+    YATL_doc_free(&doc);
+
+    // An empty document dumps to an empty string
+    doc = YATL_doc_create();
+    munit_assert_int(YATL_doc_dumps(&doc, buf, 1, &len), ==, YATL_OK);
+    munit_assert_size(len, ==, 0);
+    munit_assert_string_equal(buf, "");
+    return MUNIT_OK;
+}
+
+static MunitTest load_tests[] = {
+    { "/utf8", test_load_utf8, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL },
+    { "/save_roundtrip", test_load_save_roundtrip, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL },
+    { "/save_atomic", test_load_save_atomic, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL },
+    { "/dumps", test_load_dumps, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL },
+    { NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL }
+};
+
 // =============================================================================
 // Find tests
 // =============================================================================
@@ -313,6 +518,192 @@ static MunitResult test_find_not_found(const MunitParameter params[], void *data
     return MUNIT_OK;
 }
 
+static void assert_cursor_equal(const _YATL_Cursor_t *a, const _YATL_Cursor_t *b) {
+    munit_assert_ptr(a->line, ==, b->line);
+    if (a->line)
+        munit_assert_size(a->pos, ==, b->pos);
+}
+
+static void assert_span_equal(YATL_Span_t *a, YATL_Span_t *b) {
+    _YATL_Span_t *_a = (_YATL_Span_t *)a;
+    _YATL_Span_t *_b = (_YATL_Span_t *)b;
+    munit_assert_int(_a->type, ==, _b->type);
+    assert_cursor_equal(&_a->c_start, &_b->c_start);
+    assert_cursor_equal(&_a->c_end, &_b->c_end);
+    assert_cursor_equal(&_a->s_c_start, &_b->s_c_start);
+    assert_cursor_equal(&_a->s_c_end, &_b->s_c_end);
+}
+
+// Slices every keyval with and without the boundary cache and compares
+static int check_keyval_cache(YATL_Span_t *in_span) {
+    int count = 0;
+    YATL_Cursor_t cursor = YATL_cursor_create();
+    YATL_Span_t span;
+    while (YATL_span_find_next(in_span, &cursor, &span) == YATL_OK) {
+        if (YATL_span_type(&span) == YATL_S_NODE_TABLE ||
+            YATL_span_type(&span) == YATL_S_NODE_ARRAY_TABLE) {
+            count += check_keyval_cache(&span);
+            continue;
+        }
+        if (YATL_span_type(&span) != YATL_S_LEAF_KEYVAL)
+            continue;
+        munit_assert_true(((_YATL_Span_t *)&span)->kv.cached);
+
+        YATL_Span_t key, val, key_ref, val_ref;
+        munit_assert_int(YATL_span_keyval_slice(&span, &key, &val), ==, YATL_OK);
+        YATL_Span_t uncached = span;
+        ((_YATL_Span_t *)&uncached)->kv.cached = false;
+        munit_assert_int(YATL_span_keyval_slice(&uncached, &key_ref, &val_ref), ==, YATL_OK);
+        assert_span_equal(&key, &key_ref);
+        assert_span_equal(&val, &val_ref);
+        count++;
+
+        if (YATL_span_type(&val) == YATL_S_NODE_INLINE_TABLE)
+            count += check_keyval_cache(&val);
+    }
+    return count;
+}
+
+static MunitResult test_find_keyval_cache(const MunitParameter params[], void *data) {
+    (void)params; (void)data;
+
+    YATL_Doc_t doc = YATL_doc_create();
+    const char *src =
+        "bare = 1\n"
+        "\"quoted key\" = \"str\"\n"
+        "'lit' = 'lit value' # comment\n"
+        "arr = [1, [2, 3]]\n"
+        "tbl = { a = 1, \"b\" = \"two\", c = { d = [4] } }\n"
+        "ml = \"\"\"\n"
+        "line\n"
+        "\"\"\"\n"
+        "[t]\n"
+        "x   =   \"spaced\"   \n";
+    YATL_Result_t res = YATL_doc_loads(&doc, src, strlen(src));
+    munit_assert_int(res, ==, YATL_OK);
+
+    YATL_Span_t doc_span;
+    res = YATL_doc_span(&doc, &doc_span);
+    munit_assert_int(res, ==, YATL_OK);
+    munit_assert_int(check_keyval_cache(&doc_span), ==, 11);
+
+    // Keys are parsed on first use, then read from the cache
+    YATL_Span_t kv, key, val;
+    YATL_Cursor_t cursor = YATL_cursor_create();
+    res = YATL_span_find_next(&doc_span, &cursor, &kv);
+    munit_assert_int(res, ==, YATL_OK);
+    munit_assert_false(((_YATL_Span_t *)&kv)->kv.key_parsed);
+    res = YATL_span_find_name(&doc_span, "quoted key", &kv);
+    munit_assert_int(res, ==, YATL_OK);
+    _YATL_Span_t *_kv = (_YATL_Span_t *)&kv;
+    munit_assert_true(_kv->kv.key_parsed);
+    munit_assert_true(_kv->kv.key_quoted);
+    _kv->kv.key_end--; // a second parse would undo this
+    res = YATL_span_keyval_slice(&kv, &key, &val);
+    munit_assert_int(res, ==, YATL_OK);
+    assert_span_text(&key, "quoted ke");
+
+    YATL_doc_free(&doc);
+    return MUNIT_OK;
+}
+
+static MunitResult test_find_get_many(const MunitParameter params[], void *data) {
+    (void)params; (void)data;
+
+    YATL_Doc_t doc = YATL_doc_create();
+    YATL_Result_t res = YATL_doc_load(&doc, "test_path.toml");
+    munit_assert_int(res, ==, YATL_OK);
+
+    YATL_Span_t server;
+    res = YATL_doc_find_path(&doc, "server", &server);
+    munit_assert_int(res, ==, YATL_OK);
+
+    const char *keys[] = {"limits.max", "host", "missing", "host"};
+    YATL_Span_t vals[4];
+    YATL_Result_t results[4];
+    res = YATL_span_get_many(&server, keys, 4, vals, results);
+    munit_assert_int(res, ==, YATL_ERR_NOT_FOUND);
+    munit_assert_int(results[0], ==, YATL_OK);
+    assert_span_text(&vals[0], "10");
+    munit_assert_int(results[1], ==, YATL_OK);
+    assert_span_text(&vals[1], "localhost");
+    munit_assert_int(results[2], ==, YATL_ERR_NOT_FOUND);
+    munit_assert_int(results[3], ==, YATL_OK);
+    assert_span_text(&vals[3], "localhost");
+
+    // Inline tables and the document span work too
+    YATL_Span_t doc_span, owner, owner_val, key;
+    YATL_doc_span(&doc, &doc_span);
+    const char *top[] = {"owner", "title"};
+    res = YATL_span_get_many(&doc_span, top, 2, vals, results);
+    munit_assert_int(res, ==, YATL_OK);
+    assert_span_text(&vals[1], "root");
+
+    res = YATL_span_find_name(&doc_span, "owner", &owner);
+    munit_assert_int(res, ==, YATL_OK);
+    res = YATL_span_keyval_slice(&owner, &key, &owner_val);
+    munit_assert_int(res, ==, YATL_OK);
+    const char *inner[] = {"name"};
+    res = YATL_span_get_many(&owner_val, inner, 1, vals, results);
+    munit_assert_int(res, ==, YATL_OK);
+    assert_span_text(&vals[0], "Tom");
+
+    res = YATL_span_get_many(&server, keys, 0, NULL, NULL);
+    munit_assert_int(res, ==, YATL_OK);
+    res = YATL_span_get_many(&server, keys, 4, NULL, results);
+    munit_assert_int(res, ==, YATL_ERR_INVALID_ARG);
+
+    YATL_doc_free(&doc);
+    return MUNIT_OK;
+}
+
+static int count_matching(YATL_Span_t *span, const char *pattern, YATL_Span_t *last) {
+    YATL_Cursor_t cursor = YATL_cursor_create();
+    YATL_Span_t found;
+    int count = 0;
+    while (YATL_span_find_next_matching(span, pattern, &cursor, &cursor, &found) == YATL_OK) {
+        *last = found;
+        count++;
+    }
+    return count;
+}
+
+static MunitResult test_find_matching(const MunitParameter params[], void *data) {
+    (void)params; (void)data;
+
+    YATL_Doc_t doc = YATL_doc_create();
+    YATL_Result_t res = YATL_doc_load(&doc, "test_find.toml");
+    munit_assert_int(res, ==, YATL_OK);
+
+    YATL_Span_t doc_span, span;
+    YATL_doc_span(&doc, &doc_span);
+
+    munit_assert_int(count_matching(&doc_span, "server.*", &span), ==, 2);
+    munit_assert_int(YATL_span_type(&span), ==, YATL_S_NODE_TABLE);
+    munit_assert_int(count_matching(&doc_span, "server.http?", &span), ==, 1);
+    munit_assert_int(count_matching(&doc_span, "*s", &span), ==, 4); // https, users, items x2
+    munit_assert_int(count_matching(&doc_span, "*", &span), ==, 9);
+    munit_assert_int(count_matching(&doc_span, "ver*on", &span), ==, 1);
+    munit_assert_int(count_matching(&doc_span, "title", &span), ==, 1);
+    munit_assert_int(count_matching(&doc_span, "nothing*", &span), ==, 0);
+
+    YATL_Span_t users, kv;
+    res = YATL_span_find_name(&doc_span, "users", &users);
+    munit_assert_int(res, ==, YATL_OK);
+    munit_assert_int(count_matching(&users, "?uest", &kv), ==, 1);
+    munit_assert_int(count_matching(&users, "*", &kv), ==, 2);
+    munit_assert_int(count_matching(&users, "*i*", &kv), ==, 1);
+    // Iteration stops at the end of the table
+    res = YATL_span_find_name(&users, "items", &kv);
+    munit_assert_int(res, !=, YATL_OK);
+
+    res = YATL_span_find_next_matching(&doc_span, NULL, NULL, NULL, &span);
+    munit_assert_int(res, ==, YATL_ERR_INVALID_ARG);
+
+    YATL_doc_free(&doc);
+    return MUNIT_OK;
+}
+
 static MunitTest find_tests[] = {
     { "/toplevel_var", test_find_toplevel_var, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL },
     { "/table", test_find_table, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL },
@@ -321,6 +712,750 @@ static MunitTest find_tests[] = {
     { "/deeply_nested_inline", test_find_deeply_nested_inline, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL },
     { "/next_by_name_cursor", test_find_next_by_name_cursor, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL },
     { "/not_found", test_find_not_found, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL },
+    { "/keyval_cache", test_find_keyval_cache, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL },
+    { "/get_many", test_find_get_many, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL },
+    { "/matching", test_find_matching, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL },
+    { NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL }
+};
+
+// =============================================================================
+// Position tests
+// =============================================================================
+
+static size_t span_at(YATL_Doc_t *doc, size_t line, size_t col, YATL_Span_t *spans, size_t max) {
+    YATL_Cursor_t at;
+    size_t depth = 0;
+    YATL_Result_t res = YATL_doc_cursor_at(doc, line, col, &at);
+    munit_assert_int(res, ==, YATL_OK);
+    res = YATL_doc_span_at(doc, &at, spans, max, &depth);
+    munit_assert_int(res, ==, YATL_OK);
+    return depth;
+}
+
+static MunitResult test_position_span_at(const MunitParameter params[], void *data) {
+    (void)params; (void)data;
+
+    YATL_Doc_t doc = YATL_doc_create();
+    YATL_Result_t res = YATL_doc_load(&doc, "test_find.toml");
+    munit_assert_int(res, ==, YATL_OK);
+
+    YATL_Span_t spans[8];
+    // title = "Test Document"
+    munit_assert_size(span_at(&doc, 2, 12, spans, 8), ==, 2);
+    munit_assert_int(YATL_span_type(&spans[0]), ==, YATL_S_LEAF_KEYVAL);
+    assert_span_text(&spans[1], "Test Document");
+
+    // Key of host = "localhost" inside [database]
+    munit_assert_size(span_at(&doc, 8, 0, spans, 8), ==, 2);
+    munit_assert_int(YATL_span_type(&spans[0]), ==, YATL_S_NODE_TABLE);
+    munit_assert_int(YATL_span_type(&spans[1]), ==, YATL_S_LEAF_KEYVAL);
+
+    // Header line belongs to the table alone
+    munit_assert_size(span_at(&doc, 12, 3, spans, 8), ==, 1);
+
+    // "Alice" in admin = { name = "Alice", ... }
+    munit_assert_size(span_at(&doc, 23, 19, spans, 8), ==, 5);
+    munit_assert_int(YATL_span_type(&spans[2]), ==, YATL_S_NODE_INLINE_TABLE);
+    assert_span_text(&spans[4], "Alice");
+
+    // 100 in data = { ..., nested = { value = 100 } }, first [[items]]
+    munit_assert_size(span_at(&doc, 29, 44, spans, 8), ==, 7);
+    munit_assert_int(YATL_span_type(&spans[0]), ==, YATL_S_NODE_ARRAY_TABLE);
+    assert_span_text(&spans[6], "100");
+
+    // Truncated output still reports the full depth
+    munit_assert_size(span_at(&doc, 29, 44, spans, 2), ==, 7);
+    munit_assert_int(YATL_span_type(&spans[1]), ==, YATL_S_LEAF_KEYVAL);
+
+    // Comment before the first table
+    YATL_Cursor_t at;
+    size_t depth;
+    res = YATL_doc_cursor_at(&doc, 1, 0, &at);
+    munit_assert_int(res, ==, YATL_OK);
+    res = YATL_doc_span_at(&doc, &at, spans, 8, &depth);
+    munit_assert_int(res, ==, YATL_ERR_NOT_FOUND);
+
+    YATL_doc_free(&doc);
+    return MUNIT_OK;
+}
+
+static MunitResult test_position_cursor_at(const MunitParameter params[], void *data) {
+    (void)params; (void)data;
+
+    YATL_Doc_t doc = YATL_doc_create();
+    const char *src = "a = 1\n\n[t]\nb = 2";
+    YATL_Result_t res = YATL_doc_loads(&doc, src, strlen(src));
+    munit_assert_int(res, ==, YATL_OK);
+
+    YATL_Cursor_t by_line, by_offset;
+    res = YATL_doc_cursor_at(&doc, 4, 4, &by_line);
+    munit_assert_int(res, ==, YATL_OK);
+    res = YATL_doc_cursor_at_offset(&doc, 15, &by_offset);
+    munit_assert_int(res, ==, YATL_OK);
+    assert_cursor_equal((_YATL_Cursor_t *)&by_line, (_YATL_Cursor_t *)&by_offset);
+
+    res = YATL_doc_cursor_at_offset(&doc, 6, &by_offset);
+    munit_assert_int(res, ==, YATL_OK);
+    res = YATL_doc_cursor_at(&doc, 2, 0, &by_line);
+    assert_cursor_equal((_YATL_Cursor_t *)&by_line, (_YATL_Cursor_t *)&by_offset);
+
+    res = YATL_doc_cursor_at_offset(&doc, 17, &by_offset);
+    munit_assert_int(res, ==, YATL_ERR_NOT_FOUND);
+    res = YATL_doc_cursor_at(&doc, 5, 0, &by_line);
+    munit_assert_int(res, ==, YATL_ERR_NOT_FOUND);
+    res = YATL_doc_cursor_at(&doc, 1, 6, &by_line);
+    munit_assert_int(res, ==, YATL_ERR_NOT_FOUND);
+    res = YATL_doc_cursor_at(&doc, 0, 0, &by_line);
+    munit_assert_int(res, ==, YATL_ERR_NOT_FOUND);
+
+    // End of the document is inside the last key-value
+    YATL_Span_t spans[4];
+    munit_assert_size(span_at(&doc, 4, 5, spans, 4), ==, 3);
+    assert_span_text(&spans[2], "2");
+
+    YATL_doc_free(&doc);
+    return MUNIT_OK;
+}
+
+static MunitResult test_position_after_edit(const MunitParameter params[], void *data) {
+    (void)params; (void)data;
+
+    YATL_Doc_t doc = YATL_doc_create();
+    const char *src = "[t]\na = 1\nb = 2\n";
+    YATL_Result_t res = YATL_doc_loads(&doc, src, strlen(src));
+    munit_assert_int(res, ==, YATL_OK);
+
+    YATL_Span_t spans[4];
+    munit_assert_size(span_at(&doc, 3, 4, spans, 4), ==, 3);
+    assert_span_text(&spans[2], "2");
+
+    // Replace a = 1 with a multi-line value; b moves down two lines
+    YATL_Span_t doc_span, t, a_val;
+    YATL_doc_span(&doc, &doc_span);
+    YATL_span_find_name(&doc_span, "t", &t);
+    res = get_value_span(&t, "a", &a_val);
+    munit_assert_int(res, ==, YATL_OK);
+    const char *lines[] = {"[", "  1,", "]"};
+    size_t lengths[] = {1, 4, 1};
+    res = YATL_span_ml_set_value(&a_val, lines, lengths, 3);
+    munit_assert_int(res, ==, YATL_OK);
+
+    munit_assert_size(span_at(&doc, 5, 4, spans, 4), ==, 3);
+    assert_span_text(&spans[2], "2");
+    munit_assert_size(span_at(&doc, 3, 2, spans, 4), ==, 4);
+    assert_span_text(&spans[3], "1");
+
+    YATL_doc_free(&doc);
+    return MUNIT_OK;
+}
+
+static MunitTest position_tests[] = {
+    { "/span_at", test_position_span_at, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL },
+    { "/cursor_at", test_position_cursor_at, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL },
+    { "/after_edit", test_position_after_edit, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL },
+    { NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL }
+};
+
+// =============================================================================
+// Value tests
+// =============================================================================
+
+static YATL_Result_t parse_value(const char *toml, YATL_Doc_t *doc, YATL_Span_t *kv) {
+    YATL_Result_t res = YATL_doc_loads(doc, toml, strlen(toml));
+    munit_assert_int(res, ==, YATL_OK);
+    YATL_Span_t doc_span;
+    YATL_doc_span(doc, &doc_span);
+    return YATL_span_find_name(&doc_span, "v", kv);
+}
+
+static YATL_Result_t get_int64(const char *toml, int64_t *out) {
+    YATL_Doc_t doc = YATL_doc_create();
+    YATL_Span_t kv;
+    YATL_Result_t res = parse_value(toml, &doc, &kv);
+    munit_assert_int(res, ==, YATL_OK);
+    res = YATL_span_get_int64(&kv, out);
+    YATL_doc_free(&doc);
+    return res;
+}
+
+static YATL_Result_t get_double(const char *toml, double *out) {
+    YATL_Doc_t doc = YATL_doc_create();
+    YATL_Span_t kv;
+    YATL_Result_t res = parse_value(toml, &doc, &kv);
+    munit_assert_int(res, ==, YATL_OK);
+    res = YATL_span_get_double(&kv, out);
+    YATL_doc_free(&doc);
+    return res;
+}
+
+static MunitResult test_value_int64(const MunitParameter params[], void *data) {
+    (void)params; (void)data;
+    int64_t v;
+
+    munit_assert_int(get_int64("v = 42", &v), ==, YATL_OK);
+    munit_assert_int64(v, ==, 42);
+    munit_assert_int(get_int64("v = -17 # comment", &v), ==, YATL_OK);
+    munit_assert_int64(v, ==, -17);
+    munit_assert_int(get_int64("v = +1_000_000", &v), ==, YATL_OK);
+    munit_assert_int64(v, ==, 1000000);
+    munit_assert_int(get_int64("v = 0", &v), ==, YATL_OK);
+    munit_assert_int64(v, ==, 0);
+    munit_assert_int(get_int64("v = 0xDEAD_beef", &v), ==, YATL_OK);
+    munit_assert_int64(v, ==, 0xDEADBEEF);
+    munit_assert_int(get_int64("v = 0o755", &v), ==, YATL_OK);
+    munit_assert_int64(v, ==, 0755);
+    munit_assert_int(get_int64("v = 0b1101", &v), ==, YATL_OK);
+    munit_assert_int64(v, ==, 13);
+    munit_assert_int(get_int64("v = 9223372036854775807", &v), ==, YATL_OK);
+    munit_assert_int64(v, ==, INT64_MAX);
+    munit_assert_int(get_int64("v = -9223372036854775808", &v), ==, YATL_OK);
+    munit_assert_int64(v, ==, INT64_MIN);
+
+    munit_assert_int(get_int64("v = 9223372036854775808", &v), ==, YATL_ERR_TYPE);
+    munit_assert_int(get_int64("v = 012", &v), ==, YATL_ERR_TYPE);
+    munit_assert_int(get_int64("v = 1__0", &v), ==, YATL_ERR_TYPE);
+    munit_assert_int(get_int64("v = 10_", &v), ==, YATL_ERR_TYPE);
+    munit_assert_int(get_int64("v = -0x10", &v), ==, YATL_ERR_TYPE);
+    munit_assert_int(get_int64("v = 0b102", &v), ==, YATL_ERR_TYPE);
+    munit_assert_int(get_int64("v = 1.5", &v), ==, YATL_ERR_TYPE);
+    munit_assert_int(get_int64("v = \"42\"", &v), ==, YATL_ERR_TYPE);
+    munit_assert_int(get_int64("v = [1]", &v), ==, YATL_ERR_TYPE);
+    return MUNIT_OK;
+}
+
+static MunitResult test_value_double(const MunitParameter params[], void *data) {
+    (void)params; (void)data;
+    double v;
+
+    munit_assert_int(get_double("v = 3.14159", &v), ==, YATL_OK);
+    munit_assert_double(v, ==, 3.14159);
+    munit_assert_int(get_double("v = -0.01", &v), ==, YATL_OK);
+    munit_assert_double(v, ==, -0.01);
+    munit_assert_int(get_double("v = 5e+22", &v), ==, YATL_OK);
+    munit_assert_double(v, ==, 5e22);
+    munit_assert_int(get_double("v = 6.626e-34", &v), ==, YATL_OK);
+    munit_assert_double(v, ==, 6.626e-34);
+    munit_assert_int(get_double("v = 224_617.445_991", &v), ==, YATL_OK);
+    munit_assert_double(v, ==, 224617.445991);
+    munit_assert_int(get_double("v = 1E2", &v), ==, YATL_OK);
+    munit_assert_double(v, ==, 100.0);
+    munit_assert_int(get_double("v = 0.1", &v), ==, YATL_OK);
+    munit_assert_double(v, ==, 0.1);
+    munit_assert_int(get_double("v = 12345678901234567890.5", &v), ==, YATL_OK);
+    munit_assert_double(v, ==, 12345678901234567890.5);
+    munit_assert_int(get_double("v = 2.2250738585072014e-308", &v), ==, YATL_OK);
+    munit_assert_double(v, ==, 2.2250738585072014e-308);
+    munit_assert_int(get_double("v = 42", &v), ==, YATL_OK);
+    munit_assert_double(v, ==, 42.0);
+    munit_assert_int(get_double("v = 0x10", &v), ==, YATL_OK);
+    munit_assert_double(v, ==, 16.0);
+    munit_assert_int(get_double("v = -inf", &v), ==, YATL_OK);
+    munit_assert_true(isinf(v) && v < 0);
+    munit_assert_int(get_double("v = nan", &v), ==, YATL_OK);
+    munit_assert_true(isnan(v));
+    munit_assert_int(get_double("v = -0.0", &v), ==, YATL_OK);
+    munit_assert_true(v == 0.0 && signbit(v));
+
+    munit_assert_int(get_double("v = .5", &v), ==, YATL_ERR_TYPE);
+    munit_assert_int(get_double("v = 5.", &v), ==, YATL_ERR_TYPE);
+    munit_assert_int(get_double("v = 1e", &v), ==, YATL_ERR_TYPE);
+    munit_assert_int(get_double("v = 01.5", &v), ==, YATL_ERR_TYPE);
+    munit_assert_int(get_double("v = 1._5", &v), ==, YATL_ERR_TYPE);
+    munit_assert_int(get_double("v = infinity", &v), ==, YATL_ERR_TYPE);
+    munit_assert_int(get_double("v = true", &v), ==, YATL_ERR_TYPE);
+    return MUNIT_OK;
+}
+
+static MunitResult test_value_bool(const MunitParameter params[], void *data) {
+    (void)params; (void)data;
+
+    YATL_Doc_t doc = YATL_doc_create();
+    const char *src = "a = true\nb = false\nc = True\nd = [true, false]\n";
+    YATL_Result_t res = YATL_doc_loads(&doc, src, strlen(src));
+    munit_assert_int(res, ==, YATL_OK);
+    YATL_Span_t doc_span, kv, key, arr, elem;
+    YATL_doc_span(&doc, &doc_span);
+
+    bool v = false;
+    YATL_span_find_name(&doc_span, "a", &kv);
+    munit_assert_int(YATL_span_get_bool(&kv, &v), ==, YATL_OK);
+    munit_assert_true(v);
+    YATL_span_find_name(&doc_span, "b", &kv);
+    munit_assert_int(YATL_span_get_bool(&kv, &v), ==, YATL_OK);
+    munit_assert_false(v);
+    YATL_span_find_name(&doc_span, "c", &kv);
+    munit_assert_int(YATL_span_get_bool(&kv, &v), ==, YATL_ERR_TYPE);
+
+    // Array elements are value spans
+    YATL_span_find_name(&doc_span, "d", &kv);
+    YATL_span_keyval_slice(&kv, &key, &arr);
+    YATL_Cursor_t cursor = YATL_cursor_create();
+    res = YATL_span_find_next(&arr, &cursor, &elem);
+    munit_assert_int(res, ==, YATL_OK);
+    munit_assert_int(YATL_span_get_bool(&elem, &v), ==, YATL_OK);
+    munit_assert_true(v);
+    res = YATL_span_find_next(&arr, &cursor, &elem);
+    munit_assert_int(res, ==, YATL_OK);
+    munit_assert_int(YATL_span_get_bool(&elem, &v), ==, YATL_OK);
+    munit_assert_false(v);
+    munit_assert_int(YATL_span_get_bool(&arr, &v), ==, YATL_ERR_TYPE);
+    munit_assert_int(YATL_span_get_bool(&arr, NULL), ==, YATL_ERR_INVALID_ARG);
+
+    YATL_doc_free(&doc);
+    return MUNIT_OK;
+}
+
+static YATL_Result_t get_datetime(const char *toml, YATL_DateTime_t *out) {
+    YATL_Doc_t doc = YATL_doc_create();
+    YATL_Span_t kv;
+    YATL_Result_t res = parse_value(toml, &doc, &kv);
+    munit_assert_int(res, ==, YATL_OK);
+    res = YATL_span_get_datetime(&kv, out);
+    YATL_doc_free(&doc);
+    return res;
+}
+
+static MunitResult test_value_datetime(const MunitParameter params[], void *data) {
+    (void)params; (void)data;
+    YATL_DateTime_t dt;
+
+    munit_assert_int(get_datetime("v = 1979-05-27T07:32:00Z", &dt), ==, YATL_OK);
+    munit_assert_int(dt.kind, ==, YATL_DT_OFFSET_DATETIME);
+    munit_assert_int(dt.year, ==, 1979);
+    munit_assert_int(dt.month, ==, 5);
+    munit_assert_int(dt.day, ==, 27);
+    munit_assert_int(dt.hour, ==, 7);
+    munit_assert_int(dt.minute, ==, 32);
+    munit_assert_int(dt.second, ==, 0);
+    munit_assert_int(dt.offset_minutes, ==, 0);
+
+    munit_assert_int(get_datetime("v = 1979-05-27T00:32:00.999999-07:30", &dt), ==, YATL_OK);
+    munit_assert_int(dt.kind, ==, YATL_DT_OFFSET_DATETIME);
+    munit_assert_int(dt.nanosecond, ==, 999999000);
+    munit_assert_int(dt.offset_minutes, ==, -450);
+
+    // Space separator is read as one value, comment after it is not
+    munit_assert_int(get_datetime("v = 1979-05-27 07:32:00+01:00 # note", &dt), ==, YATL_OK);
+    munit_assert_int(dt.kind, ==, YATL_DT_OFFSET_DATETIME);
+    munit_assert_int(dt.hour, ==, 7);
+    munit_assert_int(dt.offset_minutes, ==, 60);
+
+    munit_assert_int(get_datetime("v = 1979-05-27t07:32:00.5", &dt), ==, YATL_OK);
+    munit_assert_int(dt.kind, ==, YATL_DT_LOCAL_DATETIME);
+    munit_assert_int(dt.nanosecond, ==, 500000000);
+
+    munit_assert_int(get_datetime("v = 2024-02-29", &dt), ==, YATL_OK);
+    munit_assert_int(dt.kind, ==, YATL_DT_LOCAL_DATE);
+    munit_assert_int(dt.day, ==, 29);
+    munit_assert_int(dt.hour, ==, 0);
+
+    munit_assert_int(get_datetime("v = 23:59:60.1234567891", &dt), ==, YATL_OK);
+    munit_assert_int(dt.kind, ==, YATL_DT_LOCAL_TIME);
+    munit_assert_int(dt.second, ==, 60);
+    munit_assert_int(dt.nanosecond, ==, 123456789);
+    munit_assert_int(dt.year, ==, 0);
+
+    munit_assert_int(get_datetime("v = 2023-02-29", &dt), ==, YATL_ERR_TYPE);
+    munit_assert_int(get_datetime("v = 1979-13-01", &dt), ==, YATL_ERR_TYPE);
+    munit_assert_int(get_datetime("v = 1979-05-27T24:00:00", &dt), ==, YATL_ERR_TYPE);
+    munit_assert_int(get_datetime("v = 1979-05-27T07:32", &dt), ==, YATL_ERR_TYPE);
+    munit_assert_int(get_datetime("v = 1979-05-27T07:32:00.", &dt), ==, YATL_ERR_TYPE);
+    munit_assert_int(get_datetime("v = 1979-05-27T07:32:00+0100", &dt), ==, YATL_ERR_TYPE);
+    munit_assert_int(get_datetime("v = 1979-5-27", &dt), ==, YATL_ERR_TYPE);
+    munit_assert_int(get_datetime("v = 42", &dt), ==, YATL_ERR_TYPE);
+    munit_assert_int(get_datetime("v = \"1979-05-27\"", &dt), ==, YATL_ERR_TYPE);
+    return MUNIT_OK;
+}
+
+static void assert_decoded(const char *toml, const char *expected) {
+    YATL_Doc_t doc = YATL_doc_create();
+    YATL_Span_t kv;
+    YATL_Result_t res = parse_value(toml, &doc, &kv);
+    munit_assert_int(res, ==, YATL_OK);
+
+    size_t len;
+    res = YATL_span_get_string_decoded(&kv, NULL, 0, &len);
+    munit_assert_int(res, ==, YATL_ERR_BUFFER);
+    munit_assert_size(len, ==, strlen(expected));
+
+    char buf[128];
+    res = YATL_span_get_string_decoded(&kv, buf, sizeof(buf), &len);
+    munit_assert_int(res, ==, YATL_OK);
+    munit_assert_size(len, ==, strlen(expected));
+    munit_assert_memory_equal(len + 1, buf, expected);
+    YATL_doc_free(&doc);
+}
+
+// Returns the view result; on success also checks the text
+static YATL_Result_t string_view(const char *toml, const char *expected) {
+    YATL_Doc_t doc = YATL_doc_create();
+    YATL_Span_t kv;
+    YATL_Result_t res = parse_value(toml, &doc, &kv);
+    munit_assert_int(res, ==, YATL_OK);
+    const char *text;
+    size_t len;
+    res = YATL_span_get_string_view(&kv, &text, &len);
+    if (res == YATL_OK) {
+        munit_assert_size(len, ==, strlen(expected));
+        munit_assert_memory_equal(len, text, expected);
+    }
+    YATL_doc_free(&doc);
+    return res;
+}
+
+static MunitResult test_value_string(const MunitParameter params[], void *data) {
+    (void)params; (void)data;
+
+    assert_decoded("v = \"plain\"", "plain");
+    assert_decoded("v = \"\"", "");
+    assert_decoded("v = \"tab\\there \\\"q\\\" \\\\ \\e\"", "tab\there \"q\" \\ \x1B");
+    assert_decoded("v = \"\\u00e9\\u20AC\\U0001F600\"", "\xC3\xA9\xE2\x82\xAC\xF0\x9F\x98\x80");
+    assert_decoded("v = 'C:\\path\\n'", "C:\\path\\n");
+
+    // Multi-line: leading newline dropped, lines joined with \n
+    assert_decoded("v = \"\"\"\nRoses\nViolets\"\"\"", "Roses\nViolets");
+    assert_decoded("v = '''\nraw \\n\n  text\n'''", "raw \\n\n  text\n");
+    assert_decoded("v = \"\"\"one line\"\"\"", "one line");
+
+    // Line-ending backslash trims the break and following whitespace
+    assert_decoded("v = \"\"\"\nThe quick \\\n\n    brown \\   \n  fox\"\"\"",
+                   "The quick brown fox");
+
+    munit_assert_int(string_view("v = \"plain\" # c", "plain"), ==, YATL_OK);
+    munit_assert_int(string_view("v = 'C:\\dir'", "C:\\dir"), ==, YATL_OK);
+    munit_assert_int(string_view("v = \"\"\"\nsingle\"\"\"", "single"), ==, YATL_OK);
+    munit_assert_int(string_view("v = \"a\\tb\"", NULL), ==, YATL_ERR_BUFFER);
+    munit_assert_int(string_view("v = \"\"\"\na\nb\"\"\"", NULL), ==, YATL_ERR_BUFFER);
+    munit_assert_int(string_view("v = 42", NULL), ==, YATL_ERR_TYPE);
+
+    size_t len;
+
+    // Invalid escapes and truncation
+    YATL_Doc_t doc = YATL_doc_create();
+    YATL_Span_t kv;
+    char buf[4];
+    munit_assert_int(parse_value("v = \"bad \\q\"", &doc, &kv), ==, YATL_OK);
+    munit_assert_int(YATL_span_get_string_decoded(&kv, buf, sizeof(buf), &len), ==, YATL_ERR_SYNTAX);
+    YATL_doc_free(&doc);
+    doc = YATL_doc_create();
+    munit_assert_int(parse_value("v = \"\\uD800\"", &doc, &kv), ==, YATL_OK);
+    munit_assert_int(YATL_span_get_string_decoded(&kv, buf, sizeof(buf), &len), ==, YATL_ERR_SYNTAX);
+    YATL_doc_free(&doc);
+    doc = YATL_doc_create();
+    munit_assert_int(parse_value("v = \"abcd\"", &doc, &kv), ==, YATL_OK);
+    munit_assert_int(YATL_span_get_string_decoded(&kv, buf, sizeof(buf), &len), ==, YATL_ERR_BUFFER);
+    munit_assert_size(len, ==, 4);
+    munit_assert_memory_equal(4, buf, "abcd");
+    YATL_doc_free(&doc);
+    return MUNIT_OK;
+}
+
+static YATL_Result_t get_int64s(const char *toml, int64_t *out, size_t cap, size_t *n) {
+    YATL_Doc_t doc = YATL_doc_create();
+    YATL_Span_t kv;
+    YATL_Result_t res = parse_value(toml, &doc, &kv);
+    munit_assert_int(res, ==, YATL_OK);
+    *n = SIZE_MAX;
+    res = YATL_span_array_get_int64s(&kv, out, cap, n);
+    YATL_doc_free(&doc);
+    return res;
+}
+
+static MunitResult test_value_array_bulk(const MunitParameter params[], void *data) {
+    (void)params; (void)data;
+    int64_t v[8];
+    size_t n;
+
+    munit_assert_int(get_int64s("v = [1, -2, +3, 0x1F, 1_000, 123456789012345678, 9223372036854775807]", v, 8, &n), ==, YATL_OK);
+    munit_assert_size(n, ==, 7);
+    munit_assert_int64(v[0], ==, 1);
+    munit_assert_int64(v[1], ==, -2);
+    munit_assert_int64(v[2], ==, 3);
+    munit_assert_int64(v[3], ==, 31);
+    munit_assert_int64(v[4], ==, 1000);
+    munit_assert_int64(v[5], ==, INT64_C(123456789012345678));
+    munit_assert_int64(v[6], ==, INT64_MAX);
+
+    // Multi-line with comments and a trailing comma
+    munit_assert_int(get_int64s("v = [\n  10, # ten\n  -20,\n  # none\n  30,\n]\nw = 1", v, 8, &n), ==, YATL_OK);
+    munit_assert_size(n, ==, 3);
+    munit_assert_int64(v[0], ==, 10);
+    munit_assert_int64(v[1], ==, -20);
+    munit_assert_int64(v[2], ==, 30);
+
+    munit_assert_int(get_int64s("v = []", v, 8, &n), ==, YATL_OK);
+    munit_assert_size(n, ==, 0);
+
+    // Too small: the prefix is written and the full count reported
+    munit_assert_int(get_int64s("v = [5, 6, 7]", v, 2, &n), ==, YATL_ERR_BUFFER);
+    munit_assert_size(n, ==, 3);
+    munit_assert_int64(v[1], ==, 6);
+    munit_assert_int(get_int64s("v = [5, 6, 7]", NULL, 0, &n), ==, YATL_ERR_BUFFER);
+    munit_assert_size(n, ==, 3);
+
+    munit_assert_int(get_int64s("v = [1, 2.5]", v, 8, &n), ==, YATL_ERR_TYPE);
+    munit_assert_int(get_int64s("v = [1, \"2\"]", v, 8, &n), ==, YATL_ERR_TYPE);
+    munit_assert_int(get_int64s("v = [[1], [2]]", v, 8, &n), ==, YATL_ERR_TYPE);
+    munit_assert_int(get_int64s("v = [01]", v, 8, &n), ==, YATL_ERR_TYPE);
+    munit_assert_int(get_int64s("v = [12345678x]", v, 8, &n), ==, YATL_ERR_TYPE);
+    munit_assert_int(get_int64s("v = [9223372036854775808]", v, 8, &n), ==, YATL_ERR_TYPE);
+    munit_assert_int(get_int64s("v = 1", v, 8, &n), ==, YATL_ERR_TYPE);
+
+    YATL_Doc_t doc = YATL_doc_create();
+    YATL_Span_t kv;
+    munit_assert_int(parse_value("v = [0.5, 2, -1e3, inf, 0x10]", &doc, &kv), ==, YATL_OK);
+    double d[5];
+    munit_assert_int(YATL_span_array_get_doubles(&kv, d, 5, &n), ==, YATL_OK);
+    munit_assert_size(n, ==, 5);
+    munit_assert_double(d[0], ==, 0.5);
+    munit_assert_double(d[1], ==, 2.0);
+    munit_assert_double(d[2], ==, -1000.0);
+    munit_assert_true(isinf(d[3]));
+    munit_assert_double(d[4], ==, 16.0);
+    munit_assert_int(YATL_span_array_get_doubles(&kv, NULL, 1, &n), ==, YATL_ERR_INVALID_ARG);
+    YATL_doc_free(&doc);
+
+    return MUNIT_OK;
+}
+
+static MunitTest value_tests[] = {
+    { "/int64", test_value_int64, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL },
+    { "/double", test_value_double, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL },
+    { "/bool", test_value_bool, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL },
+    { "/datetime", test_value_datetime, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL },
+    { "/string", test_value_string, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL },
+    { "/array_bulk", test_value_array_bulk, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL },
+    { NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL }
+};
+
+// =============================================================================
+// Path tests
+// =============================================================================
+
+static void assert_path_value(YATL_Doc_t *doc, const char *path, const char *expected) {
+    YATL_Span_t kv, key, val;
+    YATL_Result_t res = YATL_doc_find_path(doc, path, &kv);
+    munit_assert_int(res, ==, YATL_OK);
+    munit_assert_int(YATL_span_type(&kv), ==, YATL_S_LEAF_KEYVAL);
+    res = YATL_span_keyval_slice(&kv, &key, &val);
+    munit_assert_int(res, ==, YATL_OK);
+    assert_span_text(&val, expected);
+}
+
+static MunitResult test_path_resolve(const MunitParameter params[], void *data) {
+    (void)params; (void)data;
+
+    YATL_Doc_t doc = YATL_doc_create();
+    YATL_Result_t res = YATL_doc_load(&doc, "test_path.toml");
+    munit_assert_int(res, ==, YATL_OK);
+
+    assert_path_value(&doc, "title", "root");
+    assert_path_value(&doc, "site.name", "example");
+    assert_path_value(&doc, "owner.name", "Tom");
+    assert_path_value(&doc, "owner.address.city", "Oslo");
+    assert_path_value(&doc, "server.host", "localhost");
+    assert_path_value(&doc, "server.limits.max", "10");
+    assert_path_value(&doc, "server.http.timeout", "30");
+    assert_path_value(&doc, "server.\"tls.conf\".cert", "a.pem");
+    assert_path_value(&doc, " server . 'tls.conf' . cert ", "a.pem");
+
+    YATL_Span_t span;
+    res = YATL_doc_find_path(&doc, "server.http", &span);
+    munit_assert_int(res, ==, YATL_OK);
+    munit_assert_int(YATL_span_type(&span), ==, YATL_S_NODE_TABLE);
+
+    res = YATL_doc_find_path(&doc, "items", &span);
+    munit_assert_int(res, ==, YATL_OK);
+    munit_assert_int(YATL_span_type(&span), ==, YATL_S_NODE_ARRAY_TABLE);
+
+    // Literal keyval name lookup still sees the raw dotted key
+    YATL_Span_t doc_span;
+    YATL_doc_span(&doc, &doc_span);
+    res = YATL_span_find_name(&doc_span, "site.name", &span);
+    munit_assert_int(res, ==, YATL_OK);
+
+    YATL_doc_free(&doc);
+    return MUNIT_OK;
+}
+
+static MunitResult test_path_not_found(const MunitParameter params[], void *data) {
+    (void)params; (void)data;
+
+    YATL_Doc_t doc = YATL_doc_create();
+    YATL_Result_t res = YATL_doc_load(&doc, "test_path.toml");
+    munit_assert_int(res, ==, YATL_OK);
+
+    YATL_Span_t span;
+    res = YATL_doc_find_path(&doc, "server.missing", &span);
+    munit_assert_int(res, ==, YATL_ERR_NOT_FOUND);
+    res = YATL_doc_find_path(&doc, "owner.address.zip", &span);
+    munit_assert_int(res, ==, YATL_ERR_NOT_FOUND);
+    res = YATL_doc_find_path(&doc, "title.sub", &span);
+    munit_assert_int(res, ==, YATL_ERR_NOT_FOUND);
+    // Implicit table has no span of its own
+    res = YATL_doc_find_path(&doc, "site", &span);
+    munit_assert_int(res, ==, YATL_ERR_NOT_FOUND);
+    // Going into an array of tables needs a selector
+    res = YATL_doc_find_path(&doc, "items.id", &span);
+    munit_assert_int(res, ==, YATL_ERR_NOT_FOUND);
+
+    res = YATL_doc_find_path(&doc, "server..host", &span);
+    munit_assert_int(res, ==, YATL_ERR_INVALID_ARG);
+    res = YATL_doc_find_path(&doc, "", &span);
+    munit_assert_int(res, ==, YATL_ERR_INVALID_ARG);
+    // Paths are limited to YATL_PATH_MAX_SEGMENTS segments
+    char deep[YATL_PATH_MAX_SEGMENTS * 2 + 2];
+    memset(deep, 'a', sizeof(deep) - 1);
+    for (size_t i = 1; i < sizeof(deep) - 1; i += 2)
+        deep[i] = '.';
+    deep[sizeof(deep) - 1] = '\0'; // one segment too many
+    res = YATL_doc_find_path(&doc, deep, &span);
+    munit_assert_int(res, ==, YATL_ERR_INVALID_ARG);
+    deep[sizeof(deep) - 3] = '\0';
+    res = YATL_doc_find_path(&doc, deep, &span);
+    munit_assert_int(res, ==, YATL_ERR_NOT_FOUND);
+    YATL_doc_free(&doc);
+
+    // A key of a later table is not found through an earlier one
+    const char *src = "[a]\nx = 1\n[b]\ny = 2\n";
+    res = YATL_doc_loads(&doc, src, strlen(src));
+    munit_assert_int(res, ==, YATL_OK);
+    res = YATL_doc_find_path(&doc, "a.y", &span);
+    munit_assert_int(res, ==, YATL_ERR_NOT_FOUND);
+    assert_path_value(&doc, "b.y", "2");
+
+    YATL_doc_free(&doc);
+    return MUNIT_OK;
+}
+
+static MunitResult test_path_index(const MunitParameter params[], void *data) {
+    (void)params; (void)data;
+
+    YATL_Doc_t doc = YATL_doc_create();
+    YATL_Result_t res = YATL_doc_load(&doc, "test_path.toml");
+    munit_assert_int(res, ==, YATL_OK);
+
+    assert_path_value(&doc, "items[0].id", "1");
+    assert_path_value(&doc, "items[1].id", "2");
+    assert_path_value(&doc, "server.ports[1].port", "8443");
+
+    YATL_Span_t span;
+    res = YATL_doc_find_path(&doc, "server.ports[0]", &span);
+    munit_assert_int(res, ==, YATL_OK);
+    assert_span_text(&span, "8080");
+    res = YATL_doc_find_path(&doc, "items[1]", &span);
+    munit_assert_int(res, ==, YATL_OK);
+    munit_assert_int(YATL_span_type(&span), ==, YATL_S_NODE_ARRAY_TABLE);
+
+    res = YATL_doc_find_path(&doc, "items[2].id", &span);
+    munit_assert_int(res, ==, YATL_ERR_NOT_FOUND);
+    res = YATL_doc_find_path(&doc, "server[0].host", &span);
+    munit_assert_int(res, ==, YATL_ERR_NOT_FOUND);
+    res = YATL_doc_find_path(&doc, "server.ports[2]", &span);
+    munit_assert_int(res, ==, YATL_ERR_NOT_FOUND);
+    res = YATL_doc_find_path(&doc, "title[0]", &span);
+    munit_assert_int(res, ==, YATL_ERR_NOT_FOUND);
+
+    res = YATL_doc_find_path(&doc, "items[]", &span);
+    munit_assert_int(res, ==, YATL_ERR_INVALID_ARG);
+    res = YATL_doc_find_path(&doc, "items[1", &span);
+    munit_assert_int(res, ==, YATL_ERR_INVALID_ARG);
+    res = YATL_doc_find_path(&doc, "items[1]x", &span);
+    munit_assert_int(res, ==, YATL_ERR_INVALID_ARG);
+    YATL_doc_free(&doc);
+
+    // Sub-tables belong to the [[a]] element before them
+    const char *src = "[[a]]\nx = 1\n[a.b]\ny = 2\n[[a.c]]\nz = 5\n"
+                      "[[a]]\nx = 3\n[a.b]\ny = 4\n[[a.c]]\nz = 6\n[[a.c]]\nz = 7\n";
+    res = YATL_doc_loads(&doc, src, strlen(src));
+    munit_assert_int(res, ==, YATL_OK);
+    assert_path_value(&doc, "a[0].b.y", "2");
+    assert_path_value(&doc, "a[1].b.y", "4");
+    assert_path_value(&doc, "a[1].x", "3");
+    assert_path_value(&doc, "a[0].c[0].z", "5");
+    assert_path_value(&doc, "a[1].c[1].z", "7");
+    res = YATL_doc_find_path(&doc, "a[1].b", &span);
+    munit_assert_int(res, ==, YATL_OK);
+    munit_assert_int(YATL_span_type(&span), ==, YATL_S_NODE_TABLE);
+    YATL_Span_t kv, key, val;
+    munit_assert_int(YATL_span_find_name(&span, "y", &kv), ==, YATL_OK);
+    munit_assert_int(YATL_span_keyval_slice(&kv, &key, &val), ==, YATL_OK);
+    assert_span_text(&val, "4");
+    res = YATL_doc_find_path(&doc, "a[0].c[1]", &span);
+    munit_assert_int(res, ==, YATL_ERR_NOT_FOUND);
+    res = YATL_doc_find_path(&doc, "a.b.y", &span);
+    munit_assert_int(res, ==, YATL_ERR_NOT_FOUND);
+    res = YATL_doc_find_path(&doc, "a.x", &span);
+    munit_assert_int(res, ==, YATL_ERR_NOT_FOUND);
+
+    YATL_Query_t q = YATL_query_create();
+    munit_assert_int(YATL_query_compile(&q, "a[1].b.y"), ==, YATL_OK);
+    munit_assert_int(YATL_query_exec(&doc, &q, &kv), ==, YATL_OK);
+    munit_assert_int(YATL_span_keyval_slice(&kv, &key, &val), ==, YATL_OK);
+    assert_span_text(&val, "4");
+    YATL_query_free(&q);
+
+    YATL_doc_free(&doc);
+    return MUNIT_OK;
+}
+
+static MunitResult test_path_query(const MunitParameter params[], void *data) {
+    (void)params; (void)data;
+
+    YATL_Doc_t doc = YATL_doc_create();
+    YATL_Result_t res = YATL_doc_load(&doc, "test_path.toml");
+    munit_assert_int(res, ==, YATL_OK);
+
+    YATL_Query_t q = YATL_query_create();
+    YATL_Span_t kv, key, val;
+    res = YATL_query_exec(&doc, &q, &kv);
+    munit_assert_int(res, ==, YATL_ERR_INVALID_ARG);
+    res = YATL_query_compile(&q, "a..b");
+    munit_assert_int(res, ==, YATL_ERR_INVALID_ARG);
+    char deep[(YATL_PATH_MAX_SEGMENTS + 1) * 5] = "";
+    for (int i = 0; i <= YATL_PATH_MAX_SEGMENTS; i++)
+        strcat(deep, i ? ".a[0]" : "a[0]");
+    res = YATL_query_compile(&q, deep);
+    munit_assert_int(res, ==, YATL_ERR_INVALID_ARG);
+    deep[strlen(deep) - 5] = '\0';
+    res = YATL_query_compile(&q, deep);
+    munit_assert_int(res, ==, YATL_OK);
+    res = YATL_query_exec(&doc, &q, &kv);
+    munit_assert_int(res, ==, YATL_ERR_NOT_FOUND);
+
+    res = YATL_query_compile(&q, "server.\"tls.conf\".cert");
+    munit_assert_int(res, ==, YATL_OK);
+    for (int i = 0; i < 3; i++) {
+        res = YATL_query_exec(&doc, &q, &kv);
+        munit_assert_int(res, ==, YATL_OK);
+        YATL_span_keyval_slice(&kv, &key, &val);
+        assert_span_text(&val, "a.pem");
+    }
+
+    // Recompiling replaces the path
+    res = YATL_query_compile(&q, "items[1].id");
+    munit_assert_int(res, ==, YATL_OK);
+    res = YATL_query_exec(&doc, &q, &kv);
+    munit_assert_int(res, ==, YATL_OK);
+    YATL_span_keyval_slice(&kv, &key, &val);
+    assert_span_text(&val, "2");
+
+    res = YATL_query_compile(&q, "server.http.missing");
+    munit_assert_int(res, ==, YATL_OK);
+    res = YATL_query_exec(&doc, &q, &kv);
+    munit_assert_int(res, ==, YATL_ERR_NOT_FOUND);
+
+    YATL_query_free(&q);
+    YATL_query_free(&q);
+    YATL_doc_free(&doc);
+    return MUNIT_OK;
+}
+
+static MunitTest path_tests[] = {
+    { "/resolve", test_path_resolve, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL },
+    { "/not_found", test_path_not_found, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL },
+    { "/index", test_path_index, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL },
+    { "/query", test_path_query, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL },
     { NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL }
 };
 
@@ -371,8 +1506,11 @@ static MunitResult test_unlink_nested_array(const MunitParameter params[], void
     res = _YATL_span_unlink(&nested_span, &reinsert_pos, &prefix_cursor, &suffix_cursor);
     munit_assert_int(res, ==, YATL_OK);
 
+    assert_header_index(&doc);
+
     res = _YATL_span_relink(&doc, &nested_span, &reinsert_pos, &prefix_cursor, &suffix_cursor);
     munit_assert_int(res, ==, YATL_OK);
+    assert_header_index(&doc);
 
     YATL_doc_free(&doc);
     return MUNIT_OK;
@@ -398,9 +1536,20 @@ static MunitResult test_unlink_standalone_table(const MunitParameter params[], v
     YATL_Cursor_t reinsert_pos, prefix_cursor, suffix_cursor;
     res = _YATL_span_unlink(&table_span, &reinsert_pos, &prefix_cursor, &suffix_cursor);
     munit_assert_int(res, ==, YATL_OK);
+    assert_header_index(&doc);
+
+    YATL_Span_t found;
+    res = YATL_span_find_name(&doc_span, "standalone", &found);
+    munit_assert_int(res, ==, YATL_ERR_NOT_FOUND);
+    res = YATL_span_find_name(&doc_span, "footer", &found);
+    munit_assert_int(res, ==, YATL_OK);
 
     res = _YATL_span_relink(&doc, &table_span, &reinsert_pos, &prefix_cursor, &suffix_cursor);
     munit_assert_int(res, ==, YATL_OK);
+    assert_header_index(&doc);
+
+    res = YATL_span_find_name(&doc_span, "standalone", &found);
+    munit_assert_int(res, ==, YATL_OK);
 
     YATL_doc_free(&doc);
     return MUNIT_OK;
@@ -783,6 +1932,876 @@ static MunitResult test_updates_array_invalid(const MunitParameter params[], voi
     return MUNIT_OK;
 }
 
+static MunitResult test_updates_header_index(const MunitParameter params[], void *data) {
+    (void)params; (void)data;
+
+    YATL_Doc_t doc = YATL_doc_create();
+    const char *src =
+        "[a]\n"
+        "numbers = [\n"
+        "    1\n"
+        "]\n"
+        "[b]\n"
+        "x = 1\n";
+    YATL_Result_t res = YATL_doc_loads(&doc, src, strlen(src));
+    munit_assert_int(res, ==, YATL_OK);
+    assert_header_index(&doc);
+
+    YATL_Span_t doc_span, table_span, val_span;
+    res = YATL_doc_span(&doc, &doc_span);
+    munit_assert_int(res, ==, YATL_OK);
+    res = YATL_span_find_name(&doc_span, "a", &table_span);
+    munit_assert_int(res, ==, YATL_OK);
+    res = get_value_span(&table_span, "numbers", &val_span);
+    munit_assert_int(res, ==, YATL_OK);
+
+    // A line starting with '[' is treated as a header by the body scanner
+    const char *new_lines[] = {"[", "[1, 2],", "]"};
+    size_t new_lengths[] = {1, 7, 1};
+    res = YATL_span_ml_set_value(&val_span, new_lines, new_lengths, 3);
+    munit_assert_int(res, ==, YATL_OK);
+    assert_header_index(&doc);
+
+    const char *flat = "[1, 2]";
+    res = YATL_span_set_value(&val_span, flat, strlen(flat));
+    munit_assert_int(res, ==, YATL_OK);
+    assert_header_index(&doc);
+
+    YATL_Span_t b_span;
+    res = YATL_span_find_name(&doc_span, "b", &b_span);
+    munit_assert_int(res, ==, YATL_OK);
+    const char *text;
+    size_t len;
+    res = YATL_span_get_string(&b_span, "x", &text, &len);
+    munit_assert_int(res, ==, YATL_OK);
+    munit_assert_memory_equal(len, text, "1");
+
+    YATL_doc_free(&doc);
+    return MUNIT_OK;
+}
+
+// Asserts the text of document line n (0-based)
+static void assert_line(YATL_Doc_t *doc, size_t n, const char *expected) {
+    _YATL_Line_t *line = ((_YATL_Doc_t *)doc)->head;
+    while (n-- && line)
+        line = line->next;
+    munit_assert_not_null(line);
+    munit_assert_size(line->len, ==, strlen(expected));
+    munit_assert_memory_equal(line->len, line->text, expected);
+}
+
+static MunitResult test_updates_typed(const MunitParameter params[], void *data) {
+    (void)params; (void)data;
+
+    YATL_Doc_t doc = YATL_doc_create();
+    const char *src = "a = 1 # keep\n"
+                      "b = \"text\"\n"
+                      "c = [1, 2]\n"
+                      "d = true\n"
+                      "e = '''\nx\n'''\n"
+                      "f = 0";
+    YATL_Result_t res = YATL_doc_loads(&doc, src, strlen(src));
+    munit_assert_int(res, ==, YATL_OK);
+    YATL_Span_t doc_span, kv, val;
+    YATL_doc_span(&doc, &doc_span);
+
+    // Key-value span: value replaced, comment kept, span still usable
+    munit_assert_int(YATL_span_find_name(&doc_span, "a", &kv), ==, YATL_OK);
+    munit_assert_int(YATL_span_set_int64(&kv, -9223372036854775807 - 1), ==, YATL_OK);
+    assert_line(&doc, 0, "a = -9223372036854775808 # keep");
+    int64_t i;
+    munit_assert_int(YATL_span_get_int64(&kv, &i), ==, YATL_OK);
+    munit_assert_int64(i, ==, INT64_MIN);
+
+    // Type changes: string to float, array to bool. The old head line went
+    // to the boneyard, so the document span is taken again.
+    YATL_doc_span(&doc, &doc_span);
+    munit_assert_int(get_value_span(&doc_span, "b", &val), ==, YATL_OK);
+    munit_assert_int(YATL_span_set_double(&val, 0.1), ==, YATL_OK);
+    assert_line(&doc, 1, "b = 0.1");
+    assert_span_text(&val, "0.1");
+    munit_assert_int(YATL_span_set_double(&val, 3.0), ==, YATL_OK);
+    assert_span_text(&val, "3.0");
+    munit_assert_int(YATL_span_set_double(&val, 1e300), ==, YATL_OK);
+    assert_span_text(&val, "1e+300");
+    munit_assert_int(YATL_span_set_double(&val, -INFINITY), ==, YATL_OK);
+    assert_span_text(&val, "-inf");
+    double d = 1.0 / 3.0, back;
+    munit_assert_int(YATL_span_set_double(&val, d), ==, YATL_OK);
+    munit_assert_int(YATL_span_get_double(&val, &back), ==, YATL_OK);
+    munit_assert_double(back, ==, d);
+    munit_assert_int(YATL_span_set_double(&val, 0.1 + 0.2), ==, YATL_OK);
+    assert_span_text(&val, "0.30000000000000004");
+
+    munit_assert_int(get_value_span(&doc_span, "c", &val), ==, YATL_OK);
+    munit_assert_int(YATL_span_set_bool(&val, false), ==, YATL_OK);
+    assert_line(&doc, 2, "c = false");
+
+    // Strings pick their quoting
+    munit_assert_int(get_value_span(&doc_span, "d", &val), ==, YATL_OK);
+    munit_assert_int(YATL_span_set_string(&val, "plain", 5), ==, YATL_OK);
+    assert_line(&doc, 3, "d = \"plain\"");
+    assert_span_text(&val, "plain");
+    munit_assert_int(YATL_span_set_string(&val, "C:\\temp", 7), ==, YATL_OK);
+    assert_line(&doc, 3, "d = 'C:\\temp'");
+    assert_span_text(&val, "C:\\temp");
+    munit_assert_int(YATL_span_set_string(&val, "it's \"q\"\n\x01", 10), ==, YATL_OK);
+    assert_line(&doc, 3, "d = \"it's \\\"q\\\"\\n\\u0001\"");
+    char buf[32];
+    size_t len;
+    munit_assert_int(YATL_span_get_string_decoded(&val, buf, sizeof(buf), &len), ==, YATL_OK);
+    munit_assert_size(len, ==, 10);
+    munit_assert_memory_equal(10, buf, "it's \"q\"\n\x01");
+
+    // Multi-line value collapses onto the key line
+    munit_assert_int(YATL_span_find_name(&doc_span, "e", &kv), ==, YATL_OK);
+    munit_assert_int(YATL_span_set_int64(&kv, 7), ==, YATL_OK);
+    assert_line(&doc, 4, "e = 7");
+    assert_line(&doc, 5, "f = 0");
+
+    // Long strings go through the heap
+    char long_str[600];
+    memset(long_str, '\n', sizeof(long_str));
+    munit_assert_int(get_value_span(&doc_span, "f", &val), ==, YATL_OK);
+    munit_assert_int(YATL_span_set_string(&val, long_str, sizeof(long_str)), ==, YATL_OK);
+    munit_assert_size(((_YATL_Doc_t *)&doc)->tail->len, ==, 4 + 2 + 2 * sizeof(long_str));
+
+    munit_assert_int(YATL_span_set_int64(&doc_span, 1), ==, YATL_ERR_TYPE);
+    munit_assert_int(YATL_span_set_string(&val, NULL, 0), ==, YATL_ERR_INVALID_ARG);
+
+    YATL_doc_free(&doc);
+    return MUNIT_OK;
+}
+
+// Joins the document lines with '\n' into buf
+static void doc_text(YATL_Doc_t *doc, char *buf, size_t cap) {
+    size_t n = 0;
+    for (_YATL_Line_t *line = ((_YATL_Doc_t *)doc)->head; line; line = line->next) {
+        munit_assert_size(n + line->len + 2, <=, cap);
+        memcpy(buf + n, line->text, line->len);
+        n += line->len;
+        buf[n++] = '\n';
+    }
+    buf[n] = '\0';
+}
+
+static MunitResult test_updates_txn(const MunitParameter params[], void *data) {
+    (void)params; (void)data;
+
+    YATL_Doc_t doc = YATL_doc_create();
+    const char *src = "a = 1\n"
+                      "b = \"x\" # note\n"
+                      "c = \"\"\"\nmulti\n\"\"\"\n"
+                      "[t]\n"
+                      "d = [1, 2]\n";
+    YATL_Result_t res = YATL_doc_loads(&doc, src, strlen(src));
+    munit_assert_int(res, ==, YATL_OK);
+    char before[256], after[256];
+    doc_text(&doc, before, sizeof(before));
+
+    YATL_Span_t doc_span, kv, t;
+    YATL_doc_span(&doc, &doc_span);
+    munit_assert_int(YATL_txn_begin(&doc), ==, YATL_OK);
+    munit_assert_int(YATL_txn_begin(&doc), ==, YATL_ERR_INVALID_ARG);
+
+    munit_assert_int(YATL_span_find_name(&doc_span, "b", &kv), ==, YATL_OK);
+    munit_assert_int(YATL_span_set_int64(&kv, 2), ==, YATL_OK);
+    munit_assert_int(YATL_span_set_int64(&kv, 3), ==, YATL_OK); // same line twice
+    munit_assert_int(YATL_span_find_name(&doc_span, "c", &kv), ==, YATL_OK);
+    munit_assert_int(YATL_span_set_bool(&kv, true), ==, YATL_OK);
+    munit_assert_int(YATL_span_find_name(&doc_span, "t", &t), ==, YATL_OK);
+    munit_assert_int(YATL_span_find_name(&t, "d", &kv), ==, YATL_OK);
+    munit_assert_int(YATL_span_set_string(&kv, "s", 1), ==, YATL_OK);
+    munit_assert_int(YATL_doc_clear_boneyard(&doc), ==, YATL_ERR_INVALID_ARG);
+
+    doc_text(&doc, after, sizeof(after));
+    munit_assert_string_equal(after, "a = 1\nb = 3 # note\nc = true\n[t]\nd = \"s\"\n");
+    assert_header_index(&doc);
+
+    // Abort restores the text, and spans from before the transaction
+    munit_assert_int(YATL_txn_abort(&doc), ==, YATL_OK);
+    doc_text(&doc, after, sizeof(after));
+    munit_assert_string_equal(after, before);
+    assert_header_index(&doc);
+    munit_assert_int(YATL_span_find_name(&doc_span, "c", &kv), ==, YATL_OK);
+    munit_assert_int(YATL_txn_abort(&doc), ==, YATL_ERR_INVALID_ARG);
+    munit_assert_int(YATL_txn_commit(&doc), ==, YATL_ERR_INVALID_ARG);
+
+    // Committed edits stay
+    munit_assert_int(YATL_txn_begin(&doc), ==, YATL_OK);
+    munit_assert_int(YATL_span_find_name(&doc_span, "b", &kv), ==, YATL_OK);
+    munit_assert_int(YATL_span_set_int64(&kv, 4), ==, YATL_OK);
+    munit_assert_int(YATL_txn_commit(&doc), ==, YATL_OK);
+    doc_text(&doc, after, sizeof(after));
+    munit_assert_string_equal(after, "a = 1\nb = 4 # note\nc = \"\"\"\nmulti\n\"\"\"\n[t]\nd = [1, 2]\n");
+    munit_assert_int(YATL_doc_clear_boneyard(&doc), ==, YATL_OK);
+
+    // Freeing with an open transaction releases the journal
+    munit_assert_int(YATL_txn_begin(&doc), ==, YATL_OK);
+    munit_assert_int(YATL_span_set_int64(&kv, 5), ==, YATL_OK);
+    YATL_doc_free(&doc);
+    return MUNIT_OK;
+}
+
+static MunitResult test_updates_insert(const MunitParameter params[], void *data) {
+    (void)params; (void)data;
+
+    YATL_Doc_t doc = YATL_doc_create();
+    const char *src = "top = 1\n"
+                      "\n"
+                      "[server]\n"
+                      "  host = \"a\"\n"
+                      "  ports = [80]\n"
+                      "# trailing comment\n"
+                      "[empty]\n"
+                      "[list]\n"
+                      "items = [\n"
+                      "  1,\n"
+                      "  2\n"
+                      "]";
+    YATL_Result_t res = YATL_doc_loads(&doc, src, strlen(src));
+    munit_assert_int(res, ==, YATL_OK);
+    YATL_Span_t doc_span, table, kv;
+    YATL_doc_span(&doc, &doc_span);
+
+    // After the last key-value, with its indentation
+    munit_assert_int(YATL_span_find_name(&doc_span, "server", &table), ==, YATL_OK);
+    munit_assert_int(YATL_span_insert_keyval(&table, "timeout", "30", &kv), ==, YATL_OK);
+    assert_span_text(&kv, "timeout = 30");
+    assert_line(&doc, 5, "  timeout = 30");
+    munit_assert_int(YATL_span_insert_keyval(&table, "a b", "\"x\"", NULL), ==, YATL_OK);
+    assert_line(&doc, 6, "  \"a b\" = \"x\"");
+    munit_assert_int(YATL_span_insert_keyval(&table, "host", "1", NULL), ==, YATL_ERR_SYNTAX);
+    munit_assert_int(YATL_span_insert_keyval(&table, "k", "1 2", NULL), ==, YATL_ERR_SYNTAX);
+    munit_assert_int(YATL_span_insert_keyval(&table, "k", "\"open", NULL), ==, YATL_ERR_SYNTAX);
+
+    // Empty table: after the header; document level: before the first table
+    munit_assert_int(YATL_span_find_name(&doc_span, "empty", &table), ==, YATL_OK);
+    munit_assert_int(YATL_span_insert_keyval(&table, "k", "true", NULL), ==, YATL_OK);
+    assert_line(&doc, 9, "k = true");
+    munit_assert_int(YATL_span_insert_keyval(&doc_span, "second", "2", NULL), ==, YATL_OK);
+    assert_line(&doc, 1, "second = 2");
+    assert_header_index(&doc);
+
+    // Inline and multi-line arrays
+    munit_assert_int(YATL_span_find_name(&doc_span, "server", &table), ==, YATL_OK);
+    munit_assert_int(YATL_span_find_name(&table, "ports", &kv), ==, YATL_OK);
+    munit_assert_int(YATL_span_array_append(&kv, "443"), ==, YATL_OK);
+    assert_line(&doc, 5, "  ports = [80, 443]");
+    munit_assert_int(YATL_span_array_append(&kv, "8080"), ==, YATL_OK); // span still valid
+    assert_line(&doc, 5, "  ports = [80, 443, 8080]");
+    munit_assert_int(YATL_span_find_name(&doc_span, "list", &table), ==, YATL_OK);
+    munit_assert_int(YATL_span_find_name(&table, "items", &kv), ==, YATL_OK);
+    munit_assert_int(YATL_span_array_append(&kv, "3"), ==, YATL_OK);
+    assert_line(&doc, 14, "  2,");
+    assert_line(&doc, 15, "  3");
+    munit_assert_int(YATL_span_array_append(&kv, "4"), ==, YATL_OK);
+    assert_line(&doc, 15, "  3,");
+    assert_line(&doc, 16, "  4");
+    assert_line(&doc, 17, "]");
+    int64_t nums[8];
+    size_t n;
+    munit_assert_int(YATL_span_array_get_int64s(&kv, nums, 8, &n), ==, YATL_OK);
+    munit_assert_size(n, ==, 4);
+    munit_assert_int64(nums[3], ==, 4);
+    munit_assert_int(YATL_span_array_append(&kv, "[5"), ==, YATL_ERR_SYNTAX);
+    munit_assert_int(YATL_span_array_append(&table, "5"), ==, YATL_ERR_TYPE);
+
+    // New table at the end, then a key in it
+    munit_assert_int(YATL_doc_append_table(&doc, "added.sub", &table), ==, YATL_OK);
+    munit_assert_int(YATL_span_type(&table), ==, YATL_S_NODE_TABLE);
+    assert_line(&doc, 18, "");
+    assert_line(&doc, 19, "[added.sub]");
+    munit_assert_int(YATL_span_insert_keyval(&table, "x", "[]", NULL), ==, YATL_OK);
+    assert_line(&doc, 20, "x = []");
+    munit_assert_int(YATL_span_find_name(&table, "x", &kv), ==, YATL_OK);
+    munit_assert_int(YATL_span_array_append(&kv, "\"first\""), ==, YATL_OK);
+    assert_line(&doc, 20, "x = [\"first\"]");
+    munit_assert_int(YATL_doc_append_table(&doc, "server", NULL), ==, YATL_ERR_SYNTAX);
+    munit_assert_int(YATL_doc_append_table(&doc, "a]b", NULL), ==, YATL_ERR_SYNTAX);
+    munit_assert_int(YATL_doc_append_table(&doc, "a b", NULL), ==, YATL_ERR_SYNTAX);
+    munit_assert_int(YATL_doc_append_table(&doc, "a.", NULL), ==, YATL_ERR_SYNTAX);
+    munit_assert_int(YATL_doc_append_table(&doc, "\"a", NULL), ==, YATL_ERR_SYNTAX);
+    munit_assert_int(YATL_doc_append_table(&doc, "", NULL), ==, YATL_ERR_SYNTAX);
+    munit_assert_int(YATL_doc_append_table(&doc, "added . 'a b'", NULL), ==, YATL_OK);
+    assert_header_index(&doc);
+
+    // Inserts inside a transaction roll back like any other edit
+    char text[512];
+    doc_text(&doc, text, sizeof(text));
+    munit_assert_int(YATL_txn_begin(&doc), ==, YATL_OK);
+    munit_assert_int(YATL_span_insert_keyval(&table, "y", "1", NULL), ==, YATL_OK);
+    munit_assert_int(YATL_doc_append_table(&doc, "more", NULL), ==, YATL_OK);
+    munit_assert_int(YATL_txn_abort(&doc), ==, YATL_OK);
+    char after[512];
+    doc_text(&doc, after, sizeof(after));
+    munit_assert_string_equal(after, text);
+
+    YATL_doc_free(&doc);
+
+    // Into an empty document, then after the new key
+    munit_assert_int(YATL_doc_loads(&doc, "", 0), ==, YATL_OK);
+    YATL_doc_span(&doc, &doc_span);
+    munit_assert_int(YATL_span_insert_keyval(&doc_span, "a", "1", &kv), ==, YATL_OK);
+    assert_span_text(&kv, "a = 1");
+    munit_assert_int(YATL_span_insert_keyval(&doc_span, "b", "2", NULL), ==, YATL_OK);
+    assert_line(&doc, 0, "a = 1");
+    assert_line(&doc, 1, "b = 2");
+    doc_text(&doc, text, sizeof(text));
+    munit_assert_string_equal(text, "a = 1\nb = 2\n");
+    YATL_Span_t detached = YATL_span_create();
+    munit_assert_int(YATL_span_insert_keyval(&detached, "c", "3", NULL), ==, YATL_ERR_INVALID_ARG);
+    YATL_doc_free(&doc);
+    return MUNIT_OK;
+}
+
+// Loads src, removes the item found by find(doc_span), returns the new text
+static YATL_Result_t remove_from(const char *src, const char *table, const char *key,
+                                 int elem, char *out, size_t cap) {
+    YATL_Doc_t doc = YATL_doc_create();
+    munit_assert_int(YATL_doc_loads(&doc, src, strlen(src)), ==, YATL_OK);
+    YATL_Span_t span, parent, val, k;
+    YATL_doc_span(&doc, &span);
+    parent = span;
+    if (table)
+        munit_assert_int(YATL_span_find_name(&span, table, &parent), ==, YATL_OK);
+    munit_assert_int(YATL_span_find_name(&parent, key, &span), ==, YATL_OK);
+    if (elem >= 0) {
+        munit_assert_int(YATL_span_keyval_slice(&span, &k, &val), ==, YATL_OK);
+        YATL_Cursor_t cursor = YATL_cursor_create();
+        for (int i = 0; i <= elem; i++)
+            munit_assert_int(YATL_span_find_next(&val, &cursor, &span), ==, YATL_OK);
+    }
+    YATL_Result_t res = YATL_span_remove(&span);
+    doc_text(&doc, out, cap);
+    if (res == YATL_OK)
+        munit_assert_int(YATL_span_remove(&span), ==, YATL_ERR_INVALID_ARG);
+    assert_header_index(&doc);
+    YATL_doc_free(&doc);
+    return res;
+}
+
+static MunitResult test_updates_remove(const MunitParameter params[], void *data) {
+    (void)params; (void)data;
+    char out[256];
+
+    // Key-values and tables take their lines with them
+    const char *src = "a = 1\nb = \"\"\"\nx\n\"\"\" # note\nc = 3\n[t]\nd = 4\n\n[u]\ne = 5";
+    munit_assert_int(remove_from(src, NULL, "a", -1, out, sizeof(out)), ==, YATL_OK);
+    munit_assert_string_equal(out, "b = \"\"\"\nx\n\"\"\" # note\nc = 3\n[t]\nd = 4\n\n[u]\ne = 5\n");
+    munit_assert_int(remove_from(src, NULL, "b", -1, out, sizeof(out)), ==, YATL_OK);
+    munit_assert_string_equal(out, "a = 1\nc = 3\n[t]\nd = 4\n\n[u]\ne = 5\n");
+    munit_assert_int(remove_from(src, NULL, "t", -1, out, sizeof(out)), ==, YATL_OK);
+    munit_assert_string_equal(out, "a = 1\nb = \"\"\"\nx\n\"\"\" # note\nc = 3\n[u]\ne = 5\n");
+    munit_assert_int(remove_from(src, NULL, "u", -1, out, sizeof(out)), ==, YATL_OK);
+    munit_assert_string_equal(out, "a = 1\nb = \"\"\"\nx\n\"\"\" # note\nc = 3\n[t]\nd = 4\n\n");
+    munit_assert_int(remove_from(src, "u", "e", -1, out, sizeof(out)), ==, YATL_OK);
+    munit_assert_string_equal(out, "a = 1\nb = \"\"\"\nx\n\"\"\" # note\nc = 3\n[t]\nd = 4\n\n[u]\n");
+
+    // Inline elements take one comma
+    src = "v = [1, 2, 3] # c\nw = { x = 1, y = 2 }\n";
+    munit_assert_int(remove_from(src, NULL, "v", 0, out, sizeof(out)), ==, YATL_OK);
+    munit_assert_string_equal(out, "v = [2, 3] # c\nw = { x = 1, y = 2 }\n");
+    munit_assert_int(remove_from(src, NULL, "v", 2, out, sizeof(out)), ==, YATL_OK);
+    munit_assert_string_equal(out, "v = [1, 2] # c\nw = { x = 1, y = 2 }\n");
+    munit_assert_int(remove_from(src, NULL, "w", 1, out, sizeof(out)), ==, YATL_OK);
+    munit_assert_string_equal(out, "v = [1, 2, 3] # c\nw = { x = 1 }\n");
+    munit_assert_int(remove_from("v = [\"only\"]", NULL, "v", 0, out, sizeof(out)), ==, YATL_OK);
+    munit_assert_string_equal(out, "v = []\n");
+
+    // Elements on their own lines
+    src = "v = [\n  1, # one\n  2,\n  3\n]";
+    munit_assert_int(remove_from(src, NULL, "v", 0, out, sizeof(out)), ==, YATL_OK);
+    munit_assert_string_equal(out, "v = [\n  2,\n  3\n]\n");
+    munit_assert_int(remove_from(src, NULL, "v", 2, out, sizeof(out)), ==, YATL_OK);
+    munit_assert_string_equal(out, "v = [\n  1, # one\n  2,\n]\n");
+
+    // A key-value's value alone cannot go
+    YATL_Doc_t doc = YATL_doc_create();
+    YATL_Span_t kv;
+    munit_assert_int(parse_value("v = 1", &doc, &kv), ==, YATL_OK);
+    YATL_Span_t key, val, doc_span;
+    munit_assert_int(YATL_span_keyval_slice(&kv, &key, &val), ==, YATL_OK);
+    munit_assert_int(YATL_span_remove(&val), ==, YATL_ERR_TYPE);
+    munit_assert_int(YATL_span_remove(&key), ==, YATL_ERR_TYPE);
+    YATL_doc_span(&doc, &doc_span);
+    munit_assert_int(YATL_span_remove(&doc_span), ==, YATL_ERR_TYPE);
+
+    // Removal is journaled
+    munit_assert_int(YATL_txn_begin(&doc), ==, YATL_OK);
+    munit_assert_int(YATL_span_remove(&kv), ==, YATL_OK);
+    munit_assert_null(((_YATL_Doc_t *)&doc)->head);
+    munit_assert_int(YATL_txn_abort(&doc), ==, YATL_OK);
+    assert_line(&doc, 0, "v = 1");
+    YATL_doc_free(&doc);
+    return MUNIT_OK;
+}
+
+// Sets key to value, saves incrementally and checks the file against the
+// document; returns the number of bytes written
+static size_t save_after_set(YATL_Doc_t *doc, const char *path, const char *key, int64_t value) {
+    YATL_Span_t doc_span, kv;
+    char text[256];
+    size_t written = SIZE_MAX;
+    if (key) {
+        munit_assert_int(YATL_doc_span(doc, &doc_span), ==, YATL_OK);
+        munit_assert_int(YATL_span_find_name(&doc_span, key, &kv), ==, YATL_OK);
+        munit_assert_int(YATL_span_set_int64(&kv, value), ==, YATL_OK);
+    }
+    munit_assert_int(YATL_doc_save_incremental(doc, path, &written), ==, YATL_OK);
+    doc_text(doc, text, sizeof(text));
+    assert_file(path, text, strlen(text));
+    return written;
+}
+
+static MunitResult test_updates_save_incremental(const MunitParameter params[], void *data) {
+    (void)params; (void)data;
+    const char *path = "test_save_incremental.toml";
+    const char *src = "a = 1\n"
+                      "b = 2\n"
+                      "c = 3\n";
+
+    FILE *f = fopen(path, "wb");
+    munit_assert_not_null(f);
+    fputs(src, f);
+    fclose(f);
+    YATL_Doc_t doc = YATL_doc_create();
+    munit_assert_int(YATL_doc_load(&doc, path), ==, YATL_OK);
+
+    // Nothing changed, nothing written
+    munit_assert_size(save_after_set(&doc, path, NULL, 0), ==, 0);
+    // Same length edits are patched in place
+    munit_assert_size(save_after_set(&doc, path, "b", 7), ==, 6);
+    munit_assert_size(save_after_set(&doc, path, "a", 5), ==, 6);
+    // A longer value rewrites from its line on
+    munit_assert_size(save_after_set(&doc, path, "b", 1000), ==, 15);
+    // A shorter one too, and the file is truncated
+    munit_assert_size(save_after_set(&doc, path, "b", 1), ==, 12);
+    munit_assert_size(save_after_set(&doc, path, NULL, 0), ==, 0);
+
+    // Removing the last line only truncates
+    YATL_Span_t doc_span, kv;
+    munit_assert_int(YATL_doc_span(&doc, &doc_span), ==, YATL_OK);
+    munit_assert_int(YATL_span_find_name(&doc_span, "c", &kv), ==, YATL_OK);
+    munit_assert_int(YATL_span_remove(&kv), ==, YATL_OK);
+    munit_assert_size(save_after_set(&doc, path, NULL, 0), ==, 0);
+
+    // Aborted edits relink lines that are still on disk
+    munit_assert_int(YATL_txn_begin(&doc), ==, YATL_OK);
+    munit_assert_int(YATL_doc_span(&doc, &doc_span), ==, YATL_OK);
+    munit_assert_int(YATL_span_find_name(&doc_span, "a", &kv), ==, YATL_OK);
+    munit_assert_int(YATL_span_set_int64(&kv, 123), ==, YATL_OK);
+    munit_assert_int(YATL_txn_abort(&doc), ==, YATL_OK);
+    munit_assert_size(save_after_set(&doc, path, NULL, 0), ==, 0);
+
+    // A file that changed underneath is rewritten whole
+    f = fopen(path, "wb");
+    munit_assert_not_null(f);
+    fputs("x = 1\n", f);
+    fclose(f);
+    munit_assert_size(save_after_set(&doc, path, NULL, 0), ==, 12);
+    YATL_doc_free(&doc);
+
+    // Windows newlines and a missing final newline are rewritten
+    const char *crlf = "a = 1\r\nb = 2";
+    f = fopen(path, "wb");
+    munit_assert_not_null(f);
+    fputs(crlf, f);
+    fclose(f);
+    munit_assert_int(YATL_doc_load(&doc, path), ==, YATL_OK);
+    munit_assert_size(save_after_set(&doc, path, NULL, 0), ==, 12);
+    YATL_doc_free(&doc);
+
+    // Another file of the same size is rewritten whole, not patched
+    const char *other = "test_save_incremental_other.toml";
+    f = fopen(path, "wb");
+    munit_assert_not_null(f);
+    fputs(src, f);
+    fclose(f);
+    f = fopen(other, "wb");
+    munit_assert_not_null(f);
+    fputs("x = 9\ny = 8\nz = 7\n", f);
+    fclose(f);
+    munit_assert_int(YATL_doc_load(&doc, path), ==, YATL_OK);
+    munit_assert_size(save_after_set(&doc, other, "b", 5), ==, 18);
+    munit_assert_size(save_after_set(&doc, other, NULL, 0), ==, 0);
+    // Loaded from memory, the first save cannot trust any file
+    YATL_doc_free(&doc);
+    munit_assert_int(YATL_doc_loads(&doc, src, strlen(src)), ==, YATL_OK);
+    munit_assert_size(save_after_set(&doc, path, NULL, 0), ==, 18);
+    YATL_doc_free(&doc);
+    remove(other);
+
+    remove(path);
+    munit_assert_int(YATL_doc_save_incremental(NULL, path, NULL), ==, YATL_ERR_INVALID_ARG);
+    return MUNIT_OK;
+}
+
+typedef struct {
+    char text[1024];
+    size_t len;
+} DiffOut;
+
+static YATL_Result_t diff_collect(void *ctx, const char *data, size_t len) {
+    DiffOut *out = ctx;
+    munit_assert_size(out->len + len, <, sizeof(out->text));
+    memcpy(out->text + out->len, data, len);
+    out->len += len;
+    out->text[out->len] = '\0';
+    return YATL_OK;
+}
+
+static YATL_Result_t diff_fail(void *ctx, const char *data, size_t len) {
+    (void)ctx; (void)data; (void)len;
+    return YATL_ERR_IO;
+}
+
+static MunitResult test_updates_diff(const MunitParameter params[], void *data) {
+    (void)params; (void)data;
+    char src[256];
+    size_t n = 0;
+    for (int i = 1; i <= 12; i++)
+        n += (size_t)snprintf(src + n, sizeof(src) - n, "k%d = %d\n", i, i);
+    YATL_Doc_t doc = YATL_doc_create();
+    munit_assert_int(YATL_doc_loads(&doc, src, n), ==, YATL_OK);
+
+    DiffOut out = {0};
+    munit_assert_int(YATL_doc_diff(&doc, "a.toml", diff_collect, &out), ==, YATL_OK);
+    munit_assert_size(out.len, ==, 0);
+
+    YATL_Span_t doc_span, kv;
+    munit_assert_int(YATL_doc_span(&doc, &doc_span), ==, YATL_OK);
+    munit_assert_int(YATL_span_find_name(&doc_span, "k2", &kv), ==, YATL_OK);
+    munit_assert_int(YATL_span_set_int64(&kv, 20), ==, YATL_OK);
+    munit_assert_int(YATL_doc_span(&doc, &doc_span), ==, YATL_OK);
+    munit_assert_int(YATL_span_find_name(&doc_span, "k1", &kv), ==, YATL_OK);
+    munit_assert_int(YATL_span_remove(&kv), ==, YATL_OK);
+    munit_assert_int(YATL_doc_span(&doc, &doc_span), ==, YATL_OK);
+    munit_assert_int(YATL_span_find_name(&doc_span, "k10", &kv), ==, YATL_OK);
+    munit_assert_int(YATL_span_remove(&kv), ==, YATL_OK);
+    munit_assert_int(YATL_doc_span(&doc, &doc_span), ==, YATL_OK);
+    munit_assert_int(YATL_span_insert_keyval(&doc_span, "k13", "13", NULL), ==, YATL_OK);
+
+    // Same output as diff -u; the unchanged k6 splits two hunks
+    munit_assert_int(YATL_doc_diff(&doc, "a.toml", diff_collect, &out), ==, YATL_OK);
+    munit_assert_string_equal(out.text,
+        "--- a.toml\n+++ a.toml\n"
+        "@@ -1,5 +1,4 @@\n"
+        "-k1 = 1\n-k2 = 2\n+k2 = 20\n k3 = 3\n k4 = 4\n k5 = 5\n"
+        "@@ -7,6 +6,6 @@\n"
+        " k7 = 7\n k8 = 8\n k9 = 9\n-k10 = 10\n k11 = 11\n k12 = 12\n+k13 = 13\n");
+
+    // Without a name only hunks are written
+    out.len = 0;
+    munit_assert_int(YATL_doc_diff(&doc, NULL, diff_collect, &out), ==, YATL_OK);
+    munit_assert_memory_equal(4, out.text, "@@ -");
+    munit_assert_int(YATL_doc_diff(&doc, NULL, diff_fail, NULL), ==, YATL_ERR_IO);
+    munit_assert_int(YATL_doc_diff(&doc, NULL, NULL, NULL), ==, YATL_ERR_INVALID_ARG);
+
+    // Freed original lines can no longer be shown, until the next save
+    munit_assert_int(YATL_doc_clear_boneyard(&doc), ==, YATL_OK);
+    munit_assert_int(YATL_doc_diff(&doc, NULL, diff_collect, &out), ==, YATL_ERR_NOT_FOUND);
+    munit_assert_int(YATL_doc_save(&doc, "test_diff_out.toml"), ==, YATL_OK);
+    remove("test_diff_out.toml");
+    out.len = 0;
+    munit_assert_int(YATL_doc_diff(&doc, NULL, diff_collect, &out), ==, YATL_OK);
+    munit_assert_size(out.len, ==, 0);
+
+    // Adding to an empty file
+    YATL_doc_free(&doc);
+    doc = YATL_doc_create();
+    munit_assert_int(YATL_doc_loads(&doc, "", 0), ==, YATL_OK);
+    munit_assert_int(YATL_doc_append_table(&doc, "t", NULL), ==, YATL_OK);
+    out.len = 0;
+    munit_assert_int(YATL_doc_diff(&doc, NULL, diff_collect, &out), ==, YATL_OK);
+    munit_assert_string_equal(out.text, "@@ -0,0 +1,1 @@\n+[t]\n");
+    YATL_doc_free(&doc);
+    return MUNIT_OK;
+}
+
+// Sets key to value through a fresh document span
+static void set_key(YATL_Doc_t *doc, const char *key, int64_t value) {
+    YATL_Span_t doc_span, kv;
+    munit_assert_int(YATL_doc_span(doc, &doc_span), ==, YATL_OK);
+    munit_assert_int(YATL_span_find_name(&doc_span, key, &kv), ==, YATL_OK);
+    munit_assert_int(YATL_span_set_int64(&kv, value), ==, YATL_OK);
+}
+
+static MunitResult test_updates_undo(const MunitParameter params[], void *data) {
+    (void)params; (void)data;
+    const char *src = "a = 1\nb = 2\nc = 3\n";
+    YATL_Doc_t doc = YATL_doc_create();
+    munit_assert_int(YATL_doc_loads(&doc, src, strlen(src)), ==, YATL_OK);
+    char text[128];
+
+    // Off by default
+    set_key(&doc, "a", 10);
+    munit_assert_int(YATL_doc_undo(&doc), ==, YATL_ERR_NOT_FOUND);
+
+    munit_assert_int(YATL_doc_set_undo_limit(&doc, 2), ==, YATL_OK);
+    set_key(&doc, "a", 11);
+    set_key(&doc, "b", 20);
+    YATL_Span_t doc_span, kv;
+    munit_assert_int(YATL_doc_span(&doc, &doc_span), ==, YATL_OK);
+    munit_assert_int(YATL_span_find_name(&doc_span, "c", &kv), ==, YATL_OK);
+    munit_assert_int(YATL_span_remove(&kv), ==, YATL_OK);
+    doc_text(&doc, text, sizeof(text));
+    munit_assert_string_equal(text, "a = 11\nb = 20\n");
+
+    // Only the last two steps are kept
+    munit_assert_int(YATL_doc_undo(&doc), ==, YATL_OK);
+    doc_text(&doc, text, sizeof(text));
+    munit_assert_string_equal(text, "a = 11\nb = 20\nc = 3\n");
+    munit_assert_int(YATL_doc_undo(&doc), ==, YATL_OK);
+    doc_text(&doc, text, sizeof(text));
+    munit_assert_string_equal(text, "a = 11\nb = 2\nc = 3\n");
+    munit_assert_int(YATL_doc_undo(&doc), ==, YATL_ERR_NOT_FOUND);
+    assert_header_index(&doc);
+
+    munit_assert_int(YATL_doc_redo(&doc), ==, YATL_OK);
+    munit_assert_int(YATL_doc_redo(&doc), ==, YATL_OK);
+    doc_text(&doc, text, sizeof(text));
+    munit_assert_string_equal(text, "a = 11\nb = 20\n");
+    munit_assert_int(YATL_doc_redo(&doc), ==, YATL_ERR_NOT_FOUND);
+
+    // A new edit drops what could be redone
+    munit_assert_int(YATL_doc_undo(&doc), ==, YATL_OK);
+    set_key(&doc, "a", 12);
+    munit_assert_int(YATL_doc_redo(&doc), ==, YATL_ERR_NOT_FOUND);
+    munit_assert_int(YATL_doc_undo(&doc), ==, YATL_OK);
+    doc_text(&doc, text, sizeof(text));
+    munit_assert_string_equal(text, "a = 11\nb = 20\nc = 3\n");
+
+    // A committed transaction is one step; none can be taken inside one
+    munit_assert_int(YATL_doc_set_undo_limit(&doc, 10), ==, YATL_OK);
+    munit_assert_int(YATL_txn_begin(&doc), ==, YATL_OK);
+    set_key(&doc, "a", 1);
+    set_key(&doc, "c", 30);
+    munit_assert_int(YATL_doc_undo(&doc), ==, YATL_ERR_INVALID_ARG);
+    munit_assert_int(YATL_txn_commit(&doc), ==, YATL_OK);
+    munit_assert_int(YATL_txn_begin(&doc), ==, YATL_OK);
+    set_key(&doc, "b", 2);
+    munit_assert_int(YATL_txn_abort(&doc), ==, YATL_OK);
+    munit_assert_int(YATL_doc_undo(&doc), ==, YATL_OK);
+    doc_text(&doc, text, sizeof(text));
+    munit_assert_string_equal(text, "a = 11\nb = 20\nc = 3\n");
+    munit_assert_int(YATL_doc_redo(&doc), ==, YATL_OK);
+    doc_text(&doc, text, sizeof(text));
+    munit_assert_string_equal(text, "a = 1\nb = 20\nc = 30\n");
+
+    // Many steps under a small limit
+    munit_assert_int(YATL_doc_set_undo_limit(&doc, 3), ==, YATL_OK);
+    for (int i = 0; i < 100; i++)
+        set_key(&doc, "b", i);
+    for (int i = 0; i < 3; i++)
+        munit_assert_int(YATL_doc_undo(&doc), ==, YATL_OK);
+    munit_assert_int(YATL_doc_undo(&doc), ==, YATL_ERR_NOT_FOUND);
+    doc_text(&doc, text, sizeof(text));
+    munit_assert_string_equal(text, "a = 1\nb = 96\nc = 30\n");
+
+    // Freeing the boneyard ends the history
+    munit_assert_int(YATL_doc_redo(&doc), ==, YATL_OK);
+    munit_assert_int(YATL_doc_clear_boneyard(&doc), ==, YATL_OK);
+    munit_assert_int(YATL_doc_redo(&doc), ==, YATL_ERR_NOT_FOUND);
+    munit_assert_int(YATL_doc_undo(&doc), ==, YATL_ERR_NOT_FOUND);
+    set_key(&doc, "a", 2);
+    munit_assert_int(YATL_doc_undo(&doc), ==, YATL_OK);
+    munit_assert_int(YATL_doc_set_undo_limit(&doc, 0), ==, YATL_OK);
+    munit_assert_int(YATL_doc_redo(&doc), ==, YATL_ERR_NOT_FOUND);
+    munit_assert_int(YATL_doc_undo(NULL), ==, YATL_ERR_INVALID_ARG);
+    YATL_doc_free(&doc);
+    return MUNIT_OK;
+}
+
+#if defined(__unix__) || defined(__APPLE__)
+typedef struct {
+    int tables, keyvals;
+    bool remove; // remove key-values named "port" instead of setting them
+} StreamCounts;
+
+// Sets every "port" to 8443 and adds "added = true" to [b]
+static YATL_Result_t stream_edit(void *ctx, YATL_Span_t *span) {
+    StreamCounts *counts = ctx;
+    YATL_Span_t key, val;
+    const char *name;
+    size_t len;
+    if (YATL_span_type(span) != YATL_S_LEAF_KEYVAL) {
+        counts->tables++;
+        YATL_Cursor_t cursor = YATL_cursor_create();
+        munit_assert_int(YATL_span_iter_line(span, &cursor, &name, &len), ==, YATL_OK);
+        if (len == 3 && memcmp(name, "[b]", 3) == 0)
+            return YATL_span_insert_keyval(span, "added", "true", NULL);
+        return YATL_OK;
+    }
+    counts->keyvals++;
+    munit_assert_int(YATL_span_keyval_slice(span, &key, &val), ==, YATL_OK);
+    munit_assert_int(YATL_span_text(&key, &name, &len), ==, YATL_OK);
+    if (len == 4 && memcmp(name, "port", 4) == 0)
+        return counts->remove ? YATL_span_remove(span) : YATL_span_set_int64(span, 8443);
+    if (len == 4 && memcmp(name, "stop", 4) == 0)
+        return YATL_ERR_TYPE;
+    return YATL_OK;
+}
+
+// Filters src through stream_edit; returns the result and the output
+static YATL_Result_t stream_run(const char *src, size_t len, StreamCounts *counts,
+                                char **out, size_t *out_len) {
+    const char *in_path = "test_stream_in.toml", *out_path = "test_stream_out.toml";
+    FILE *f = fopen(in_path, "wb");
+    munit_assert_not_null(f);
+    munit_assert_size(fwrite(src, 1, len, f), ==, len);
+    fclose(f);
+    int in_fd = open(in_path, O_RDONLY);
+    int out_fd = open(out_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    munit_assert_int(in_fd, >=, 0);
+    munit_assert_int(out_fd, >=, 0);
+    YATL_Result_t res = YATL_stream_filter(in_fd, out_fd, stream_edit, counts);
+    close(in_fd);
+    close(out_fd);
+
+    f = fopen(out_path, "rb");
+    munit_assert_not_null(f);
+    fseek(f, 0, SEEK_END);
+    *out_len = (size_t)ftell(f);
+    fseek(f, 0, SEEK_SET);
+    *out = malloc(*out_len + 1);
+    munit_assert_not_null(*out);
+    munit_assert_size(fread(*out, 1, *out_len, f), ==, *out_len);
+    (*out)[*out_len] = '\0';
+    fclose(f);
+    remove(in_path);
+    remove(out_path);
+    return res;
+}
+
+static MunitResult test_updates_stream(const MunitParameter params[], void *data) {
+    (void)params; (void)data;
+    StreamCounts counts = {0};
+    char *out;
+    size_t len;
+
+    // Untouched tables pass through as they are, Windows newlines included
+    const char *src = "title = \"x\"\r\n"
+                      "port = 80 # web\n"
+                      "[a]\r\n"
+                      "name = \"a\"\r\n"
+                      "[b]\n"
+                      "port = 81\n"
+                      "[[c]]\n"
+                      "v = [\n"
+                      "  1,\n"
+                      "]\n"
+                      "[d]\n"
+                      "port = 82";
+    munit_assert_int(stream_run(src, strlen(src), &counts, &out, &len), ==, YATL_OK);
+    munit_assert_string_equal(out,
+                              "title = \"x\"\n"
+                              "port = 8443 # web\n"
+                              "[a]\r\n"
+                              "name = \"a\"\r\n"
+                              "[b]\n"
+                              "port = 8443\n"
+                              "added = true\n"
+                              "[[c]]\n"
+                              "v = [\n"
+                              "  1,\n"
+                              "]\n"
+                              "[d]\n"
+                              "port = 8443\n");
+    munit_assert_int(counts.tables, ==, 4);
+    munit_assert_int(counts.keyvals, ==, 7);
+    free(out);
+
+    // Many tables across several reads, one of them changed
+    size_t cap = 4000 * 32, n = 0;
+    char *big = malloc(cap), *expected = malloc(cap);
+    munit_assert_not_null(big);
+    munit_assert_not_null(expected);
+    for (int i = 0; i < 4000; i++)
+        n += (size_t)snprintf(big + n, cap - n, "[t%d]\n%s = %d\n", i, i == 2500 ? "port" : "k", i);
+    memcpy(expected, big, n + 1);
+    char *hit = strstr(expected, "port = 2500");
+    memcpy(hit, "port = 8443", 11);
+    memset(&counts, 0, sizeof(counts));
+    munit_assert_int(stream_run(big, n, &counts, &out, &len), ==, YATL_OK);
+    munit_assert_size(len, ==, n);
+    munit_assert_memory_equal(n, out, expected);
+    munit_assert_int(counts.tables, ==, 4000);
+    free(out);
+    free(expected);
+    free(big);
+
+    // Callback results stop the filter
+    src = "a = 1\n[s]\nstop = 1\n[t]\nb = 1\n";
+    memset(&counts, 0, sizeof(counts));
+    munit_assert_int(stream_run(src, strlen(src), &counts, &out, &len), ==, YATL_ERR_TYPE);
+    munit_assert_string_equal(out, "a = 1\n");
+    free(out);
+
+    // Key-value callbacks may not remove their key-value
+    src = "port = 1\n";
+    counts.remove = true;
+    munit_assert_int(stream_run(src, strlen(src), &counts, &out, &len), ==, YATL_ERR_INVALID_ARG);
+    free(out);
+
+    munit_assert_int(YATL_stream_filter(-1, 1, stream_edit, NULL), ==, YATL_ERR_INVALID_ARG);
+    return MUNIT_OK;
+}
+#endif
+
+static MunitResult test_updates_freeze(const MunitParameter params[], void *data) {
+    (void)params; (void)data;
+    const char *src = "a = 1\n[server]\nhost = \"h\"\n[server.tls]\non = true\n";
+    YATL_Doc_t doc = YATL_doc_create();
+    munit_assert_int(YATL_doc_loads(&doc, src, strlen(src)), ==, YATL_OK);
+    munit_assert_int(YATL_doc_set_undo_limit(&doc, 4), ==, YATL_OK);
+    set_key(&doc, "a", 2);
+    munit_assert_int(YATL_txn_begin(&doc), ==, YATL_OK);
+    munit_assert_int(YATL_doc_freeze(&doc), ==, YATL_ERR_INVALID_ARG);
+    munit_assert_int(YATL_txn_abort(&doc), ==, YATL_OK);
+    munit_assert_int(YATL_doc_freeze(&doc), ==, YATL_OK);
+    munit_assert_int(YATL_doc_freeze(&doc), ==, YATL_OK);
+
+    // Everything lookups would cache is already built
+    const _YATL_Doc_t *_doc = (const _YATL_Doc_t *)&doc;
+    munit_assert_not_null(_doc->span_index);
+    for (const _YATL_Line_t *line = _doc->head; line; line = line->next)
+        munit_assert_true(!line->is_header || line->name_hashed);
+    const void *index = _doc->span_index;
+    uint64_t gen = _doc->gen;
+
+    // Edits are refused and change nothing
+    YATL_Span_t doc_span, span, table;
+    munit_assert_int(YATL_doc_span(&doc, &doc_span), ==, YATL_OK);
+    munit_assert_int(YATL_span_find_name(&doc_span, "a", &span), ==, YATL_OK);
+    munit_assert_int(YATL_span_set_int64(&span, 3), ==, YATL_ERR_INVALID_ARG);
+    munit_assert_int(YATL_span_remove(&span), ==, YATL_ERR_INVALID_ARG);
+    munit_assert_int(YATL_doc_find_path(&doc, "server", &table), ==, YATL_OK);
+    munit_assert_int(YATL_span_insert_keyval(&table, "port", "80", NULL), ==, YATL_ERR_INVALID_ARG);
+    munit_assert_int(YATL_doc_append_table(&doc, "db", NULL), ==, YATL_ERR_INVALID_ARG);
+    munit_assert_int(YATL_doc_undo(&doc), ==, YATL_ERR_INVALID_ARG);
+    munit_assert_int(YATL_doc_redo(&doc), ==, YATL_ERR_INVALID_ARG);
+    munit_assert_int(YATL_doc_set_undo_limit(&doc, 4), ==, YATL_ERR_INVALID_ARG);
+    munit_assert_int(YATL_txn_begin(&doc), ==, YATL_ERR_INVALID_ARG);
+    munit_assert_int(YATL_doc_clear_boneyard(&doc), ==, YATL_ERR_INVALID_ARG);
+    munit_assert_uint64(_doc->gen, ==, gen);
+    char text[128];
+    doc_text(&doc, text, sizeof(text));
+    munit_assert_string_equal(text, "a = 2\n[server]\nhost = \"h\"\n[server.tls]\non = true\n");
+
+    // Reads still work
+    bool on = false;
+    munit_assert_int(YATL_doc_find_path(&doc, "server.tls.on", &span), ==, YATL_OK);
+    munit_assert_int(YATL_span_get_bool(&span, &on), ==, YATL_OK);
+    munit_assert_true(on);
+    YATL_Cursor_t at;
+    munit_assert_int(YATL_doc_cursor_at(&doc, 3, 0, &at), ==, YATL_OK);
+    munit_assert_ptr_equal(_doc->span_index, index);
+    munit_assert_int(YATL_doc_freeze(NULL), ==, YATL_ERR_INVALID_ARG);
+    YATL_doc_free(&doc);
+    return MUNIT_OK;
+}
+
 static MunitTest updates_tests[] = {
     { "/longer", test_updates_longer, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL },
     { "/shorter", test_updates_shorter, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL },
@@ -794,6 +2813,85 @@ static MunitTest updates_tests[] = {
     { "/multiline_invalid", test_updates_multiline_invalid, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL },
     { "/array_valid", test_updates_array_valid, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL },
     { "/array_invalid", test_updates_array_invalid, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL },
+    { "/header_index", test_updates_header_index, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL },
+    { "/typed", test_updates_typed, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL },
+    { "/txn", test_updates_txn, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL },
+    { "/insert", test_updates_insert, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL },
+    { "/remove", test_updates_remove, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL },
+    { "/save_incremental", test_updates_save_incremental, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL },
+    { "/diff", test_updates_diff, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL },
+    { "/undo", test_updates_undo, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL },
+#if defined(__unix__) || defined(__APPLE__)
+    { "/stream", test_updates_stream, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL },
+#endif
+    { "/freeze", test_updates_freeze, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL },
+    { NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL }
+};
+
+// =============================================================================
+// Lexer tests
+// =============================================================================
+
+static MunitResult test_lexer_char_class(const MunitParameter params[], void *data) {
+    (void)params; (void)data;
+
+    for (int i = 0; i < 256; i++) {
+        char c = (char)i;
+        bool digit = (c >= '0' && c <= '9');
+        bool bare = (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || digit ||
+                    c == '_' || c == '-';
+        bool hex = digit || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+        bool ws = (c == ' ' || c == '\t');
+        munit_assert_int(_is_digit(c), ==, digit);
+        munit_assert_int(_is_bare_key_char(c), ==, bare);
+        munit_assert_int(_is_hex(c), ==, hex);
+        munit_assert_int(_is_ws(c), ==, ws);
+        munit_assert_int(_is_newline(c), ==, (c == '\n' || c == '\r'));
+        munit_assert_int(_is_class(c, _CC_VALUE_END), ==,
+                         ws || c == ',' || c == ']' || c == '}' || c == '#');
+    }
+
+    return MUNIT_OK;
+}
+
+static MunitResult test_lexer_skipany(const MunitParameter params[], void *data) {
+    (void)params; (void)data;
+
+    YATL_Doc_t doc = YATL_doc_create();
+    const char *src = "  ,, ,\n\t,x";
+    YATL_Result_t res = YATL_doc_loads(&doc, src, strlen(src));
+    munit_assert_int(res, ==, YATL_OK);
+
+    _YATL_Doc_t *_doc = (_YATL_Doc_t *)&doc;
+    _YATL_Cursor_t cr = _YATL_EMPTY_CURSOR;
+    cr.line = _doc->head;
+
+    res = _skipWS(&cr);
+    munit_assert_int(res, ==, YATL_OK);
+    munit_assert_size(cr.pos, ==, 2);
+
+    res = _skipany(&cr, _CC_COMMA);
+    munit_assert_int(res, ==, YATL_OK);
+    munit_assert_size(cr.pos, ==, 4);
+
+    // Crosses line boundaries
+    res = _skipany(&cr, _CC_COMMA | _CC_WS);
+    munit_assert_int(res, ==, YATL_OK);
+    munit_assert_ptr(cr.line, ==, _doc->tail);
+    munit_assert_char(cr.line->text[cr.pos], ==, 'x');
+
+    cr.pos++;
+    res = _skipWS(&cr);
+    munit_assert_int(res, ==, YATL_DONE);
+    munit_assert_true(cr.complete);
+
+    YATL_doc_free(&doc);
+    return MUNIT_OK;
+}
+
+static MunitTest lexer_tests[] = {
+    { "/char_class", test_lexer_char_class, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL },
+    { "/skipany", test_lexer_skipany, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL },
     { NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL }
 };
 
@@ -802,9 +2900,14 @@ static MunitTest updates_tests[] = {
 // =============================================================================
 
 static MunitSuite child_suites[] = {
+    { "/load", load_tests, NULL, 1, MUNIT_SUITE_OPTION_NONE },
     { "/find", find_tests, NULL, 1, MUNIT_SUITE_OPTION_NONE },
+    { "/path", path_tests, NULL, 1, MUNIT_SUITE_OPTION_NONE },
+    { "/position", position_tests, NULL, 1, MUNIT_SUITE_OPTION_NONE },
+    { "/value", value_tests, NULL, 1, MUNIT_SUITE_OPTION_NONE },
     { "/unlink", unlink_tests, NULL, 1, MUNIT_SUITE_OPTION_NONE },
     { "/updates", updates_tests, NULL, 1, MUNIT_SUITE_OPTION_NONE },
+    { "/lexer", lexer_tests, NULL, 1, MUNIT_SUITE_OPTION_NONE },
     { NULL, NULL, NULL, 0, MUNIT_SUITE_OPTION_NONE }
 };
 